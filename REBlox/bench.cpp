@@ -0,0 +1,7 @@
+#include "src/bench/bench.h"
+
+// Benchmarks for the engine's hot paths against a snapshot, a dump or a live process
+int main(int argc, char** argv)
+{
+	return reblox::bench::run(argc, argv);
+}
@@ -0,0 +1,7 @@
+#include "src/cli/commands.h"
+
+// Headless entry point, same engine as the GUI without the window or the DX11/ImGui loop
+int main(int argc, char** argv)
+{
+	return reblox::cli::run(argc, argv);
+}
@@ -1,12 +1,26 @@
 #include <iostream>
 #include <cstdint>
 #include <thread>
+#include <ctime>
 #include <d3d11.h>
 #include "thirdparty/imgui/imgui.h"
 #include "thirdparty/imgui/imgui_impl_win32.h"
 #include "thirdparty/imgui/imgui_impl_dx11.h"
 #include "src/memory/memory.h"
+#include "src/memory/attach.h"
+#include "src/memory/processes.h"
+#include "src/memory/process_details.h"
+#include "src/memory/page_cache.h"
+#include "src/memory/read_engine.h"
+#include "src/memory/trace.h"
+#include "src/memory/scheduler.h"
 #include "src/window/gui/gui.h"
+#include "src/window/gui/process_search.h"
+#include "src/window/gui/hex_view.h"
+#include "src/window/gui/stats_panel.h"
+#include "src/window/gui/scan_panel.h"
+#include "src/window/frame_scheduler.h"
+#include "src/window/frame_profiler.h"
 #include <algorithm>
 #include "globals/reblox.h"
 
@@ -28,64 +42,179 @@ void CreateRenderTarget();
 void CleanupRenderTarget();
 
 static bool ShowProcessPicker = false;
-static std::vector<reblox::memory::PE32> ProcessList;
+static bool RecordSession = false;
+static bool ShowDiagnostics = false;
+static bool ShowProfiler = false;
+static reblox::gui::stats_panel diagnostics;
 
 // Memory View Variables
-static uint64_t memoryViewAddress = 0;
-static std::vector<uint8_t> memoryViewBuffer;
-static const size_t BYTES_PER_ROW = 16;
-static const size_t ROWS_TO_DISPLAY = 32;
-static const size_t BUFFER_SIZE = BYTES_PER_ROW * ROWS_TO_DISPLAY;
+static reblox::gui::hex_view memoryView;
+static bool memoryViewOpened = false;
+
+// Scan Variables
+static reblox::gui::scan_panel scanner;
+
+// Memory Read Variables
+static std::string memoryReadResult;
+static bool memoryReadPending = false;
 
 void ResetAttachedProcess()
 {
-	reblox::memory::state.pid = 0;
-	reblox::memory::state.proc = nullptr;
-	reblox::memory::state.process_base = 0;
-	ProcessList = reblox::memory::get_processes();
+	scanner.reset();
+	reblox::memory::detach_from_process();
+	reblox::memory::processes.refresh();
+	memoryViewOpened = false;
+	memoryReadResult.clear();
 }
 
-bool ReadMemoryForView(uint64_t address, size_t size, std::vector<uint8_t>& buffer)
+// %LOCALAPPDATA%\REBlox\sessions\<pid>-<unix time>.rbxt, replayable with reblox-cli / reblox-bench --replay
+std::filesystem::path SessionTracePath(std::int32_t pid)
 {
-	if (reblox::memory::state.proc == nullptr || reblox::memory::state.pid == 0)
-		return false;
+	std::filesystem::path directory = reblox::memory::store::directory() / L"sessions";
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
 
-	buffer.resize(size);
-	SIZE_T bytesRead = 0;
+	wchar_t name[64];
+	swprintf(name, 64, L"%d-%lld.rbxt", pid, static_cast<long long>(std::time(nullptr)));
+	return directory / name;
+}
 
-	BOOL success = ReadProcessMemory(
-		reblox::memory::state.proc,
-		(LPCVOID)address,
-		buffer.data(),
-		size,
-		&bytesRead
-	);
+// Refreshes the process list every 3 seconds on the shared pool's background lane, never two at once.
+// Runs from the frame loop, so an idle window doesn't keep walking the process list either
+static reblox::memory::job ProcessRefresh;
+static std::chrono::steady_clock::time_point LastProcessRefresh;
+
+void RefreshProcessesInBackground()
+{
+	auto now = std::chrono::steady_clock::now();
+	if (now - LastProcessRefresh < std::chrono::seconds(3) || (ProcessRefresh && !ProcessRefresh->done()))
+		return;
+
+	LastProcessRefresh = now;
+	ProcessRefresh = reblox::memory::make_job(reblox::memory::lane::background);
+	reblox::memory::pool.submit(ProcessRefresh, [] { reblox::memory::processes.refresh(); });
+}
 
-	if (!success || bytesRead == 0)
+// Same for the attached process's modules, so DLLs loaded after the attach show up in lookups. The map
+// publishes a new snapshot when something changed, readers on other threads keep the one they have
+static reblox::memory::job ModuleRefresh;
+static std::chrono::steady_clock::time_point LastModuleRefresh;
+
+void RefreshModulesInBackground()
+{
+	auto now = std::chrono::steady_clock::now();
+	if (!reblox::memory::attached() || now - LastModuleRefresh < std::chrono::seconds(3) || (ModuleRefresh && !ModuleRefresh->done()))
+		return;
+
+	LastModuleRefresh = now;
+	ModuleRefresh = reblox::memory::make_job(reblox::memory::lane::background);
+	reblox::memory::pool.submit(ModuleRefresh, [] { reblox::memory::modules.refresh(); });
+}
+
+void FormatReadValue(const std::vector<uint8_t>& data, reblox::memory::ReadWriteType type, char* buf, size_t size)
+{
+	switch (type)
 	{
-		std::fill(buffer.begin(), buffer.end(), 0); // fill with "??"
-		return false;
+	case reblox::memory::ReadWriteType::Float:
+	{
+		float value;
+		memcpy(&value, data.data(), sizeof(value));
+		snprintf(buf, size, "%g", value);
+		break;
+	}
+	case reblox::memory::ReadWriteType::Double:
+	{
+		double value;
+		memcpy(&value, data.data(), sizeof(value));
+		snprintf(buf, size, "%g", value);
+		break;
+	}
+	case reblox::memory::ReadWriteType::Int:
+	{
+		int32_t value;
+		memcpy(&value, data.data(), sizeof(value));
+		snprintf(buf, size, "%d", value);
+		break;
+	}
+	case reblox::memory::ReadWriteType::Unsigned_Int:
+	{
+		uint32_t value;
+		memcpy(&value, data.data(), sizeof(value));
+		snprintf(buf, size, "%u", value);
+		break;
+	}
+	default:
+	{
+		uint64_t value;
+		memcpy(&value, data.data(), sizeof(value));
+		snprintf(buf, size, "0x%llX", value);
+		break;
+	}
 	}
-
-	return true;
 }
 
+size_t ReadValueSize(reblox::memory::ReadWriteType type)
+{
+	switch (type)
+	{
+	case reblox::memory::ReadWriteType::Double:
+	case reblox::memory::ReadWriteType::Uintptr_t:
+		return 8;
+	default:
+		return 4;
+	}
+}
 
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
+// follows the pointer chain one hop per completed read (address = [address] + offset), then reads the value.
+// everything goes through the read engine, the callbacks run on the UI thread when it's drained
+void ReadValueAsync(uint64_t address, std::vector<uintptr_t> offsets, size_t hop, reblox::memory::ReadWriteType type)
 {
-	// Thread for refreshing automatically every x seconds
+	if (hop < offsets.size())
 	{
-		std::thread([]()
+		reblox::memory::reads.submit(address, sizeof(uint64_t), [offsets = std::move(offsets), hop, type](reblox::memory::read_result& result) mutable
 			{
-				while (true)
+				if (!result.ok)
 				{
-					ProcessList = reblox::memory::get_processes();
-					std::this_thread::sleep_for(std::chrono::seconds(3));
+					char buf[64];
+					snprintf(buf, sizeof(buf), "Failed to read pointer at 0x%llX", result.address);
+					memoryReadResult = buf;
+					memoryReadPending = false;
+					return;
 				}
+
+				uint64_t next;
+				memcpy(&next, result.data.data(), sizeof(next));
+				next += offsets[hop];
+				ReadValueAsync(next, std::move(offsets), hop + 1, type);
 			}
-		).detach();
+		);
+		return;
 	}
 
+	reblox::memory::reads.submit(address, ReadValueSize(type), [type](reblox::memory::read_result& result)
+		{
+			char buf[128];
+			if (result.ok)
+			{
+				char value[64];
+				FormatReadValue(result.data, type, value, sizeof(value));
+				snprintf(buf, sizeof(buf), "[0x%llX] = %s", result.address, value);
+			}
+			else
+			{
+				snprintf(buf, sizeof(buf), "Failed to read 0x%llX", result.address);
+			}
+
+			memoryReadResult = buf;
+			memoryReadPending = false;
+		}
+	);
+}
+
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
+{
+	reblox::memory::timeline::engine.name_thread("ui");
+
 	WNDCLASSEX wc = { sizeof(WNDCLASSEX), CS_CLASSDC, WndProc, 0, 0, GetModuleHandle(NULL), NULL, NULL, NULL, NULL, L"REBlox", NULL };
 	RegisterClassEx(&wc);
 	HWND hwnd = CreateWindow(wc.lpszClassName, L"REBlox", WS_OVERLAPPEDWINDOW, 100, 100, 1280, 800, NULL, NULL, wc.hInstance, NULL);
@@ -109,16 +238,30 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 	ImGui_ImplWin32_Init(hwnd);
 	ImGui_ImplDX11_Init(g_pd3dDevice, g_pd3dDeviceContext);
 
+	// Finished reads and process detail fetches wake the frame scheduler so their results get drawn
+	reblox::memory::reads.set_wake_event(reblox::window::frames.get_wake_event());
+	reblox::memory::details_cache.set_wake_event(reblox::window::frames.get_wake_event());
+
 	MSG msg;
 	ZeroMemory(&msg, sizeof(msg));
-	while (msg.message != WM_QUIT)
+	bool done = false;
+	while (!done)
 	{
-		if (PeekMessage(&msg, NULL, 0U, 0U, PM_REMOVE))
+		// Sleeps until input, a finished read or a view's timer instead of redrawing every vsync
+		reblox::window::frames.wait();
+
+		while (PeekMessage(&msg, NULL, 0U, 0U, PM_REMOVE))
 		{
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
-			continue;
+			if (msg.message == WM_QUIT)
+				done = true;
 		}
+		if (done)
+			break;
+
+		// One slice per frame on the timeline, from waking up to Present
+		reblox::memory::timeline::scope frameScope("ui", "frame");
 
 		if (g_ResizeWidth != 0 && g_ResizeHeight != 0)
 		{
@@ -131,13 +274,18 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 		ImGui_ImplDX11_NewFrame();
 		ImGui_ImplWin32_NewFrame();
 		ImGui::NewFrame();
+		reblox::memory::reads.drain();
+		reblox::memory::pages.begin_frame();
+		RefreshProcessesInBackground();
+		RefreshModulesInBackground();
 		ImGui::Begin("Main Window");
 
 		enum class _tab
 		{
 			home,
 			memory,
-			memoryview
+			memoryview,
+			scan
 		} static tab = _tab::home;
 
 		// Tab selection
@@ -157,8 +305,16 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 				if (ImGui::Button("Memory View"))
 				{
 					tab = _tab::memoryview;
-					if (memoryViewAddress == 0)
-						memoryViewAddress = reblox::memory::state.process_base;
+					if (!memoryViewOpened)
+					{
+						memoryView.go_to(reblox::memory::state.process_base);
+						memoryViewOpened = true;
+					}
+				}
+				sl;
+				if (ImGui::Button("Scan"))
+				{
+					tab = _tab::scan;
 				}
 			}
 		}
@@ -167,30 +323,63 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 
 		if (tab == _tab::home)
 		{
+			reblox::window::profile_scope profiled(reblox::window::section::home_tab);
 			if (ImGui::Button("Select Process"))
 			{
 				ShowProcessPicker = true;
 				reblox::gui_shortcuts::focusOnProcessPicker = true;
-				ProcessList = reblox::memory::get_processes();
+				reblox::memory::processes.refresh();
 			}
 			sl;
 			if (ImGui::Button("Detach"))
 			{
 				ResetAttachedProcess();
 			}
+			sl;
+			if (ImGui::Button("Diagnostics"))
+			{
+				ShowDiagnostics = true;
+			}
 
 			if (reblox::memory::state.pid != 0)
 			{
 				ImGui::Text("Attached to PID: %d", reblox::memory::state.pid);
 				ImGui::Text("Base Address: 0x%llX", reblox::memory::state.process_base);
+				if (auto recorder = reblox::memory::attached_recorder())
+				{
+					ImGui::Text("Recording %llu reads to %s", recorder->get_recorded(), recorder->get_path().string().c_str());
+				}
 			}
 			else
 			{
 				ImGui::Text("Status: Not Attached");
 			}
+
+			// Frame scheduler
+			{
+				ImGui::Dummy({ 0, 5 });
+				ImGui::Separator();
+
+				static constexpr int refreshIntervals[] = { 0, 100, 250, 500, 1000 };
+				int refreshIndex = (int)(std::find(std::begin(refreshIntervals), std::end(refreshIntervals), reblox::window::frames.get_min_refresh().count()) - std::begin(refreshIntervals));
+				if (refreshIndex == (int)std::size(refreshIntervals))
+					refreshIndex = 0;
+
+				ImGui::SetNextItemWidth(100);
+				if (ImGui::Combo("Live view refresh", &refreshIndex, "input only\0" "100 ms\0" "250 ms\0" "500 ms\0" "1 s\0"))
+				{
+					reblox::window::frames.set_min_refresh(std::chrono::milliseconds(refreshIntervals[refreshIndex]));
+				}
+
+				const auto& frameStats = reblox::window::frames.get_stats();
+				ImGui::Text("Frame: %.2f ms (avg %.2f, worst %.2f) of %.2f ms budget", frameStats.last_ms, frameStats.average_ms, frameStats.worst_ms, frameStats.budget_ms);
+				ImGui::Text("Over budget: %llu of %llu frames, idle %.0f%%", frameStats.over_budget, frameStats.frames, frameStats.idle * 100.0);
+				ImGui::Checkbox("Frame profiler overlay", &ShowProfiler);
+			}
 		}
 		else if (tab == _tab::memory)
 		{
+			reblox::window::profile_scope profiled(reblox::window::section::memory_tab);
 			static char addrBuf[32];
 			snprintf(addrBuf, sizeof(addrBuf), "0x%llX", reblox::memory::baseReadWriteAddress);
 
@@ -245,19 +434,39 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 				ImGui::Dummy(ImVec2(0, 2));
 			}
 
+			int readType = static_cast<int>(reblox::memory::readWriteType);
+			ImGui::SetNextItemWidth(120);
+			if (ImGui::Combo("Type", &readType, "Float\0Int\0Double\0Unsigned Int\0Uintptr_t\0"))
+			{
+				reblox::memory::readWriteType = static_cast<reblox::memory::ReadWriteType>(readType);
+			}
+
+			ImGui::BeginDisabled(memoryReadPending);
 			if (ImGui::Button("Read"))
 			{
+				memoryReadPending = true;
+				std::vector<uintptr_t> offsets;
+				if (reblox::memory::addOffsets)
+					offsets = reblox::memory::relativeOffsets;
+				ReadValueAsync(reblox::memory::baseReadWriteAddress, std::move(offsets), 0, reblox::memory::readWriteType);
+			}
+			ImGui::EndDisabled();
 
+			if (!memoryReadResult.empty())
+			{
+				sl;
+				ImGui::Text("%s", memoryReadResult.c_str());
 			}
 		}
 		else if (tab == _tab::memoryview)
 		{
+			reblox::window::profile_scope profiled(reblox::window::section::memory_view_tab);
 			ImGui::Text("Memory View");
 			ImGui::Separator();
 
 			// Address input
 			static char addressBuf[32];
-			snprintf(addressBuf, sizeof(addressBuf), "0x%llX", memoryViewAddress);
+			snprintf(addressBuf, sizeof(addressBuf), "0x%llX", memoryView.top_address());
 
 			ImGui::Text("Address:");
 			ImGui::SameLine();
@@ -267,99 +476,38 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 				uint64_t value = 0;
 				if (sscanf_s(addressBuf, "%llx", &value) == 1)
 				{
-					memoryViewAddress = value;
+					memoryView.go_to(value);
 				}
 			}
 
 			ImGui::SameLine();
 			if (ImGui::Button("Refresh"))
 			{
-				ReadMemoryForView(memoryViewAddress, BUFFER_SIZE, memoryViewBuffer);
+				memoryView.refresh();
 			}
 
 			ImGui::SameLine();
 			if (ImGui::Button("Go to Base"))
 			{
-				memoryViewAddress = reblox::memory::state.process_base;
-				ReadMemoryForView(memoryViewAddress, BUFFER_SIZE, memoryViewBuffer);
+				memoryView.go_to(reblox::memory::state.process_base);
 			}
 
-			ImGui::Separator();
-
-			static uint64_t lastAddress = 0;
-			if (memoryViewBuffer.empty() || lastAddress != memoryViewAddress)
-			{
-				ReadMemoryForView(memoryViewAddress, BUFFER_SIZE, memoryViewBuffer);
-				lastAddress = memoryViewAddress;
-			}
+			memoryView.draw_options();
 
-			ImGui::BeginChild("MemoryViewScroll", ImVec2(0, 0), true, ImGuiWindowFlags_HorizontalScrollbar);
-			ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[0]);
-			ImGui::Text("Address           00 01 02 03 04 05 06 07  08 09 0A 0B 0C 0D 0E 0F   ASCII");
 			ImGui::Separator();
 
-			for (size_t row = 0; row < ROWS_TO_DISPLAY; ++row)
-			{
-				uint64_t rowAddress = memoryViewAddress + (row * BYTES_PER_ROW);
-				char hexLine[128] = "";
-				char asciiLine[32] = "";
-				ImGui::Text("%016llX", rowAddress);
-				ImGui::SameLine();
-
-				for (size_t col = 0; col < BYTES_PER_ROW; ++col)
-				{
-					size_t idx = row * BYTES_PER_ROW + col;
-
-					if (idx < memoryViewBuffer.size())
-					{
-						uint8_t byte = memoryViewBuffer[idx];
-
-						// cool spacing
-						if (col == 8)
-							strcat_s(hexLine, " ");
-
-						char hexByte[8];
-						snprintf(hexByte, sizeof(hexByte), " %02X", byte);
-						strcat_s(hexLine, hexByte);
-
-						if (byte >= 32 && byte <= 126)
-							asciiLine[col] = (char)byte;
-						else
-							asciiLine[col] = '.';
-					}
-					else
-					{
-						strcat_s(hexLine, " ??");
-						asciiLine[col] = '?';
-					}
-				}
-
-				asciiLine[BYTES_PER_ROW] = '\0';
-
-				ImGui::SameLine();
-				ImGui::Text("%s", hexLine);
-				ImGui::SameLine();
-				ImGui::Text("  %s", asciiLine);
-			}
-
-			ImGui::PopFont();
-
-			ImGui::EndChild();
+			memoryView.draw();
+		}
+		else if (tab == _tab::scan)
+		{
+			reblox::window::profile_scope profiled(reblox::window::section::scan_tab);
 
-			ImGui::Separator();
-			if (ImGui::Button("Previous Page"))
+			// Double clicking a result opens it in the memory view
+			if (auto opened = scanner.draw())
 			{
-				if (memoryViewAddress >= BUFFER_SIZE)
-				{
-					memoryViewAddress -= BUFFER_SIZE;
-					ReadMemoryForView(memoryViewAddress, BUFFER_SIZE, memoryViewBuffer);
-				}
-			}
-			ImGui::SameLine();
-			if (ImGui::Button("Next Page"))
-			{
-				memoryViewAddress += BUFFER_SIZE;
-				ReadMemoryForView(memoryViewAddress, BUFFER_SIZE, memoryViewBuffer);
+				memoryView.go_to(*opened);
+				memoryViewOpened = true;
+				tab = _tab::memoryview;
 			}
 		}
 
@@ -367,15 +515,23 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 
 		if (ShowProcessPicker)
 		{
-			ImGui::SetNextWindowSize(ImVec2(400, 500), ImGuiCond_FirstUseEver);
+			reblox::window::profile_scope profiled(reblox::window::section::process_picker);
+
+			// The list refreshes in the background
+			reblox::window::frames.live();
+
+			ImGui::SetNextWindowSize(ImVec2(640, 500), ImGuiCond_FirstUseEver);
 			// using if statements if the window is resized to very small or off screen it will show errors
 			//if (ImGui::Begin("Select Process", &ShowProcessPicker))
 			ImGui::Begin("Select Process", &ShowProcessPicker);
 			{
 				static bool autoSelectPending = false;
 				static char searchBuffer[256] = "";
-				static int selectedIndex = -1;
+				static DWORD selectedPid = 0;
+
+				static reblox::gui::process_search processSearch;
 				static char lastSearch[256] = "";
+				auto processSnapshot = reblox::memory::processes.current();
 
 				ImGui::SetNextItemWidth(-1);
 
@@ -413,49 +569,84 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 				//if (ImGui::BeginChild("ProcessList", ImVec2(0, -ImGui::GetFrameHeightWithSpacing() * 2.5f)))
 				ImGui::BeginChild("ProcessList", ImVec2(0, -ImGui::GetFrameHeightWithSpacing() * 2.5f));
 				{
-					std::string searchStr = searchBuffer;
-					std::transform(searchStr.begin(), searchStr.end(), searchStr.begin(), ::tolower);
+					processSearch.update(processSnapshot, searchBuffer);
+					auto& results = processSearch.results();
 
 					if (autoSelectPending)
 					{
-						int firstVisibleIndex = -1;
-						for (int n = 0; n < ProcessList.size(); n++)
-						{
-							std::string name = reblox::memory::WStringToString(ProcessList[n].szExeFile);
-							std::string lowerName = name;
-							std::transform(lowerName.begin(), lowerName.end(), lowerName.begin(), ::tolower);
-
-							if (searchStr.empty() || lowerName.find(searchStr) != std::string::npos)
-							{
-								firstVisibleIndex = n;
-								break;
-							}
-						}
-
-						if (firstVisibleIndex != -1)
-							selectedIndex = firstVisibleIndex;
+						if (!results.empty())
+							selectedPid = results.front().process->pid;
 
 						autoSelectPending = false;
 					}
 
-					for (int n = 0; n < ProcessList.size(); n++)
-					{
-						std::string name = reblox::memory::WStringToString(ProcessList[n].szExeFile);
-						std::string lowerName = name;
-						std::transform(lowerName.begin(), lowerName.end(), lowerName.begin(), ::tolower);
+					// only the rows on screen get submitted, and only those get their details fetched
+					reblox::memory::details_cache.prune(*processSnapshot);
+					reblox::memory::details_cache.begin_frame();
 
-						if (searchStr.empty() || lowerName.find(searchStr) != std::string::npos)
+					if (ImGui::BeginTable("##Processes", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp))
+					{
+						ImGui::TableSetupColumn("Process", ImGuiTableColumnFlags_WidthStretch);
+						ImGui::TableSetupColumn("Working Set", ImGuiTableColumnFlags_WidthFixed, 80);
+						ImGui::TableSetupColumn("Arch", ImGuiTableColumnFlags_WidthFixed, 35);
+						ImGui::TableSetupColumn("Modules", ImGuiTableColumnFlags_WidthFixed, 55);
+						ImGui::TableSetupColumn("Parent", ImGuiTableColumnFlags_WidthFixed, 50);
+						ImGui::TableHeadersRow();
+
+						ImGuiListClipper clipper;
+						clipper.Begin(static_cast<int>(results.size()));
+						while (clipper.Step())
 						{
-							bool isSelected = (selectedIndex == n);
-							if (ImGui::Selectable((name + " (PID: " + std::to_string(ProcessList[n].th32ProcessID) + ")").c_str(), isSelected))
+							for (int n = clipper.DisplayStart; n < clipper.DisplayEnd; n++)
 							{
-								selectedIndex = n;
+								auto process = results[n].process;
+								bool isSelected = (selectedPid == process->pid);
+
+								ImGui::TableNextRow();
+								ImGui::TableNextColumn();
+								if (ImGui::Selectable(process->label.c_str(), isSelected, ImGuiSelectableFlags_SpanAllColumns))
+								{
+									selectedPid = process->pid;
+								}
+
+								// I don't like this because its buggy :(
+								//if (isSelected)
+								//	ImGui::SetScrollHereY();
+
+								reblox::memory::process_details details;
+								if (!reblox::memory::details_cache.get(*process, details))
+								{
+									for (int column = 0; column < 4; column++)
+									{
+										ImGui::TableNextColumn();
+										ImGui::TextDisabled("...");
+									}
+								}
+								else if (!details.accessible)
+								{
+									for (int column = 0; column < 3; column++)
+									{
+										ImGui::TableNextColumn();
+										ImGui::TextDisabled("-");
+									}
+									ImGui::TableNextColumn();
+									ImGui::Text("%lu", details.parent_pid);
+								}
+								else
+								{
+									ImGui::TableNextColumn();
+									ImGui::Text("%.1f MB", details.working_set / (1024.0 * 1024.0));
+									ImGui::TableNextColumn();
+									ImGui::TextUnformatted(details.wow64 ? "x86" : "x64");
+									ImGui::TableNextColumn();
+									ImGui::Text("%u", details.module_count);
+									ImGui::TableNextColumn();
+									ImGui::Text("%lu", details.parent_pid);
+								}
 							}
-
-							// I don't like this because its buggy :(
-							//if (isSelected)
-							//	ImGui::SetScrollHereY();
 						}
+
+						ImGui::EndTable();
 					}
 
 					ImGui::EndChild();
@@ -463,11 +654,12 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 
 				ImGui::SetCursorPosY(ImGui::GetCursorPosY() + bottomPadding);
 				ImGui::Separator();
-				if ((ImGui::Button("Attach (Alt + A)") || reblox::gui_shortcuts::attachShortcutPressed) && selectedIndex != -1)
+				if ((ImGui::Button("Attach (Alt + A)") || reblox::gui_shortcuts::attachShortcutPressed) && selectedPid != 0)
 				{
 					reblox::gui_shortcuts::attachShortcutPressed = false;
 
-					if (reblox::memory::attach_to_process(ProcessList[selectedIndex].szExeFile))
+					std::int32_t pid = static_cast<std::int32_t>(selectedPid);
+					if (RecordSession ? reblox::memory::attach_to_process_recorded(pid, SessionTracePath(pid)) : reblox::memory::attach_to_process(pid))
 					{
 						ShowProcessPicker = false;
 					}
@@ -480,6 +672,8 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 					}
 				}
 				ImGui::SameLine();
+				ImGui::Checkbox("Record session", &RecordSession);
+				ImGui::SameLine();
 				// Is this nesseccary we have the X button
 				/*if (ImGui::Button("Cancel"))
 				{
@@ -488,19 +682,36 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 				ImGui::SameLine();*/
 				if (ImGui::Button("Refresh List"))
 				{
-					ProcessList = reblox::memory::get_processes();
+					reblox::memory::processes.refresh();
 				}
 				ImGui::End();
 			}
 		}
 
+		if (ShowDiagnostics)
+		{
+			reblox::window::profile_scope profiled(reblox::window::section::diagnostics);
+			ImGui::SetNextWindowSize(ImVec2(560, 620), ImGuiCond_FirstUseEver);
+			diagnostics.draw(&ShowDiagnostics);
+		}
+
+		if (ShowProfiler)
+		{
+			reblox::window::profiler.draw_overlay(&ShowProfiler);
+		}
+
 		// Rendering
 		ImGui::Render();
 		const float clear_color[4] = { 0.45f, 0.55f, 0.60f, 1.00f };
 		g_pd3dDeviceContext->OMSetRenderTargets(1, &g_mainRenderTargetView, NULL);
 		g_pd3dDeviceContext->ClearRenderTargetView(g_mainRenderTargetView, clear_color);
-		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+		{
+			reblox::window::profile_scope profiled(reblox::window::section::render);
+			ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+		}
 
+		reblox::window::frames.end_frame();
+		reblox::window::profiler.end_frame(reblox::window::frames.get_stats().last_ms);
 		g_pSwapChain->Present(1, 0); // Vsync
 	}
 
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "../cli/commands.h"
+#include "harness.h"
+#include "suite.h"
+
+namespace reblox::bench {
+	inline auto usage( void ) -> int {
+		std::fputs(
+			"usage: reblox-bench <target> [--filter name] [--samples n] [--min-ms ms] [--seed n]\n"
+			"                    [--format json] [--out file] [--save baseline.txt] [--compare baseline.txt] [--threshold percent]\n"
+			"targets:\n"
+			"  --snapshot <file.rbxs> | --dump <file.dmp> | --pid <pid> | --process <name.exe>\n"
+			"  --replay <file.rbxt>    a recorded session (--latency to wait out the recorded read costs)\n"
+			"  --synthetic <heap MiB>  generated target, checked against its ground truth before anything is timed\n"
+			"                          (--seed picks both the target and the samples, --types, --chains, --elements)\n"
+			"results go to stderr as they finish, --format json writes them to stdout (or --out) at the end.\n"
+			"--compare exits with 2 if anything got slower than the threshold (default 10%) beyond the noise,\n"
+			"a synthetic target that doesn't verify exits with 3. --stats <file> writes the engine's counters and\n"
+			"latency percentiles over the timed runs as JSON, --timeline <file> the runs as a trace (.json for\n"
+			"chrome://tracing, anything else perfetto)\n",
+			stderr);
+		return 1;
+	}
+
+	inline auto run( int argc, char** argv ) -> int {
+		cli::arguments args = cli::parse_arguments(argc, argv);
+		if (args.has("help"))
+			return usage();
+
+		if (!cli::attach(args)) {
+			std::fputs("reblox-bench: couldn't open the target\n", stderr);
+			return usage();
+		}
+
+		options config;
+		config.samples = static_cast<std::size_t>((std::max)(args.number("samples", config.samples), std::uint64_t(1)));
+		config.min_sample_ms = static_cast<double>(args.number("min-ms", static_cast<std::uint64_t>(config.min_sample_ms)));
+		if (auto filter = args.flag("filter"))
+			config.filter = *filter;
+
+		std::string target = args.flag("snapshot") ? *args.flag("snapshot") : args.flag("dump") ? *args.flag("dump") : args.flag("replay") ? *args.flag("replay") : "live";
+		if (args.has("synthetic"))
+			target = "synthetic:" + std::to_string(cli::synthetic_config(args).heap_bytes >> 20) + "MiB:" + std::to_string(cli::synthetic_config(args).seed);
+		std::fprintf(stderr, "target %s, %zu regions, %zu modules\n", target.c_str(), memory::regions.all().size(), memory::modules.current()->modules.size());
+
+		// numbers from an engine that reads the wrong thing are worthless, so a synthetic run proves it first
+		if (auto generated = memory::synthetic::attached_target()) {
+			int failed = 0;
+			for (auto& entry : cli::verify_synthetic(generated->get_truth())) {
+				if (!entry.passed) {
+					std::fprintf(stderr, "verify %-24s FAILED  %s\n", entry.name.c_str(), entry.detail.c_str());
+					failed++;
+				}
+			}
+			if (failed) {
+				memory::detach_from_process();
+				return 3;
+			}
+			std::fputs("verified against the synthetic truth\n", stderr);
+		}
+
+		fixture data = build_fixture(args.number("seed", 1));
+		runner bench(config);
+		memory::stats::engine.reset();
+		memory::timeline::engine.name_thread("bench");
+		if (args.has("timeline"))
+			memory::timeline::engine.start();
+		run_suite(bench, data);
+
+		if (auto path = args.flag("stats"); path && !cli::write_stats(*path))
+			std::fputs("reblox-bench: can't write the stats file\n", stderr);
+		if (auto path = args.flag("timeline"); path && !cli::write_timeline(*path))
+			std::fputs("reblox-bench: can't write the timeline file\n", stderr);
+
+		if (auto replay = memory::attached_replay()) {
+			auto served = replay->get_counters();
+			std::fprintf(stderr, "replay: %llu reads, %llu bytes, %llu misses\n", static_cast<unsigned long long>(served.reads), static_cast<unsigned long long>(served.bytes), static_cast<unsigned long long>(served.misses));
+		}
+
+		int ret = 0;
+		if (auto format = args.flag("format"); format && *format == "json") {
+			std::FILE* out = stdout;
+			if (auto path = args.flag("out"))
+				out = std::fopen(path->c_str(), "w");
+			if (out) {
+				write_json(out, target, bench.results());
+				if (out != stdout)
+					std::fclose(out);
+			}
+		}
+
+		if (auto path = args.flag("save"); path && !save_baseline(*path, bench.results()))
+			ret = 1;
+
+		if (auto path = args.flag("compare")) {
+			int regressions = compare_baseline(*path, bench.results(), static_cast<double>(args.number("threshold", 10)) / 100);
+			if (regressions)
+				ret = regressions < 0 ? 1 : 2;
+		}
+
+		memory::detach_from_process();
+		return ret;
+	}
+}
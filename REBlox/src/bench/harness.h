@@ -0,0 +1,204 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tuple>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include "../cli/output.h"
+
+namespace reblox::bench {
+	// bodies return something derived from their work and it all lands here, so the optimizer can't drop them
+	inline volatile std::uint64_t sink = 0;
+
+	struct options {
+		std::size_t samples = 10;
+		double min_sample_ms = 20; // iterations per sample are scaled up until a sample takes at least this long
+		std::string filter; // substring of the benchmark name, empty runs everything
+	};
+
+	struct result {
+		std::string name;
+		std::uint64_t items; // per iteration, whatever the benchmark counts (pages, rows, objects)
+		std::uint64_t bytes; // per iteration, 0 if throughput in bytes doesn't mean anything for it
+		std::size_t iterations; // per sample
+		std::size_t samples;
+		double median_ns; // per iteration
+		double p10_ns;
+		double p90_ns;
+		double mad_ns; // median absolute deviation, the noise figure regressions are judged against
+
+		auto items_per_second( void ) const -> double {
+			return median_ns > 0 ? items * 1e9 / median_ns : 0;
+		}
+
+		auto megabytes_per_second( void ) const -> double {
+			return median_ns > 0 ? bytes * 1e9 / median_ns / (1024.0 * 1024.0) : 0;
+		}
+	};
+
+	// robust statistics over per-iteration sample times. medians and MAD instead of mean and stddev because
+	// a single page fault or context switch in one sample shouldn't move the number we compare on
+	inline auto summarize( std::vector<double> times ) -> std::tuple<double, double, double, double> {
+		if (times.empty())
+			return { 0, 0, 0, 0 };
+
+		std::sort(times.begin(), times.end());
+		auto rank = [&](double q) { return times[static_cast<std::size_t>(std::round(q * (times.size() - 1)))]; };
+		double median = rank(0.5);
+
+		std::vector<double> deviations(times.size());
+		for (std::size_t i = 0; i < times.size(); i++)
+			deviations[i] = std::abs(times[i] - median);
+		std::sort(deviations.begin(), deviations.end());
+
+		return { median, rank(0.1), rank(0.9), deviations[deviations.size() / 2] };
+	}
+
+	class runner {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		explicit runner( options config ) : config(std::move(config)) {}
+
+		auto enabled( std::string_view name ) const -> bool {
+			return config.filter.empty() || name.find(config.filter) != std::string_view::npos;
+		}
+
+		// times body, which returns a value for the sink. reset (optional) runs untimed before every iteration
+		// to put state back, e.g. drop a cache for a cold path; with one every iteration is timed on its own
+		auto run( std::string_view name, std::uint64_t items, std::uint64_t bytes, const std::function<std::uint64_t( void )>& body, const std::function<void( void )>& reset = nullptr ) -> void {
+			if (!enabled(name))
+				return;
+
+			// warm up and calibrate off the same run
+			if (reset)
+				reset();
+			auto started = clock::now();
+			sink = sink + body();
+			double single_ms = std::chrono::duration<double, std::milli>(clock::now() - started).count();
+
+			std::size_t iterations = single_ms >= config.min_sample_ms ? 1 : static_cast<std::size_t>(config.min_sample_ms / (std::max)(single_ms, 1e-6)) + 1;
+			iterations = (std::min)(iterations, static_cast<std::size_t>(1) << 20);
+
+			std::vector<double> times;
+			times.reserve(config.samples);
+			for (std::size_t sample = 0; sample < config.samples; sample++) {
+				double total_ns = 0;
+				if (reset) {
+					for (std::size_t i = 0; i < iterations; i++) {
+						reset();
+						auto begin = clock::now();
+						sink = sink + body();
+						total_ns += std::chrono::duration<double, std::nano>(clock::now() - begin).count();
+					}
+				}
+				else {
+					auto begin = clock::now();
+					for (std::size_t i = 0; i < iterations; i++)
+						sink = sink + body();
+					total_ns = std::chrono::duration<double, std::nano>(clock::now() - begin).count();
+				}
+				times.push_back(total_ns / iterations);
+			}
+
+			auto [median, p10, p90, mad] = summarize(std::move(times));
+			result& entry = entries.emplace_back(result{ std::string(name), items, bytes, iterations, config.samples, median, p10, p90, mad });
+			print(entry);
+		}
+
+		auto results( void ) const -> const std::vector<result>& {
+			return entries;
+		}
+
+		// one line per benchmark to stderr as it finishes, stdout is left to --format json
+		static auto print( const result& entry ) -> void {
+			std::fprintf(stderr, "%-32s %12.1f us  p10 %10.1f  p90 %10.1f  mad %5.1f%%", entry.name.c_str(), entry.median_ns / 1000, entry.p10_ns / 1000, entry.p90_ns / 1000, entry.median_ns > 0 ? entry.mad_ns * 100 / entry.median_ns : 0);
+			if (entry.bytes)
+				std::fprintf(stderr, "  %10.1f MiB/s", entry.megabytes_per_second());
+			else if (entry.items)
+				std::fprintf(stderr, "  %10.0f /s", entry.items_per_second());
+			std::fputc('\n', stderr);
+		}
+
+	private:
+		options config;
+		std::vector<result> entries;
+	};
+
+	inline auto write_json( std::FILE* out, std::string_view target, const std::vector<result>& results ) -> void {
+		cli::json_writer json(out);
+		json.begin_object();
+		json.field("target", target);
+		json.key("results");
+		json.begin_array();
+		for (auto& entry : results) {
+			json.begin_object();
+			json.field("name", std::string_view(entry.name));
+			json.field("iterations", static_cast<std::uint64_t>(entry.iterations));
+			json.field("samples", static_cast<std::uint64_t>(entry.samples));
+			json.field("median_ns", entry.median_ns);
+			json.field("p10_ns", entry.p10_ns);
+			json.field("p90_ns", entry.p90_ns);
+			json.field("mad_ns", entry.mad_ns);
+			json.field("items", entry.items);
+			json.field("bytes", entry.bytes);
+			json.field("items_per_second", entry.items_per_second());
+			json.field("mib_per_second", entry.megabytes_per_second());
+			json.end_object();
+		}
+		json.end_array();
+		json.end_object();
+		json.finish();
+	}
+
+	// baselines are "name median_ns mad_ns" lines, trivially diffable and easy to keep next to a build
+	inline auto save_baseline( const std::string& path, const std::vector<result>& results ) -> bool {
+		std::ofstream file(path, std::ios::trunc);
+		for (auto& entry : results)
+			file << entry.name << ' ' << entry.median_ns << ' ' << entry.mad_ns << '\n';
+		return file.good();
+	}
+
+	// a benchmark regressed if its median is more than threshold slower than the baseline and the shift is
+	// well outside both runs' noise. returns the number of regressions, the table goes to stderr
+	inline auto compare_baseline( const std::string& path, const std::vector<result>& results, double threshold ) -> int {
+		std::ifstream file(path);
+		if (!file) {
+			std::fprintf(stderr, "bench: can't read baseline %s\n", path.c_str());
+			return -1;
+		}
+
+		std::unordered_map<std::string, std::pair<double, double>> baseline;
+		std::string line;
+		while (std::getline(file, line)) {
+			std::istringstream fields(line);
+			std::string name;
+			double median = 0, mad = 0;
+			if (fields >> name >> median >> mad)
+				baseline[name] = { median, mad };
+		}
+
+		int regressions = 0;
+		std::fputs("\ncompared to baseline:\n", stderr);
+		for (auto& entry : results) {
+			auto it = baseline.find(entry.name);
+			if (it == baseline.end() || it->second.first <= 0)
+				continue;
+
+			auto [base_median, base_mad] = it->second;
+			double change = (entry.median_ns - base_median) / base_median;
+			bool regressed = change > threshold && entry.median_ns - base_median > 3 * (std::max)(entry.mad_ns, base_mad);
+			regressions += regressed;
+			std::fprintf(stderr, "%-32s %+7.1f%%%s\n", entry.name.c_str(), change * 100, regressed ? "  REGRESSED" : "");
+		}
+		return regressions;
+	}
+}
@@ -0,0 +1,290 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <string>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include "../memory/memory.h"
+#include "../memory/modules.h"
+#include "../memory/regions.h"
+#include "../memory/page_cache.h"
+#include "../memory/read_engine.h"
+#include "../memory/pointers.h"
+#include "../memory/batch.h"
+#include "../memory/scan.h"
+#include "../memory/pointer_scan.h"
+#include "../window/gui/hex_format.h"
+#include "harness.h"
+
+namespace reblox::bench {
+	// everything the benchmarks sample from, picked once per target with a fixed seed so two runs against the
+	// same snapshot measure exactly the same work
+	struct fixture {
+		std::vector<std::uint64_t> pages; // random readable pages
+		std::vector<std::uint64_t> qwords; // random aligned addresses in writable memory
+		std::vector<std::uint64_t> values; // qwords as they sit in writable memory, for the classifier
+		std::vector<std::uint64_t> objects; // addresses holding a vfptr the census resolved
+		std::vector<std::string> mangled; // type names the census found
+		std::vector<std::uint8_t> rows; // real bytes for the hex formatter
+		std::string signature; // taken out of the code so it hits
+		std::uint64_t path_target = 0;
+
+		std::uint64_t readable_bytes = 0;
+		std::uint64_t writable_bytes = 0;
+		std::uint64_t executable_bytes = 0;
+	};
+
+	inline constexpr std::size_t sample_pages = 256;
+	inline constexpr std::size_t sample_qwords = 4096;
+	inline constexpr std::size_t sample_objects = 4096;
+	inline constexpr std::size_t sample_rows = 256; // 16 bytes each, a tall hex view
+
+	// a uniformly random page out of the regions that pass keep, weighted by size
+	template <typename keep_t>
+	inline auto random_pages( std::mt19937_64& rng, std::size_t count, keep_t&& keep ) -> std::vector<std::uint64_t> {
+		std::vector<const memory::memory_region*> picked;
+		std::vector<std::uint64_t> offsets; // running page count before each picked region
+		std::uint64_t total = 0;
+		for (auto& region : memory::regions.all()) {
+			if (region.readable() && keep(region)) {
+				picked.push_back(&region);
+				offsets.push_back(total);
+				total += region.size / memory::page_size;
+			}
+		}
+
+		std::vector<std::uint64_t> ret;
+		if (!total)
+			return ret;
+
+		std::uniform_int_distribution<std::uint64_t> page(0, total - 1);
+		for (std::size_t i = 0; i < count; i++) {
+			std::uint64_t at = page(rng);
+			std::size_t index = std::upper_bound(offsets.begin(), offsets.end(), at) - offsets.begin() - 1;
+			ret.push_back(picked[index]->base + (at - offsets[index]) * memory::page_size);
+		}
+		return ret;
+	}
+
+	inline auto build_fixture( std::uint64_t seed ) -> fixture {
+		fixture ret;
+		std::mt19937_64 rng(seed);
+
+		for (auto& region : memory::regions.all()) {
+			if (!region.readable())
+				continue;
+			ret.readable_bytes += region.size;
+			if (region.writable())
+				ret.writable_bytes += region.size;
+			if (region.executable())
+				ret.executable_bytes += region.size;
+		}
+
+		ret.pages = random_pages(rng, sample_pages, [](const memory::memory_region&) { return true; });
+
+		auto writable = random_pages(rng, sample_qwords / 64, [](const memory::memory_region& region) { return region.writable(); });
+		std::uniform_int_distribution<std::uint64_t> slot(0, memory::page_size / sizeof(std::uint64_t) - 1);
+		std::vector<std::uint64_t> page_values(memory::page_size / sizeof(std::uint64_t));
+		for (auto page : writable) {
+			for (int i = 0; i < 64; i++)
+				ret.qwords.push_back(page + slot(rng) * sizeof(std::uint64_t));
+			if (memory::read_bytes(page, page_values.data(), memory::page_size))
+				ret.values.insert(ret.values.end(), page_values.begin(), page_values.end());
+		}
+
+		if (!ret.pages.empty()) {
+			ret.rows.resize(sample_rows * 16);
+			for (std::size_t i = 0; i < ret.rows.size(); i += memory::page_size)
+				memory::read_bytes(ret.pages[(i / memory::page_size) % ret.pages.size()], ret.rows.data() + i, (std::min)(memory::page_size, ret.rows.size() - i));
+		}
+
+		// objects of the most common types, the shape of a real "what is on this heap" request
+		auto census = memory::rtti_census(2);
+		for (std::size_t i = 0; i < census.size() && ret.objects.size() < sample_objects; i++) {
+			ret.mangled.push_back(census[i].mangled);
+
+			memory::scan_options options;
+			options.writable_only = true;
+			auto hits = memory::scan_value(census[i].vfptr, options);
+			std::size_t take = (std::min)(hits.size(), sample_objects - ret.objects.size());
+			ret.objects.insert(ret.objects.end(), hits.begin(), hits.begin() + take);
+		}
+		std::shuffle(ret.objects.begin(), ret.objects.end(), rng);
+		memory::rtti::vtables.clear();
+
+		if (!ret.objects.empty())
+			ret.path_target = ret.objects.front() + 0x10;
+
+		// 16 bytes out of the middle of the largest code region, with what would be a rip relative
+		// displacement wildcarded the way a hand written signature would have it
+		const memory::memory_region* code = nullptr;
+		for (auto& region : memory::regions.all()) {
+			if (region.readable() && region.executable() && (!code || region.size > code->size))
+				code = &region;
+		}
+		std::uint8_t bytes[16];
+		if (code && memory::read_bytes(code->base + code->size / 2, bytes, sizeof(bytes))) {
+			char text[4];
+			for (std::size_t i = 0; i < sizeof(bytes); i++) {
+				if (i >= 3 && i < 7)
+					ret.signature += "?? ";
+				else {
+					snprintf(text, sizeof(text), "%02X ", bytes[i]);
+					ret.signature += text;
+				}
+			}
+		}
+
+		return ret;
+	}
+
+	// pulls pages into the page cache through the read engine the way the hex view does, a frame at a time
+	inline auto prime_page_cache( std::span<const std::uint64_t> addresses ) -> void {
+		memory::pages.clear();
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		for (auto page : addresses) {
+			while (!memory::pages.find(page) && std::chrono::steady_clock::now() < deadline) {
+				memory::pages.request(page, memory::page_cache::priority::visible);
+				if (!memory::reads.drain())
+					std::this_thread::yield();
+			}
+		}
+	}
+
+	inline auto run_suite( runner& bench, const fixture& data ) -> void {
+		using namespace memory;
+
+		// reads, straight to the backend and through the batching layers on top of it
+		bench.run("read/page", data.pages.size(), data.pages.size() * page_size, [&] {
+			std::uint8_t buffer[page_size];
+			std::uint64_t ok = 0;
+			for (auto page : data.pages)
+				ok += read_bytes(page, buffer, sizeof(buffer));
+			return ok;
+		});
+
+		std::vector<std::uint64_t> qword_values(data.qwords.size());
+		bench.run("read/scatter_qwords", data.qwords.size(), data.qwords.size() * sizeof(std::uint64_t), [&] {
+			std::vector<scatter_read> reads;
+			reads.reserve(data.qwords.size());
+			for (std::size_t i = 0; i < data.qwords.size(); i++)
+				reads.push_back({ data.qwords[i], &qword_values[i], sizeof(std::uint64_t), false });
+			return static_cast<std::uint64_t>(read_scatter(reads));
+		});
+
+		bench.run("read/engine_pages", data.pages.size(), data.pages.size() * page_size, [&] {
+			std::size_t landed = 0;
+			for (auto page : data.pages)
+				reads.submit(page, page_size, [&](read_result&) { landed++; });
+			while (landed < data.pages.size()) {
+				if (!reads.drain())
+					std::this_thread::yield();
+			}
+			return static_cast<std::uint64_t>(landed);
+		});
+
+		// the hex view's per frame path once everything is cached
+		std::vector<std::uint64_t> cached(data.pages.begin(), data.pages.begin() + (std::min)(data.pages.size(), page_cache::capacity / 2));
+		if (bench.enabled("page_cache/")) {
+			prime_page_cache(cached);
+			bench.run("page_cache/hit", cached.size(), 0, [&] {
+				std::uint64_t sum = 0;
+				for (auto page : cached) {
+					if (auto hit = pages.find(page))
+						sum += hit->data[0];
+				}
+				return sum;
+			});
+			pages.clear();
+		}
+
+		// hex rows, one benchmark per column type since they take different paths
+		const std::pair<const char*, gui::column_type> columns[] = {
+			{ "hex/rows_u8", gui::column_type::u8 },
+			{ "hex/rows_u32", gui::column_type::u32 },
+			{ "hex/rows_u64", gui::column_type::u64 },
+			{ "hex/rows_f32", gui::column_type::f32 },
+			{ "hex/rows_f64", gui::column_type::f64 },
+		};
+		for (auto [name, type] : columns) {
+			if (data.rows.empty())
+				break;
+
+			gui::row_formatter formatter;
+			formatter.configure({ 16, 8, type });
+			bench.run(name, sample_rows, sample_rows * 16, [&] {
+				char line[gui::row_formatter::max_width];
+				std::uint64_t chars = 0;
+				for (std::size_t i = 0; i < sample_rows; i++)
+					chars += formatter.row(line, 0x7FF600000000 + i * 16, data.rows.data() + i * 16) + line[20];
+				return chars;
+			});
+		}
+
+		if (!data.values.empty()) {
+			std::vector<pointer_class> classes(data.values.size());
+			pointers.classify(data.values, classes); // first call builds the index
+			bench.run("pointers/classify", data.values.size(), 0, [&] {
+				pointers.classify(data.values, classes);
+				return static_cast<std::uint64_t>(classes[0].kind) + static_cast<std::uint64_t>(classes.back().kind);
+			});
+		}
+
+		// scans, each one pass over its share of the target
+		memory::scan_options writable;
+		writable.writable_only = true;
+		bench.run("scan/value_u8", 0, data.writable_bytes, [&] { return scan_value<std::uint8_t>(0xCC, writable).size(); });
+		bench.run("scan/value_u16", 0, data.writable_bytes, [&] { return scan_value<std::uint16_t>(0xBEEF, writable).size(); });
+		bench.run("scan/value_u32", 0, data.writable_bytes, [&] { return scan_value<std::uint32_t>(0xDEADBEEF, writable).size(); });
+		bench.run("scan/value_u64", 0, data.writable_bytes, [&] { return scan_value<std::uint64_t>(0x00007FF600001000, writable).size(); });
+		bench.run("scan/value_f32", 0, data.writable_bytes, [&] { return scan_value<float>(100.0f, writable).size(); });
+		bench.run("scan/value_f64", 0, data.writable_bytes, [&] { return scan_value<double>(1.0, writable).size(); });
+
+		if (auto sig = parse_signature(data.signature)) {
+			memory::scan_options code;
+			code.executable_only = true;
+			bench.run("scan/signature", 0, data.executable_bytes, [&] { return scan_signature(*sig, code).size(); });
+		}
+
+		pointer_map map;
+		bench.run("pointers/map_build", 0, data.readable_bytes, [&] { return static_cast<std::uint64_t>(map.build()); });
+		if (data.path_target && map.size()) {
+			pointer_search search;
+			search.max_depth = 3;
+			bench.run("pointers/path_search", 1, 0, [&] { return static_cast<std::uint64_t>(find_pointer_paths(map, data.path_target, search).size()); });
+		}
+
+		// RTTI: cold walks every COL and TypeDescriptor, warm is the vtable cache answering
+		if (!data.objects.empty()) {
+			bench.run("rtti/identify_serial_cold", data.objects.size(), 0, [&] {
+				std::uint64_t found = 0;
+				for (auto object : data.objects)
+					found += !rtti::get_mangled_object_name(object).empty();
+				return found;
+			}, [] { rtti::vtables.clear(); });
+
+			bench.run("rtti/identify_batched_cold", data.objects.size(), 0, [&] {
+				return static_cast<std::uint64_t>(rtti::get_mangled_object_names(data.objects).size());
+			}, [] { rtti::vtables.clear(); });
+
+			bench.run("rtti/identify_batched_warm", data.objects.size(), 0, [&] {
+				return static_cast<std::uint64_t>(rtti::get_mangled_object_names(data.objects).size());
+			});
+		}
+
+		if (!data.mangled.empty()) {
+			bench.run("rtti/demangle", data.mangled.size(), 0, [&] {
+				std::uint64_t length = 0;
+				for (auto& name : data.mangled)
+					length += rtti::demangle_msvc_rtti(name).size();
+				return length;
+			});
+		}
+
+		bench.run("rtti/census", 0, data.writable_bytes, [&] { return static_cast<std::uint64_t>(rtti_census(1).size()); }, [] { rtti::vtables.clear(); });
+	}
+}
@@ -0,0 +1,673 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <type_traits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <filesystem>
+#include <unordered_map>
+#include <io.h>
+#include <fcntl.h>
+#include "../memory/memory.h"
+#include "../memory/attach.h"
+#include "../memory/sources.h"
+#include "../memory/scan.h"
+#include "../memory/pointer_scan.h"
+#include "../memory/synthetic.h"
+#include "../memory/trace.h"
+#include "output.h"
+#include "verify.h"
+
+namespace reblox::cli {
+	enum struct output_format {
+		json,
+		binary
+	};
+
+	// reblox-cli <target> <command> [arguments] [--flag value ...]
+	struct arguments {
+		std::vector<std::string> positional; // command first
+		std::unordered_map<std::string, std::string> flags; // without the dashes
+
+		auto flag( const std::string& name ) const -> const std::string* {
+			auto it = flags.find(name);
+			return it == flags.end() ? nullptr : &it->second;
+		}
+
+		auto has( const std::string& name ) const -> bool {
+			return flags.contains(name);
+		}
+
+		// "0x" prefixed hex, or decimal. fallback if the flag is missing or doesn't parse
+		auto number( const std::string& name, std::uint64_t fallback ) const -> std::uint64_t {
+			const std::string* text = flag(name);
+			if (!text || text->empty())
+				return fallback;
+
+			char* end = nullptr;
+			std::uint64_t ret = std::strtoull(text->c_str(), &end, 0);
+			return *end ? fallback : ret;
+		}
+	};
+
+	// flags that don't take a value
+	inline constexpr std::string_view switches[] = { "all", "help", "latency" };
+
+	inline auto parse_arguments( int argc, char** argv ) -> arguments {
+		arguments ret;
+		for (int i = 1; i < argc; i++) {
+			std::string_view arg = argv[i];
+			if (arg.size() > 2 && arg.starts_with("--")) {
+				std::string name(arg.substr(2));
+				bool is_switch = std::find(std::begin(switches), std::end(switches), name) != std::end(switches);
+				ret.flags[name] = !is_switch && i + 1 < argc ? argv[++i] : "";
+				continue;
+			}
+			ret.positional.emplace_back(arg);
+		}
+		return ret;
+	}
+
+	// addresses are always hex, with or without the 0x
+	inline auto parse_address( std::string_view text ) -> std::optional<std::uint64_t> {
+		if (text.starts_with("0x") || text.starts_with("0X"))
+			text.remove_prefix(2);
+		if (text.empty() || text.size() > 16)
+			return std::nullopt;
+
+		std::string copy(text);
+		char* end = nullptr;
+		std::uint64_t ret = std::strtoull(copy.c_str(), &end, 16);
+		return *end ? std::nullopt : std::optional(ret);
+	}
+
+	class context {
+	public:
+		context( std::FILE* out, output_format format ) : json(out), binary(out), format(format) {}
+
+		json_writer json;
+		binary_writer binary;
+		output_format format;
+
+		auto elapsed_ms( void ) const -> double {
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+		}
+
+		// the fields every JSON result starts with, so scripts can compare throughput across runs
+		auto begin_result( std::string_view command, std::uint64_t scanned ) -> void {
+			json.begin_object();
+			json.field("command", command);
+			json.field("elapsed_ms", elapsed_ms());
+			json.field("bytes_scanned", scanned);
+		}
+
+	private:
+		std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+	};
+
+	inline auto fail( const char* message ) -> int {
+		std::fprintf(stderr, "reblox-cli: %s\n", message);
+		return 1;
+	}
+
+	// --stats <file>: the engine's counters and latency percentiles over the whole run
+	inline auto write_stats( const std::string& path ) -> bool {
+		std::FILE* out = std::fopen(path.c_str(), "w");
+		if (!out)
+			return false;
+
+		auto report = memory::stats::engine.take();
+		json_writer json(out);
+		json.begin_object();
+		json.field("seconds", report.seconds);
+		json.key("counters");
+		json.begin_object();
+		for (std::size_t i = 0; i < memory::stats::counter_count; i++)
+			json.field(memory::stats::counter_names[i], report.counters[i]);
+		json.end_object();
+
+		using counter = memory::stats::counter;
+		json.field("page_cache_hit_rate", report.ratio(counter::page_cache_hits, counter::page_cache_misses));
+		json.field("vtable_cache_hit_rate", report.ratio(counter::vtable_cache_hits, counter::vtable_cache_misses));
+
+		json.key("timers");
+		json.begin_object();
+		for (std::size_t i = 0; i < memory::stats::timer_count; i++) {
+			auto& histogram = report.timers[i];
+			json.key(memory::stats::timer_names[i]);
+			json.begin_object();
+			json.field("count", histogram.count);
+			json.field("mean_us", histogram.mean_ns() / 1e3);
+			json.field("p50_us", histogram.percentile(0.5) / 1e3);
+			json.field("p90_us", histogram.percentile(0.9) / 1e3);
+			json.field("p99_us", histogram.percentile(0.99) / 1e3);
+			json.field("max_us", histogram.max_ns / 1e3);
+			json.end_object();
+		}
+		json.end_object();
+		json.end_object();
+		json.finish();
+		return std::fclose(out) == 0;
+	}
+
+	// --timeline <file>: everything recorded since start(), .json for chrome://tracing, anything else perfetto
+	inline auto write_timeline( const std::string& path ) -> bool {
+		memory::timeline::engine.stop();
+		auto events = memory::timeline::engine.collect();
+		if (events.dropped)
+			std::fprintf(stderr, "timeline: %llu events overwritten before they were written\n", static_cast<unsigned long long>(events.dropped));
+		return memory::timeline::write(events, path);
+	}
+
+	// --synthetic <MiB of heap> [--seed n] [--types n] [--chains n] [--elements n]
+	inline auto synthetic_config( const arguments& args ) -> memory::synthetic::config {
+		memory::synthetic::config ret;
+		ret.heap_bytes = args.number("synthetic", ret.heap_bytes >> 20) << 20;
+		ret.seed = args.number("seed", ret.seed);
+		ret.types = static_cast<std::uint32_t>(args.number("types", ret.types));
+		ret.chains = static_cast<std::uint32_t>(args.number("chains", ret.chains));
+		ret.elements = static_cast<std::uint32_t>(args.number("elements", ret.elements));
+		return ret;
+	}
+
+	// --record <file.rbxt> puts a recorder in front of whichever target was picked
+	inline auto attach( const arguments& args ) -> bool {
+		const std::string* record = args.flag("record");
+
+		std::unique_ptr<memory::memory_source> source;
+		if (args.has("synthetic"))
+			source = std::make_unique<memory::synthetic::source>(synthetic_config(args));
+		else if (auto path = args.flag("snapshot"))
+			source = memory::snapshot_source::open(*path);
+		else if (auto path = args.flag("dump"))
+			source = memory::minidump_source::open(*path);
+		else if (auto path = args.flag("replay"))
+			source = memory::replay_source::open(*path, args.has("latency"));
+		else {
+			std::int32_t pid = static_cast<std::int32_t>(args.number("pid", 0));
+			if (auto name = args.flag("process"))
+				pid = memory::get_pid(std::filesystem::path(*name).wstring());
+			if (!pid)
+				return false;
+			return record ? memory::attach_to_process_recorded(pid, *record) : memory::attach_to_process(pid);
+		}
+
+		if (source && record)
+			source = memory::recording_source::create(std::move(source), *record);
+		return memory::attach_to_source(std::move(source));
+	}
+
+	inline auto write_addresses( context& ctx, std::string_view command, const std::vector<std::uint64_t>& hits, std::uint64_t scanned ) -> void {
+		if (ctx.format == output_format::binary) {
+			ctx.binary.header(binary_writer::kind::addresses, hits.size());
+			for (auto hit : hits)
+				ctx.binary.put(hit);
+			return;
+		}
+
+		ctx.begin_result(command, scanned);
+		ctx.json.field("count", static_cast<std::uint64_t>(hits.size()));
+		ctx.json.key("results");
+		ctx.json.begin_array();
+		for (auto hit : hits)
+			ctx.json.address(hit);
+		ctx.json.end_array();
+		ctx.json.end_object();
+		ctx.json.finish();
+	}
+
+	inline auto run_info( context& ctx, const arguments& ) -> int {
+		std::uint64_t committed = 0, readable = 0;
+		for (auto& region : memory::regions.all()) {
+			committed += region.size;
+			if (region.readable())
+				readable += region.size;
+		}
+
+		ctx.begin_result("info", 0);
+		ctx.json.field("source", memory::attached_source() ? "file" : "live");
+		ctx.json.field("pid", static_cast<std::int64_t>(memory::state.pid));
+		ctx.json.address_field("process_base", memory::state.process_base);
+		ctx.json.field("regions", static_cast<std::uint64_t>(memory::regions.all().size()));
+		ctx.json.field("committed_bytes", committed);
+		ctx.json.field("readable_bytes", readable);
+		ctx.json.field("cached_vtables", static_cast<std::uint64_t>(memory::rtti::vtables.entries().size()));
+
+		ctx.json.key("modules");
+		ctx.json.begin_array();
+		for (auto& module : memory::modules.current()->modules) {
+			ctx.json.begin_object();
+			ctx.json.field("name", std::string_view(module->name_utf8));
+			ctx.json.address_field("base", module->base);
+			ctx.json.field("size", static_cast<std::uint64_t>(module->size));
+			ctx.json.field("timestamp", static_cast<std::uint64_t>(module->timestamp));
+			ctx.json.field("exports", static_cast<std::uint64_t>(module->exports.size()));
+			ctx.json.end_object();
+		}
+		ctx.json.end_array();
+		ctx.json.end_object();
+		ctx.json.finish();
+		return 0;
+	}
+
+	inline auto run_read( context& ctx, const arguments& args ) -> int {
+		auto address = args.positional.size() > 1 ? parse_address(args.positional[1]) : std::nullopt;
+		if (!address)
+			return fail("read <address> [size]");
+
+		std::uint64_t size = args.positional.size() > 2 ? std::strtoull(args.positional[2].c_str(), nullptr, 0) : 0x100;
+		if (!size || size > 0x10000000)
+			return fail("read: size must be between 1 byte and 256 MiB");
+
+		std::vector<std::uint8_t> bytes(static_cast<std::size_t>(size));
+		bool ok = memory::read_bytes(*address, bytes.data(), bytes.size());
+
+		if (ctx.format == output_format::binary) {
+			ctx.binary.header(binary_writer::kind::bytes, ok ? 1 : 0);
+			if (ok) {
+				ctx.binary.put(*address);
+				ctx.binary.put(size);
+				ctx.binary.put_bytes(bytes.data(), bytes.size());
+			}
+			return ok ? 0 : 1;
+		}
+
+		std::string hex;
+		if (ok) {
+			static constexpr char digits[] = "0123456789ABCDEF";
+			hex.reserve(bytes.size() * 2);
+			for (auto byte : bytes) {
+				hex += digits[byte >> 4];
+				hex += digits[byte & 15];
+			}
+		}
+
+		ctx.begin_result("read", ok ? size : 0);
+		ctx.json.address_field("address", *address);
+		ctx.json.field("size", size);
+		ctx.json.field("ok", ok);
+		ctx.json.field("hex", std::string_view(hex));
+		ctx.json.end_object();
+		ctx.json.finish();
+		return ok ? 0 : 1;
+	}
+
+	template <typename t>
+	inline auto scan_parsed( const std::string& text, const memory::scan_options& options, std::uint64_t& scanned ) -> std::optional<std::vector<std::uint64_t>> {
+		auto value = memory::parse_value<t>(text);
+		if (!value)
+			return std::nullopt;
+		return memory::scan_value(*value, options, &scanned);
+	}
+
+	inline auto run_value( context& ctx, const arguments& args ) -> int {
+		if (args.positional.size() < 3)
+			return fail("value <i8|u8|i16|u16|i32|u32|i64|u64|f32|f64|string> <value> [--align n] [--all]");
+
+		const std::string& type = args.positional[1];
+		const std::string& text = args.positional[2];
+
+		memory::scan_options options;
+		options.writable_only = !args.has("all");
+		options.alignment = static_cast<std::size_t>(args.number("align", 1));
+
+		std::uint64_t scanned = 0;
+		std::optional<std::vector<std::uint64_t>> hits;
+		if (type == "i8") hits = scan_parsed<std::int8_t>(text, options, scanned);
+		else if (type == "u8") hits = scan_parsed<std::uint8_t>(text, options, scanned);
+		else if (type == "i16") hits = scan_parsed<std::int16_t>(text, options, scanned);
+		else if (type == "u16") hits = scan_parsed<std::uint16_t>(text, options, scanned);
+		else if (type == "i32") hits = scan_parsed<std::int32_t>(text, options, scanned);
+		else if (type == "u32") hits = scan_parsed<std::uint32_t>(text, options, scanned);
+		else if (type == "i64") hits = scan_parsed<std::int64_t>(text, options, scanned);
+		else if (type == "u64") hits = scan_parsed<std::uint64_t>(text, options, scanned);
+		else if (type == "f32") hits = scan_parsed<float>(text, options, scanned);
+		else if (type == "f64") hits = scan_parsed<double>(text, options, scanned);
+		else if (type == "string")
+			hits = memory::scan_bytes({ reinterpret_cast<const std::uint8_t*>(text.data()), text.size() }, options, &scanned);
+		else
+			return fail("value: unknown type");
+
+		if (!hits)
+			return fail("value: couldn't parse the value for that type");
+
+		write_addresses(ctx, "value", *hits, scanned);
+		return 0;
+	}
+
+	inline auto run_signature( context& ctx, const arguments& args ) -> int {
+		auto sig = args.positional.size() > 1 ? memory::parse_signature(args.positional[1]) : std::nullopt;
+		if (!sig)
+			return fail("signature \"48 8B 05 ?? ?? ?? ??\" [--module name] [--all]");
+
+		memory::scan_options options;
+		options.executable_only = !args.has("all");
+		if (auto name = args.flag("module")) {
+			auto module = memory::modules.by_name(std::filesystem::path(*name).wstring());
+			if (!module)
+				return fail("signature: no such module");
+			options.begin = module->base;
+			options.end = module->base + module->size;
+		}
+
+		std::uint64_t scanned = 0;
+		auto hits = memory::scan_signature(*sig, options, &scanned);
+		write_addresses(ctx, "signature", hits, scanned);
+		return 0;
+	}
+
+	inline auto run_pointers( context& ctx, const arguments& args ) -> int {
+		auto target = args.positional.size() > 1 ? parse_address(args.positional[1]) : std::nullopt;
+		if (!target)
+			return fail("pointers <address> [--depth n] [--offset n] [--limit n]");
+
+		memory::pointer_search search;
+		search.max_depth = static_cast<std::size_t>(args.number("depth", search.max_depth));
+		search.max_offset = args.number("offset", search.max_offset);
+		search.max_results = static_cast<std::size_t>(args.number("limit", search.max_results));
+
+		std::uint64_t scanned = 0;
+		memory::pointer_map map;
+		map.build(&scanned);
+		auto paths = memory::find_pointer_paths(map, *target, search);
+
+		if (ctx.format == output_format::binary) {
+			ctx.binary.header(binary_writer::kind::paths, paths.size());
+			for (auto& path : paths) {
+				ctx.binary.put(path.base);
+				ctx.binary.put(static_cast<std::uint32_t>(path.offsets.size()));
+				ctx.binary.put_bytes(path.offsets.data(), path.offsets.size() * sizeof(std::uint64_t));
+			}
+			return 0;
+		}
+
+		ctx.begin_result("pointers", scanned);
+		ctx.json.field("pointer_map", static_cast<std::uint64_t>(map.size()));
+		ctx.json.field("count", static_cast<std::uint64_t>(paths.size()));
+		std::vector<std::uint64_t> bases;
+		for (auto& path : paths)
+			bases.push_back(path.base);
+		memory::symbols.prefetch(bases);
+
+		ctx.json.key("results");
+		ctx.json.begin_array();
+		for (auto& path : paths) {
+			ctx.json.begin_object();
+			ctx.json.address_field("base", path.base);
+			ctx.json.field("symbol", std::string_view(memory::symbols.name(path.base))); // the root by export, the path keeps module+rva
+			ctx.json.key("offsets");
+			ctx.json.begin_array();
+			for (auto offset : path.offsets)
+				ctx.json.address(offset);
+			ctx.json.end_array();
+			ctx.json.field("path", std::string_view(memory::format_pointer_path(path)));
+			ctx.json.end_object();
+		}
+		ctx.json.end_array();
+		ctx.json.end_object();
+		ctx.json.finish();
+		return 0;
+	}
+
+	inline auto run_census( context& ctx, const arguments& args ) -> int {
+		std::uint64_t scanned = 0;
+		auto entries = memory::rtti_census(args.number("min", 1), &scanned);
+
+		if (ctx.format == output_format::binary) {
+			ctx.binary.header(binary_writer::kind::census, entries.size());
+			for (auto& entry : entries) {
+				ctx.binary.put(entry.vfptr);
+				ctx.binary.put(entry.count);
+				ctx.binary.put_string(entry.mangled);
+			}
+			return 0;
+		}
+
+		std::uint64_t objects = 0;
+		for (auto& entry : entries)
+			objects += entry.count;
+
+		ctx.begin_result("census", scanned);
+		ctx.json.field("types", static_cast<std::uint64_t>(entries.size()));
+		ctx.json.field("objects", objects);
+		ctx.json.key("results");
+		ctx.json.begin_array();
+		for (auto& entry : entries) {
+			ctx.json.begin_object();
+			ctx.json.field("type", std::string_view(entry.type));
+			ctx.json.field("mangled", std::string_view(entry.mangled));
+			ctx.json.address_field("vfptr", entry.vfptr);
+			ctx.json.field("count", entry.count);
+			ctx.json.end_object();
+		}
+		ctx.json.end_array();
+		ctx.json.end_object();
+		ctx.json.finish();
+		return 0;
+	}
+
+	inline auto run_capture( context& ctx, const arguments& args ) -> int {
+		if (args.positional.size() < 2)
+			return fail("capture <out.rbxs>");
+
+		std::uint64_t captured = 0;
+		for (auto& region : memory::regions.all()) {
+			if (region.readable())
+				captured += region.size;
+		}
+
+		// a synthetic target writes itself, guard pages and all, without going through the region list
+		auto generated = memory::synthetic::attached_target();
+		bool ok = generated ? memory::synthetic::write(args.positional[1], *generated) : memory::snapshot::capture(args.positional[1]);
+		ctx.begin_result("capture", ok ? captured : 0);
+		ctx.json.field("path", std::string_view(args.positional[1]));
+		ctx.json.field("ok", ok);
+		ctx.json.end_object();
+		ctx.json.finish();
+		return ok ? 0 : 1;
+	}
+
+	inline auto run_truth( context& ctx, const arguments& ) -> int {
+		auto generated = memory::synthetic::attached_target();
+		if (!generated)
+			return fail("truth needs a --synthetic target");
+
+		auto& truth = generated->get_truth();
+		ctx.begin_result("truth", 0);
+		ctx.json.field("seed", generated->get_config().seed);
+		ctx.json.field("objects", truth.objects);
+		ctx.json.key("types");
+		ctx.json.begin_array();
+		for (auto& type : truth.types) {
+			ctx.json.begin_object();
+			ctx.json.field("mangled", std::string_view(type.mangled));
+			ctx.json.address_field("vfptr", type.vfptr);
+			ctx.json.address_field("type_descriptor", type.type_descriptor);
+			ctx.json.field("depth", static_cast<std::uint64_t>(type.depth));
+			ctx.json.field("count", type.count);
+			ctx.json.end_object();
+		}
+		ctx.json.end_array();
+		ctx.json.key("chains");
+		ctx.json.begin_array();
+		for (auto& chain : truth.chains) {
+			ctx.json.begin_object();
+			ctx.json.address_field("base", chain.base);
+			ctx.json.key("offsets");
+			ctx.json.begin_array();
+			for (auto offset : chain.offsets)
+				ctx.json.address(offset);
+			ctx.json.end_array();
+			ctx.json.address_field("target", chain.target);
+			ctx.json.end_object();
+		}
+		ctx.json.end_array();
+		ctx.json.key("containers");
+		ctx.json.begin_object();
+		ctx.json.address_field("vector", truth.containers.vector);
+		ctx.json.address_field("short_string", truth.containers.short_string);
+		ctx.json.address_field("long_string", truth.containers.long_string);
+		ctx.json.address_field("map", truth.containers.map);
+		ctx.json.address_field("unordered_map", truth.containers.unordered_map);
+		ctx.json.field("elements", static_cast<std::uint64_t>(truth.containers.elements));
+		ctx.json.end_object();
+		ctx.json.field("signature", std::string_view(truth.signature));
+		ctx.json.address_field("signature_address", truth.signature_address);
+		ctx.json.end_object();
+		ctx.json.finish();
+		return 0;
+	}
+
+	// checks come back as JSON either way, exit code 1 if any of them failed
+	inline auto run_verify( context& ctx, const arguments& ) -> int {
+		auto generated = memory::synthetic::attached_target();
+		if (!generated)
+			return fail("verify needs a --synthetic target");
+
+		auto checks = verify_synthetic(generated->get_truth());
+		std::uint64_t failed = std::count_if(checks.begin(), checks.end(), [](const check& entry) { return !entry.passed; });
+
+		ctx.begin_result("verify", 0);
+		ctx.json.field("failed", failed);
+		ctx.json.key("results");
+		ctx.json.begin_array();
+		for (auto& entry : checks) {
+			ctx.json.begin_object();
+			ctx.json.field("name", std::string_view(entry.name));
+			ctx.json.field("passed", entry.passed);
+			if (!entry.passed)
+				ctx.json.field("detail", std::string_view(entry.detail));
+			ctx.json.end_object();
+		}
+		ctx.json.end_array();
+		ctx.json.end_object();
+		ctx.json.finish();
+		return failed ? 1 : 0;
+	}
+
+	// what a recording holds, and what this run's replay of it has served so far
+	inline auto run_trace( context& ctx, const arguments& ) -> int {
+		auto replay = memory::attached_replay();
+		if (!replay)
+			return fail("trace needs a --replay target");
+
+		auto& summary = replay->get_summary();
+		auto served = replay->get_counters();
+		ctx.begin_result("trace", 0);
+		ctx.json.field("pid", static_cast<std::uint64_t>(replay->get_header().pid));
+		ctx.json.address_field("process_base", replay->get_header().process_base);
+		ctx.json.field("reads", summary.reads);
+		ctx.json.field("failed", summary.failed);
+		ctx.json.field("bytes", summary.bytes);
+		ctx.json.field("unchanged", summary.unchanged);
+		ctx.json.field("repeats", summary.repeats);
+		ctx.json.field("pages", summary.pages);
+		ctx.json.field("duration_ms", summary.duration_ns / 1e6);
+		ctx.json.field("p50_us", summary.p50_ns / 1e3);
+		ctx.json.field("p90_us", summary.p90_ns / 1e3);
+		ctx.json.field("p99_us", summary.p99_ns / 1e3);
+		ctx.json.field("fixed_us", summary.fixed_ns / 1e3);
+		ctx.json.field("per_kib_us", summary.per_byte_ns * 1024 / 1e3);
+		ctx.json.key("replayed");
+		ctx.json.begin_object();
+		ctx.json.field("reads", served.reads);
+		ctx.json.field("bytes", served.bytes);
+		ctx.json.field("misses", served.misses);
+		ctx.json.end_object();
+		ctx.json.end_object();
+		ctx.json.finish();
+		return 0;
+	}
+
+	inline auto usage( void ) -> int {
+		std::fputs(
+			"usage: reblox-cli <target> <command> [arguments] [--format json|binary] [--out file]\n"
+			"targets:\n"
+			"  --pid <pid> | --process <name.exe> | --snapshot <file.rbxs> | --dump <file.dmp>\n"
+			"  --synthetic <heap MiB>        generated MSVC layout target (--seed, --types, --chains, --elements)\n"
+			"  --replay <file.rbxt>          a recorded session, --latency to wait out each read's recorded cost\n"
+			"  --record <file.rbxt>          with any of the above, logs every read the command makes\n"
+			"commands:\n"
+			"  info                          modules, regions, sizes\n"
+			"  read <address> [size]         raw bytes\n"
+			"  value <type> <value>          exact value scan over writable memory (--all for everything, --align n)\n"
+			"  signature <pattern>           code pattern scan, ?? for wildcards (--module name, --all)\n"
+			"  pointers <address>            static pointer paths to an address (--depth, --offset, --limit)\n"
+			"  census                        live objects per RTTI type (--min count)\n"
+			"  capture <out.rbxs>            snapshot of everything readable\n"
+			"  truth                         what a --synthetic target holds, by construction\n"
+			"  verify                        census, pointer paths, scans and STL readers checked against the truth\n"
+			"  trace                         what a --replay recording holds and what has been replayed from it\n"
+			"a --replay run ends with the reads it served on stderr, to compare engine changes against the session.\n"
+			"--stats <file> writes the engine's counters and latency percentiles for the run as JSON,\n"
+			"--timeline <file> the run's scans, batches and engine jobs as a trace (.json for chrome://tracing,\n"
+			"anything else a perfetto protobuf for ui.perfetto.dev)\n",
+			stderr);
+		return 1;
+	}
+
+	inline auto run( int argc, char** argv ) -> int {
+		arguments args = parse_arguments(argc, argv);
+		if (args.positional.empty() || args.has("help"))
+			return usage();
+
+		output_format format = output_format::json;
+		if (auto name = args.flag("format")) {
+			if (*name == "binary")
+				format = output_format::binary;
+			else if (*name != "json")
+				return fail("--format is json or binary");
+		}
+
+		std::FILE* out = stdout;
+		if (format == output_format::binary)
+			_setmode(_fileno(stdout), _O_BINARY); // no \n -> \r\n in the records
+		if (auto path = args.flag("out")) {
+			out = std::fopen(path->c_str(), format == output_format::binary ? "wb" : "w");
+			if (!out)
+				return fail("can't open the output file");
+		}
+
+		memory::timeline::engine.name_thread("main");
+		if (args.has("timeline"))
+			memory::timeline::engine.start();
+
+		if (!attach(args))
+			return fail("couldn't open the target, pass --pid, --process, --snapshot, --dump, --synthetic or --replay");
+
+		context ctx(out, format);
+		const std::string& command = args.positional[0];
+		int ret;
+		if (command == "info") ret = run_info(ctx, args);
+		else if (command == "read") ret = run_read(ctx, args);
+		else if (command == "value") ret = run_value(ctx, args);
+		else if (command == "signature") ret = run_signature(ctx, args);
+		else if (command == "pointers") ret = run_pointers(ctx, args);
+		else if (command == "census") ret = run_census(ctx, args);
+		else if (command == "capture") ret = run_capture(ctx, args);
+		else if (command == "truth") ret = run_truth(ctx, args);
+		else if (command == "verify") ret = run_verify(ctx, args);
+		else if (command == "trace") ret = run_trace(ctx, args);
+		else ret = usage();
+
+		if (auto replay = memory::attached_replay()) {
+			auto served = replay->get_counters();
+			std::fprintf(stderr, "replay: %llu reads, %llu bytes, %llu misses\n", static_cast<unsigned long long>(served.reads), static_cast<unsigned long long>(served.bytes), static_cast<unsigned long long>(served.misses));
+		}
+		if (auto path = args.flag("stats"); path && !write_stats(*path))
+			ret = fail("can't write the stats file");
+		if (auto path = args.flag("timeline"); path && !write_timeline(*path))
+			ret = fail("can't write the timeline file");
+
+		memory::detach_from_process();
+		if (out != stdout)
+			std::fclose(out);
+		return ret;
+	}
+}
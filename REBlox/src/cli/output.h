@@ -0,0 +1,169 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+
+namespace reblox::cli {
+	// streams JSON to a FILE* without building a document, result sets can be millions of entries. commas
+	// and nesting are tracked here so callers just emit keys and values in order
+	class json_writer {
+	public:
+		explicit json_writer( std::FILE* out ) : out(out) {}
+
+		auto begin_object( void ) -> void {
+			separate();
+			std::fputc('{', out);
+			first.push_back(true);
+		}
+
+		auto end_object( void ) -> void {
+			first.pop_back();
+			std::fputc('}', out);
+		}
+
+		auto begin_array( void ) -> void {
+			separate();
+			std::fputc('[', out);
+			first.push_back(true);
+		}
+
+		auto end_array( void ) -> void {
+			first.pop_back();
+			std::fputc(']', out);
+		}
+
+		auto key( std::string_view name ) -> void {
+			separate();
+			string(name);
+			std::fputc(':', out);
+			after_key = true;
+		}
+
+		auto value( std::string_view text ) -> void {
+			separate();
+			string(text);
+		}
+
+		auto value( const char* text ) -> void {
+			value(std::string_view(text));
+		}
+
+		auto value( std::uint64_t number ) -> void {
+			separate();
+			std::fprintf(out, "%llu", static_cast<unsigned long long>(number));
+		}
+
+		auto value( std::int64_t number ) -> void {
+			separate();
+			std::fprintf(out, "%lld", static_cast<long long>(number));
+		}
+
+		auto value( double number ) -> void {
+			separate();
+			std::fprintf(out, "%.17g", number);
+		}
+
+		auto value( bool flag ) -> void {
+			separate();
+			std::fputs(flag ? "true" : "false", out);
+		}
+
+		// addresses go out as "0x..." strings, JSON numbers lose precision past 2^53 in most readers
+		auto address( std::uint64_t address ) -> void {
+			char buf[24];
+			std::snprintf(buf, sizeof(buf), "0x%llX", static_cast<unsigned long long>(address));
+			value(std::string_view(buf));
+		}
+
+		template <typename t>
+		auto field( std::string_view name, t data ) -> void {
+			key(name);
+			value(data);
+		}
+
+		auto address_field( std::string_view name, std::uint64_t data ) -> void {
+			key(name);
+			address(data);
+		}
+
+		auto finish( void ) -> void {
+			std::fputc('\n', out);
+		}
+
+	private:
+		auto separate( void ) -> void {
+			if (after_key) {
+				after_key = false;
+				return;
+			}
+			if (first.empty())
+				return;
+			if (!first.back())
+				std::fputc(',', out);
+			first.back() = false;
+		}
+
+		auto string( std::string_view text ) -> void {
+			std::fputc('"', out);
+			for (char c : text) {
+				auto byte = static_cast<unsigned char>(c);
+				if (c == '"' || c == '\\')
+					std::fprintf(out, "\\%c", c);
+				else if (byte < 0x20)
+					std::fprintf(out, "\\u%04X", byte);
+				else
+					std::fputc(c, out);
+			}
+			std::fputc('"', out);
+		}
+
+		std::FILE* out;
+		std::vector<bool> first; // per open object/array: nothing written into it yet
+		bool after_key = false;
+	};
+
+	// binary results: a fixed header then count records of the command's layout, all little endian. meant
+	// for feeding other tools without a JSON parser in the way
+	class binary_writer {
+	public:
+		static constexpr std::uint32_t magic = 0x52584252; // "RBXR"
+		static constexpr std::uint32_t version = 1;
+
+		enum struct kind : std::uint32_t {
+			addresses = 1, // u64 address
+			census, // u64 vfptr, u64 count, u32 length, mangled name
+			paths, // u64 base, u32 count, u64 offsets[count]
+			bytes // u64 address, u64 size, raw bytes
+		};
+
+		explicit binary_writer( std::FILE* out ) : out(out) {}
+
+		auto header( kind type, std::uint64_t count ) -> void {
+			put(magic);
+			put(version);
+			put(static_cast<std::uint32_t>(type));
+			put(std::uint32_t(0));
+			put(count);
+		}
+
+		template <typename t>
+		auto put( const t& data ) -> void {
+			std::fwrite(&data, sizeof(t), 1, out);
+		}
+
+		auto put_bytes( const void* data, std::size_t size ) -> void {
+			std::fwrite(data, 1, size, out);
+		}
+
+		auto put_string( std::string_view text ) -> void {
+			put(static_cast<std::uint32_t>(text.size()));
+			put_bytes(text.data(), text.size());
+		}
+
+	private:
+		std::FILE* out;
+	};
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include "../memory/memory.h"
+#include "../memory/stl.h"
+#include "../memory/scan.h"
+#include "../memory/pointer_scan.h"
+#include "../memory/synthetic.h"
+
+namespace reblox::cli {
+	struct check {
+		std::string name;
+		bool passed;
+		std::string detail; // what was expected and what came back when it failed
+	};
+
+	// runs the engine's own scans and readers against a synthetic target and compares with what the generator
+	// says is there. everything is exact: the census counts, the chain paths, every container element
+	inline auto verify_synthetic( const memory::synthetic::truth& truth ) -> std::vector<check> {
+		std::vector<check> ret;
+		char detail[256];
+		auto add = [&](std::string name, bool passed) { ret.push_back({ std::move(name), passed, passed ? std::string() : std::string(detail) }); };
+
+		// census, every type with live objects found once with the right count and nothing else
+		{
+			auto entries = memory::rtti_census(1);
+			std::unordered_map<std::uint64_t, const memory::census_entry*> found;
+			for (auto& entry : entries)
+				found[entry.vfptr] = &entry;
+
+			std::size_t expected = 0, wrong = 0;
+			detail[0] = 0;
+			for (auto& type : truth.types) {
+				if (!type.count)
+					continue;
+				expected++;
+
+				auto it = found.find(type.vfptr);
+				if (it == found.end() || it->second->count != type.count || it->second->mangled != type.mangled) {
+					if (!wrong++)
+						std::snprintf(detail, sizeof(detail), "%s: expected %llu, got %llu", type.mangled.c_str(), static_cast<unsigned long long>(type.count), it == found.end() ? 0ull : static_cast<unsigned long long>(it->second->count));
+				}
+			}
+			if (!wrong && entries.size() != expected)
+				std::snprintf(detail, sizeof(detail), "expected %zu types, got %zu", expected, entries.size());
+			add("census", !wrong && entries.size() == expected);
+		}
+
+		// pointer paths, every chain comes back as a static path with its exact offsets
+		{
+			memory::pointer_map map;
+			map.build();
+
+			std::size_t wrong = 0;
+			for (auto& chain : truth.chains) {
+				auto paths = memory::find_pointer_paths(map, chain.target);
+				bool hit = std::any_of(paths.begin(), paths.end(), [&](const memory::pointer_path& path) { return path.base == chain.base && path.offsets == chain.offsets; });
+				if (!hit && !wrong++)
+					std::snprintf(detail, sizeof(detail), "no path to %llx, %zu others", static_cast<unsigned long long>(chain.target), paths.size());
+			}
+			add("pointers/chains", !wrong);
+		}
+
+		// one chain's value by scan, the heaps can hold the same small number so it only has to be among the hits
+		if (!truth.chains.empty()) {
+			memory::scan_options options;
+			options.writable_only = true;
+			std::uint64_t value = memory::read_memory<std::uint64_t>(truth.chains.front().target);
+			auto hits = memory::scan_value(value, options);
+			std::snprintf(detail, sizeof(detail), "%llx not among %zu hits", static_cast<unsigned long long>(truth.chains.front().target), hits.size());
+			add("scan/value", std::find(hits.begin(), hits.end(), truth.chains.front().target) != hits.end());
+		}
+
+		// signature, exactly one hit where it was planted
+		{
+			auto sig = memory::parse_signature(truth.signature);
+			memory::scan_options options;
+			options.executable_only = true;
+			auto hits = sig ? memory::scan_signature(*sig, options) : std::vector<std::uint64_t>{};
+			std::snprintf(detail, sizeof(detail), "expected %llx, got %zu hits", static_cast<unsigned long long>(truth.signature_address), hits.size());
+			add("scan/signature", hits.size() == 1 && hits.front() == truth.signature_address);
+		}
+
+		// containers
+		{
+			auto& containers = truth.containers;
+			const std::uint32_t n = containers.elements;
+
+			auto vector = memory::stl::read_vector<std::uint32_t>(containers.vector);
+			bool vector_ok = vector.size() == n;
+			for (std::uint32_t i = 0; vector_ok && i < n; i++)
+				vector_ok = vector[i] == i * 3 + 1;
+			std::snprintf(detail, sizeof(detail), "%zu of %u elements", vector.size(), n);
+			add("stl/vector", vector_ok);
+
+			std::string short_text = memory::stl::read_string(containers.short_string);
+			std::snprintf(detail, sizeof(detail), "got \"%.64s\"", short_text.c_str());
+			add("stl/string_inline", short_text == containers.short_text);
+
+			std::string long_text = memory::stl::read_string(containers.long_string);
+			std::snprintf(detail, sizeof(detail), "got \"%.64s\"", long_text.c_str());
+			add("stl/string_heap", long_text == containers.long_text);
+
+			auto squares = [&](std::vector<std::pair<std::uint32_t, std::uint32_t>> pairs) {
+				std::sort(pairs.begin(), pairs.end());
+				bool ok = pairs.size() == n;
+				for (std::uint32_t i = 0; ok && i < n; i++)
+					ok = pairs[i].first == i && pairs[i].second == i * i;
+				std::snprintf(detail, sizeof(detail), "%zu of %u elements", pairs.size(), n);
+				return ok;
+			};
+			add("stl/map", squares(memory::stl::read_map<std::uint32_t, std::uint32_t>(containers.map)));
+			add("stl/unordered_map", squares(memory::stl::read_unordered_map<std::uint32_t, std::uint32_t>(containers.unordered_map)));
+		}
+
+		return ret;
+	}
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <cstdint>
+#include <future>
+#include <fstream>
+#include <filesystem>
+#include "memory.h"
+#include "modules.h"
+#include "regions.h"
+#include "page_cache.h"
+
+namespace reblox::memory {
+	// things that are expensive to rediscover but stable for a given build of the target. files are keyed
+	// on the main module's name, PE timestamp and image size, so an update just starts a fresh file
+	namespace store {
+		inline constexpr std::uint32_t vtables_magic = 0x56584252; // "RBXV"
+		inline constexpr std::uint32_t vtables_version = 1;
+
+		inline auto directory( void ) -> std::filesystem::path {
+			wchar_t buf[MAX_PATH]{};
+			DWORD length = GetEnvironmentVariableW(L"LOCALAPPDATA", buf, MAX_PATH);
+			std::filesystem::path base = length && length < MAX_PATH ? std::filesystem::path(buf) : std::filesystem::temp_directory_path();
+			return base / L"REBlox";
+		}
+
+		inline auto path_for( const module_info& module, const wchar_t* extension ) -> std::filesystem::path {
+			wchar_t name[MAX_PATH];
+			swprintf(name, MAX_PATH, L"%ls-%08X-%08X%ls", module.name.c_str(), module.timestamp, module.size, extension);
+			return directory() / name;
+		}
+
+		// vtables inside the module are stored as rvas so they survive ASLR
+		inline auto save_vtables( const module_info& module ) -> bool {
+			std::vector<std::pair<std::uint32_t, std::string>> entries;
+			for (auto& [vfptr, name] : rtti::vtables.entries()) {
+				if (module.contains(vfptr) && name.size() <= 0xFFFF)
+					entries.emplace_back(static_cast<std::uint32_t>(vfptr - module.base), std::move(name));
+			}
+			if (entries.empty())
+				return true;
+
+			std::error_code ec;
+			std::filesystem::create_directories(directory(), ec);
+
+			std::ofstream file(path_for(module, L".rtti"), std::ios::binary | std::ios::trunc);
+			if (!file)
+				return false;
+
+			std::uint32_t count = static_cast<std::uint32_t>(entries.size());
+			file.write(reinterpret_cast<const char*>(&vtables_magic), sizeof(vtables_magic));
+			file.write(reinterpret_cast<const char*>(&vtables_version), sizeof(vtables_version));
+			file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+			for (auto& [rva, name] : entries) {
+				std::uint16_t length = static_cast<std::uint16_t>(name.size());
+				file.write(reinterpret_cast<const char*>(&rva), sizeof(rva));
+				file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+				file.write(name.data(), length);
+			}
+
+			return file.good();
+		}
+
+		inline auto load_vtables( const module_info& module ) -> std::size_t {
+			std::ifstream file(path_for(module, L".rtti"), std::ios::binary);
+			if (!file)
+				return 0;
+
+			std::uint32_t magic = 0, version = 0, count = 0;
+			file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+			file.read(reinterpret_cast<char*>(&version), sizeof(version));
+			file.read(reinterpret_cast<char*>(&count), sizeof(count));
+			if (!file || magic != vtables_magic || version != vtables_version)
+				return 0;
+
+			std::size_t loaded = 0;
+			std::string name;
+			for (std::uint32_t i = 0; i < count; i++) {
+				std::uint32_t rva = 0;
+				std::uint16_t length = 0;
+				file.read(reinterpret_cast<char*>(&rva), sizeof(rva));
+				file.read(reinterpret_cast<char*>(&length), sizeof(length));
+				name.resize(length);
+				file.read(name.data(), length);
+				if (!file || rva >= module.size)
+					break;
+
+				rtti::vtables.store(module.base + rva, name, attach_generation());
+				loaded++;
+			}
+
+			return loaded;
+		}
+	}
+
+	inline auto detach_from_process( void ) -> void {
+		if (auto main_module = modules.find(state.process_base))
+			store::save_vtables(*main_module);
+
+		// the handle is closed and the source freed by whichever reader lets go of them last
+		state.generation.fetch_add(1, std::memory_order_acq_rel);
+		state.pid = 0;
+		state.process_base = 0;
+		state.proc.store(nullptr, std::memory_order_release);
+		state.source.store(nullptr, std::memory_order_release);
+
+		modules.clear();
+		regions.clear();
+		rtti::vtables.clear();
+		pages.clear();
+	}
+
+	// one module snapshot feeds both the base address and the module map. the region walk runs next to
+	// the PE parsing and the per-build store load, since none of them depend on each other
+	inline auto attach_to_process( std::int32_t pid ) -> bool {
+		detach_from_process();
+
+		state.pid = pid;
+		HANDLE proc = open_process(pid);
+		if (proc == nullptr)
+			return false;
+		state.proc.store(std::make_shared<process_handle>(proc), std::memory_order_release);
+
+		auto entries = get_modules(pid);
+		if (entries.empty())
+			return false;
+
+		auto region_walk = std::async(std::launch::async, [] { regions.build(); });
+
+		modules.build(entries);
+		state.process_base = reinterpret_cast<std::uint64_t>(entries.front().modBaseAddr); // toolhelp lists the exe first
+		if (auto main_module = modules.find(state.process_base))
+			store::load_vtables(*main_module);
+
+		region_walk.get();
+		return state.process_base != 0;
+	}
+
+	// attach_to_process for a snapshot or dump. the module list comes from the source, the rest (regions,
+	// PE parsing, the vtable store) runs through it exactly as it would against a live process
+	inline auto attach_to_source( std::unique_ptr<memory_source> source ) -> bool {
+		detach_from_process();
+		if (!source)
+			return false;
+
+		auto entries = source->modules();
+		state.source.store(std::shared_ptr<memory_source>(std::move(source)), std::memory_order_release);
+
+		regions.build();
+		modules.build(entries);
+		state.process_base = entries.empty() ? 0 : reinterpret_cast<std::uint64_t>(entries.front().modBaseAddr);
+		if (auto main_module = modules.find(state.process_base))
+			store::load_vtables(*main_module);
+
+		return !regions.all().empty();
+	}
+}
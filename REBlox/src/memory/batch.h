@@ -0,0 +1,327 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <span>
+#include <optional>
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include <type_traits>
+#include <unordered_map>
+#include "memory.h"
+
+namespace reblox::memory {
+	template <typename t>
+	class task;
+
+	struct task_promise_base {
+		std::coroutine_handle<> continuation; // whoever co_awaited us, resumed when we finish
+
+		struct final_awaiter {
+			auto await_ready( void ) noexcept -> bool { return false; }
+			template <typename promise_t>
+			auto await_suspend( std::coroutine_handle<promise_t> self ) noexcept -> std::coroutine_handle<> {
+				auto next = self.promise().continuation;
+				return next ? next : std::noop_coroutine();
+			}
+			auto await_resume( void ) noexcept -> void {}
+		};
+
+		auto initial_suspend( void ) noexcept -> std::suspend_always { return {}; }
+		auto final_suspend( void ) noexcept -> final_awaiter { return {}; }
+		auto unhandled_exception( void ) -> void { std::terminate(); }
+	};
+
+	template <typename t>
+	struct task_promise : task_promise_base {
+		std::optional<t> value;
+
+		auto get_return_object( void ) -> task<t>;
+		auto return_value( t result ) -> void { value = std::move(result); }
+	};
+
+	template <>
+	struct task_promise<void> : task_promise_base {
+		auto get_return_object( void ) -> task<void>;
+		auto return_void( void ) -> void {}
+	};
+
+	// lazily started coroutine. co_await one from another task to run it inline (the awaiter resumes when it
+	// finishes, by symmetric transfer), or start() the top level ones and let a read_batch drive them
+	template <typename t = void>
+	class task {
+	public:
+		using promise_type = task_promise<t>;
+		using handle_type = std::coroutine_handle<promise_type>;
+
+		task( void ) = default;
+		explicit task( handle_type handle ) : handle(handle) {}
+		task( task&& other ) noexcept : handle(std::exchange(other.handle, {})) {}
+		task& operator=( task&& other ) noexcept {
+			if (this != &other) {
+				if (handle)
+					handle.destroy();
+				handle = std::exchange(other.handle, {});
+			}
+			return *this;
+		}
+		~task( void ) {
+			if (handle)
+				handle.destroy();
+		}
+
+		auto start( void ) -> void {
+			if (handle && !handle.done())
+				handle.resume();
+		}
+
+		auto done( void ) const -> bool {
+			return !handle || handle.done();
+		}
+
+		// only once done()
+		auto result( void ) -> t {
+			if constexpr (!std::is_void_v<t>)
+				return std::move(*handle.promise().value);
+		}
+
+		auto operator co_await( void ) && noexcept {
+			struct awaiter {
+				handle_type handle;
+
+				auto await_ready( void ) noexcept -> bool { return !handle || handle.done(); }
+				auto await_suspend( std::coroutine_handle<> caller ) noexcept -> std::coroutine_handle<> {
+					handle.promise().continuation = caller;
+					return handle;
+				}
+				auto await_resume( void ) -> t {
+					if constexpr (!std::is_void_v<t>)
+						return std::move(*handle.promise().value);
+				}
+			};
+			return awaiter{ handle };
+		}
+
+	private:
+		handle_type handle;
+	};
+
+	template <typename t>
+	inline auto task_promise<t>::get_return_object( void ) -> task<t> {
+		return task<t>(std::coroutine_handle<task_promise<t>>::from_promise(*this));
+	}
+
+	inline auto task_promise<void>::get_return_object( void ) -> task<void> {
+		return task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+	}
+
+	// collects the reads of every suspended coroutine and issues them as one read_scatter per tick, then
+	// resumes everyone whose read finished. the coroutines read like plain dependent code, while the batch
+	// pays one (merged) syscall round per level of dependency instead of one per read
+	class read_batch {
+	public:
+		struct bytes_read {
+			read_batch& batch;
+			std::uint64_t address;
+			void* buffer;
+			std::size_t size;
+			bool ok = false;
+
+			auto await_ready( void ) noexcept -> bool { return false; }
+			auto await_suspend( std::coroutine_handle<> waiter ) -> void { batch.queue(address, buffer, size, &ok, waiter); }
+			auto await_resume( void ) noexcept -> bool { return ok; }
+		};
+
+		template <typename t>
+		struct value_read {
+			read_batch& batch;
+			std::uint64_t address;
+			t value{};
+			bool ok = false;
+
+			auto await_ready( void ) noexcept -> bool { return false; }
+			auto await_suspend( std::coroutine_handle<> waiter ) -> void { batch.queue(address, &value, sizeof(t), &ok, waiter); }
+			auto await_resume( void ) noexcept -> std::optional<t> { return ok ? std::optional<t>(value) : std::nullopt; }
+		};
+
+		// co_await batch.read<t>(address) -> std::optional<t>
+		template <typename t>
+		auto read( std::uint64_t address ) -> value_read<t> {
+			return { *this, address };
+		}
+
+		// co_await batch.read_bytes(address, buffer, size) -> bool. buffer has to outlive the suspension
+		auto read_bytes( std::uint64_t address, void* buffer, std::size_t size ) -> bytes_read {
+			return { *this, address, buffer, size };
+		}
+
+		// issues everything queued since the last tick as one batch and resumes the waiters. coroutines that
+		// read again while being resumed land in the next tick. returns how many reads went out
+		auto tick( void ) -> std::size_t {
+			if (queued.empty())
+				return 0;
+
+			stats::scoped_timer timing(stats::timer::batch_tick);
+			timeline::scope traced("read", "batch tick", "reads", queued.size());
+			stats::add(stats::counter::batch_ticks);
+			current.swap(queued);
+			queued.clear();
+
+			scatter.resize(current.size());
+			for (std::size_t i = 0; i < current.size(); i++)
+				scatter[i] = current[i].read;
+			read_scatter(scatter);
+
+			for (std::size_t i = 0; i < current.size(); i++) {
+				*current[i].ok = scatter[i].ok;
+				current[i].waiter.resume();
+			}
+
+			ticks++;
+			issued += current.size();
+			return current.size();
+		}
+
+		// starts every task and ticks until none of them is waiting on a read
+		template <typename t>
+		auto run( std::span<task<t>> tasks ) -> void {
+			for (auto& work : tasks)
+				work.start();
+			while (tick())
+				;
+		}
+
+		auto get_ticks( void ) const -> std::size_t {
+			return ticks;
+		}
+
+		auto get_issued( void ) const -> std::size_t {
+			return issued;
+		}
+
+	private:
+		struct waiting {
+			scatter_read read;
+			bool* ok;
+			std::coroutine_handle<> waiter;
+		};
+
+		auto queue( std::uint64_t address, void* buffer, std::size_t size, bool* ok, std::coroutine_handle<> waiter ) -> void {
+			queued.push_back({ { address, buffer, size, false }, ok, waiter });
+		}
+
+		std::vector<waiting> queued;
+		std::vector<waiting> current;
+		std::vector<scatter_read> scatter;
+		std::size_t ticks = 0;
+		std::size_t issued = 0;
+	};
+
+	// read_c_string as a coroutine, same chunking (small first read that stays on its page, then whole pages)
+	template <typename char_t = char>
+	inline auto read_c_string( read_batch& batch, std::uint64_t address, std::size_t limit = default_string_limit ) -> task<std::basic_string<char_t>> {
+		std::basic_string<char_t> ret;
+		if (!address)
+			co_return ret;
+
+		std::size_t remaining = limit * sizeof(char_t);
+		bool first = true;
+		while (remaining >= sizeof(char_t)) {
+			std::size_t chunk = next_string_chunk(address, remaining, first) & ~(sizeof(char_t) - 1);
+			if (!chunk)
+				chunk = sizeof(char_t);
+
+			std::size_t old_size = ret.size();
+			ret.resize(old_size + chunk / sizeof(char_t));
+			if (!co_await batch.read_bytes(address, ret.data() + old_size, chunk)) {
+				ret.resize(old_size);
+				break;
+			}
+
+			std::size_t end = find_terminator(ret.data() + old_size, chunk / sizeof(char_t));
+			if (end != chunk / sizeof(char_t)) {
+				ret.resize(old_size + end);
+				break;
+			}
+
+			address += chunk;
+			remaining -= chunk;
+			first = false;
+		}
+
+		co_return ret;
+	}
+
+	namespace rtti {
+		// get_mangled_vtable_name, one co_await per dependent read
+		inline auto mangled_vtable_name( read_batch& batch, std::uint64_t vfptr ) -> task<std::string> {
+			if (!vfptr)
+				co_return std::string{};
+
+			if (auto cached = vtables.lookup(vfptr))
+				co_return std::move(*cached);
+
+			std::uint64_t generation = attach_generation();
+
+			auto col_addr = co_await batch.read<std::uint64_t>(vfptr - sizeof(std::uint64_t));
+			if (!col_addr || !*col_addr)
+				co_return std::string{};
+
+			auto col = co_await batch.read<_s_RTTICompleteObjectLocator>(*col_addr);
+			if (!col || col->signature != 1)
+				co_return std::string{};
+
+			std::uint64_t image_base = *col_addr - col->pSelf;
+			if (!image_base)
+				co_return std::string{};
+
+			std::uint64_t type_desc_addr = image_base + col->pTypeDescriptor;
+			std::string name = co_await read_c_string(batch, type_desc_addr + sizeof(TypeDescriptor));
+			if (!name.empty())
+				vtables.store(vfptr, name, generation);
+			co_return name;
+		}
+
+		// mangled type names for a whole batch of objects. vfptrs are read in one scatter, then every distinct
+		// vtable that isn't cached yet gets a coroutine; they all advance together, one batch per level (COL,
+		// locator, name chunks), so 100k objects cost a handful of rounds rather than 400k round trips
+		inline auto get_mangled_object_names( std::span<const std::uint64_t> objects ) -> std::vector<std::string> {
+			std::vector<std::string> ret(objects.size());
+			if (!attached())
+				return ret;
+
+			std::vector<std::uint64_t> vfptrs(objects.size());
+			std::vector<scatter_read> reads;
+			reads.reserve(objects.size());
+			for (std::size_t i = 0; i < objects.size(); i++) {
+				if (objects[i])
+					reads.push_back({ objects[i], &vfptrs[i], sizeof(std::uint64_t), false });
+			}
+			read_scatter(reads);
+			for (auto& read : reads) {
+				if (!read.ok)
+					*static_cast<std::uint64_t*>(read.buffer) = 0;
+			}
+
+			std::unordered_map<std::uint64_t, std::size_t> distinct;
+			std::vector<task<std::string>> tasks;
+			read_batch batch;
+			for (std::size_t i = 0; i < objects.size(); i++) {
+				if (vfptrs[i] && distinct.try_emplace(vfptrs[i], tasks.size()).second)
+					tasks.push_back(mangled_vtable_name(batch, vfptrs[i]));
+			}
+			batch.run(std::span(tasks));
+
+			std::vector<std::string> names(tasks.size());
+			for (std::size_t i = 0; i < tasks.size(); i++)
+				names[i] = tasks[i].result();
+
+			for (std::size_t i = 0; i < objects.size(); i++) {
+				if (vfptrs[i])
+					ret[i] = names[distinct[vfptrs[i]]];
+			}
+			return ret;
+		}
+	}
+}
@@ -4,19 +4,89 @@
 #include <windows.h>
 #include <tlhelp32.h>
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <span>
+#include <algorithm>
+#include <cstring>
+#include <bit>
+#include <optional>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <emmintrin.h>
 #include <DbgHelp.h>
+#include "stats.h"
+#include "timeline.h"
 #pragma comment (lib, "dbghelp.lib")
 
 namespace reblox::memory {
 	using PE32 = PROCESSENTRY32W;
 	using ME32 = MODULEENTRY32W;
 
+	// stands in for a live process when the target is a file (snapshots, minidumps, see sources.h). with one
+	// attached, read_bytes and the region walk go through it and the process handle stays null
+	class memory_source {
+	public:
+		virtual ~memory_source( void ) = default;
+
+		virtual auto read( std::uint64_t address, void* buffer, std::size_t size ) -> bool = 0;
+		// VirtualQueryEx semantics: the region containing address or the first one above it, false past the last
+		virtual auto query( std::uint64_t address, MEMORY_BASIC_INFORMATION& out ) -> bool = 0;
+		// toolhelp style, main module first
+		virtual auto modules( void ) -> std::vector<ME32> = 0;
+	};
+
+	// an open process handle, closed when the last holder lets go of it so a read in flight on another thread
+	// never races the CloseHandle
+	class process_handle {
+	public:
+		explicit process_handle( HANDLE handle ) : handle(handle) {}
+
+		~process_handle( void ) {
+			if (handle)
+				CloseHandle(handle);
+		}
+
+		process_handle( const process_handle& ) = delete;
+		process_handle& operator=( const process_handle& ) = delete;
+
+		auto get( void ) const -> HANDLE {
+			return handle;
+		}
+
+	private:
+		HANDLE handle;
+	};
+
 	struct {
-		HANDLE proc;
+		std::atomic<std::shared_ptr<process_handle>> proc; // published the same way as source
 		std::int32_t pid;
 		std::uint64_t process_base;
+		// swapped on attach and detach while engine threads read through it. a reader takes its own reference
+		// for the call, so the source it picked up lives until it's done with it
+		std::atomic<std::shared_ptr<memory_source>> source;
+		// bumped by every detach. work that outlives an attach (a worker walking RTTI, say) tags itself with it
+		// and drops what it found if it moved on
+		std::atomic<std::uint64_t> generation;
 	} inline state;
 
+	inline auto attach_generation( void ) -> std::uint64_t {
+		return state.generation.load(std::memory_order_acquire);
+	}
+
+	inline auto attached_source( void ) -> std::shared_ptr<memory_source> {
+		return state.source.load(std::memory_order_acquire);
+	}
+
+	inline auto attached_process( void ) -> std::shared_ptr<process_handle> {
+		return state.proc.load(std::memory_order_acquire);
+	}
+
+	inline auto attached( void ) -> bool {
+		return attached_process() || attached_source();
+	}
+
 	inline auto get_processes( void ) -> std::vector<PE32> {
 		auto snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
 		std::vector<PE32> ret;
@@ -45,7 +115,7 @@ namespace reblox::memory {
 	}
 
 	inline auto open_process( std::int32_t pid ) -> HANDLE {
-		return OpenProcess(PROCESS_VM_READ | PROCESS_VM_WRITE, FALSE, static_cast<DWORD>(pid)); // i think?
+		return OpenProcess(PROCESS_VM_READ | PROCESS_VM_WRITE | PROCESS_QUERY_INFORMATION, FALSE, static_cast<DWORD>(pid)); // query for VirtualQueryEx
 	}
 
 	inline auto get_module_base(std::wstring mod) -> std::uint64_t {
@@ -68,16 +138,6 @@ namespace reblox::memory {
 		return ret;
 	}
 
-	inline auto attach_to_process(std::wstring process_name) -> bool {
-		DWORD pid = get_pid(process_name);
-		state.pid = static_cast<std::int32_t>(pid);
-		state.proc = open_process(pid);
-		if (state.proc == nullptr) return false;
-
-		state.process_base = get_module_base(process_name);
-		return state.process_base != 0;
-	}
-
 	// UD Trust
 	inline std::string WStringToString(const std::wstring& wstr) {
 		if (wstr.empty()) return std::string();
@@ -87,31 +147,279 @@ namespace reblox::memory {
 		return strTo;
 	} // 0x108 why is this in a namespace dedicated to interacting with external processes
 
+	inline auto read_bytes( std::uint64_t address, void* buffer, std::size_t size ) -> bool {
+		stats::scoped_timer timing(stats::timer::read);
+		bool ok;
+		if (auto source = attached_source())
+			ok = source->read(address, buffer, size);
+		else if (auto process = attached_process()) {
+			SIZE_T bytes_read = 0;
+			ok = ReadProcessMemory(process->get(), reinterpret_cast<LPCVOID>(address), buffer, size, &bytes_read) && bytes_read == size;
+		}
+		else
+			ok = false;
+
+		stats::add(stats::counter::reads);
+		stats::add(ok ? stats::counter::bytes_read : stats::counter::failed_reads, ok ? size : 1);
+		return ok;
+	}
+
+	inline auto query_memory( std::uint64_t address, MEMORY_BASIC_INFORMATION& mbi ) -> bool {
+		stats::scoped_timer timing(stats::timer::query);
+		stats::add(stats::counter::queries);
+		if (auto source = attached_source())
+			return source->query(address, mbi);
+
+		auto process = attached_process();
+		return process && VirtualQueryEx(process->get(), reinterpret_cast<LPCVOID>(address), &mbi, sizeof(mbi)) == sizeof(mbi);
+	}
+
+	struct scatter_read {
+		std::uint64_t address;
+		void* buffer;
+		std::size_t size;
+		bool ok;
+	};
+
+	// reads a batch of (usually small) blocks. neighbours that sit within max_gap of each other get merged
+	// into one ReadProcessMemory call of at most max_span bytes, so heap nodes allocated next to each other
+	// cost one syscall instead of one each. if a merged span fails we fall back to reading its entries one by one
+	inline auto read_scatter( std::span<scatter_read> reads, std::size_t max_gap = 0x1000, std::size_t max_span = 0x10000 ) -> std::size_t {
+		thread_local std::vector<std::uint32_t> order;
+		thread_local std::vector<std::uint8_t> scratch;
+
+		stats::scoped_timer timing(stats::timer::scatter);
+		stats::add(stats::counter::scatter_batches);
+		stats::add(stats::counter::scatter_entries, reads.size());
+
+		order.resize(reads.size());
+		for (std::uint32_t i = 0; i < order.size(); i++)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) { return reads[a].address < reads[b].address; });
+
+		std::size_t succeeded = 0;
+		for (std::size_t i = 0; i < order.size();) {
+			std::uint64_t span_begin = reads[order[i]].address;
+			std::uint64_t span_end = span_begin + reads[order[i]].size;
+
+			std::size_t j = i + 1;
+			for (; j < order.size(); j++) {
+				auto& next = reads[order[j]];
+				std::uint64_t next_end = (std::max)(span_end, next.address + next.size);
+				if (next.address > span_end + max_gap || next_end - span_begin > max_span)
+					break;
+				span_end = next_end;
+			}
+
+			if (j - i == 1) {
+				auto& read = reads[order[i]];
+				read.ok = read_bytes(read.address, read.buffer, read.size);
+				succeeded += read.ok;
+				i = j;
+				continue;
+			}
+
+			scratch.resize(static_cast<std::size_t>(span_end - span_begin));
+			bool span_ok = read_bytes(span_begin, scratch.data(), scratch.size());
+			for (; i < j; i++) {
+				auto& read = reads[order[i]];
+				if (span_ok) {
+					std::memcpy(read.buffer, scratch.data() + (read.address - span_begin), read.size);
+					read.ok = true;
+				}
+				else {
+					read.ok = read_bytes(read.address, read.buffer, read.size);
+				}
+				succeeded += read.ok;
+			}
+		}
+
+		return succeeded;
+	}
+
+	inline constexpr std::size_t page_size = 0x1000;
+	inline constexpr std::size_t default_string_limit = 0x1000;
+
+	// index of the first zero element, or count if there is none. 16 bytes per compare
+	template <typename char_t>
+	inline auto find_terminator( const char_t* data, std::size_t count ) -> std::size_t {
+		static_assert(sizeof(char_t) == 1 || sizeof(char_t) == 2);
+
+		const auto* bytes = reinterpret_cast<const std::uint8_t*>(data);
+		const std::size_t size = count * sizeof(char_t);
+		const __m128i zero = _mm_setzero_si128();
+
+		std::size_t i = 0;
+		for (; i + 16 <= size; i += 16) {
+			__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+			__m128i eq;
+			if constexpr (sizeof(char_t) == 1)
+				eq = _mm_cmpeq_epi8(chunk, zero);
+			else
+				eq = _mm_cmpeq_epi16(chunk, zero);
+
+			if (unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(eq)))
+				return (i + std::countr_zero(mask)) / sizeof(char_t);
+		}
+
+		for (std::size_t c = i / sizeof(char_t); c < count; c++) {
+			if (data[c] == 0)
+				return c;
+		}
+
+		return count;
+	}
+
+	// chunk sizes for walking a string: a small first read that never leaves the starting page, then whole pages.
+	// a string sitting right before an unmapped page still reads fine because we never ask for bytes past it
+	inline auto next_string_chunk( std::uint64_t address, std::size_t remaining, bool first ) -> std::size_t {
+		std::size_t to_page_end = page_size - static_cast<std::size_t>(address & (page_size - 1));
+		std::size_t chunk = first ? (std::min)(to_page_end, std::size_t(256)) : to_page_end;
+		return (std::min)(chunk, remaining);
+	}
+
+	// reads a zero terminated string of char or wchar_t, at most limit characters (truncated if longer)
+	template <typename char_t = char>
+	inline auto read_c_string( std::uint64_t address, std::size_t limit = default_string_limit ) -> std::basic_string<char_t> {
+		std::basic_string<char_t> ret;
+		if (!address)
+			return ret;
+
+		std::size_t remaining = limit * sizeof(char_t);
+		bool first = true;
+		while (remaining >= sizeof(char_t)) {
+			std::size_t chunk = next_string_chunk(address, remaining, first) & ~(sizeof(char_t) - 1);
+			if (!chunk) // utf-16 character straddling a page boundary
+				chunk = sizeof(char_t);
+
+			std::size_t old_size = ret.size();
+			ret.resize(old_size + chunk / sizeof(char_t));
+			if (!read_bytes(address, ret.data() + old_size, chunk)) {
+				ret.resize(old_size);
+				break;
+			}
+
+			std::size_t end = find_terminator(ret.data() + old_size, chunk / sizeof(char_t));
+			if (end != chunk / sizeof(char_t)) {
+				ret.resize(old_size + end);
+				break;
+			}
+
+			address += chunk;
+			remaining -= chunk;
+			first = false;
+		}
+
+		return ret;
+	}
+
+	inline auto read_wide_string( std::uint64_t address, std::size_t limit = default_string_limit ) -> std::wstring {
+		return read_c_string<wchar_t>(address, limit);
+	}
+
+	// strings stored as a length followed by the characters (prefix_t counts characters, not bytes)
+	template <typename prefix_t = std::uint32_t, typename char_t = char>
+	inline auto read_prefixed_string( std::uint64_t address, std::size_t limit = default_string_limit ) -> std::basic_string<char_t> {
+		prefix_t length{};
+		if (!read_bytes(address, &length, sizeof(length)))
+			return {};
+
+		std::basic_string<char_t> ret(static_cast<std::size_t>((std::min)(static_cast<std::uint64_t>(length), static_cast<std::uint64_t>(limit))), char_t{});
+		if (!ret.empty() && !read_bytes(address + sizeof(prefix_t), ret.data(), ret.size() * sizeof(char_t)))
+			return {};
+
+		return ret;
+	}
+
+	// read_c_string for a whole batch of pointers. every round is one read_scatter over the strings that
+	// are still unterminated, so most batches finish in one or two rounds no matter how many strings there are
+	template <typename char_t = char>
+	inline auto read_c_strings( std::span<const std::uint64_t> addresses, std::size_t limit = default_string_limit ) -> std::vector<std::basic_string<char_t>> {
+		struct pending {
+			std::size_t index;
+			std::uint64_t address;
+			std::size_t remaining;
+		};
+
+		std::vector<std::basic_string<char_t>> ret(addresses.size());
+		std::vector<pending> open;
+		std::vector<scatter_read> reads;
+		open.reserve(addresses.size());
+		reads.reserve(addresses.size());
+
+		for (std::size_t i = 0; i < addresses.size(); i++) {
+			if (addresses[i])
+				open.push_back({ i, addresses[i], limit * sizeof(char_t) });
+		}
+
+		bool first = true;
+		while (!open.empty()) {
+			reads.clear();
+			for (auto& p : open) {
+				std::size_t chunk = next_string_chunk(p.address, p.remaining, first) & ~(sizeof(char_t) - 1);
+				if (!chunk)
+					chunk = sizeof(char_t);
+
+				auto& str = ret[p.index];
+				std::size_t old_size = str.size();
+				str.resize(old_size + chunk / sizeof(char_t));
+				reads.push_back({ p.address, str.data() + old_size, chunk, false });
+			}
+			read_scatter(reads);
+
+			std::size_t alive = 0;
+			for (std::size_t i = 0; i < open.size(); i++) {
+				auto& p = open[i];
+				auto& str = ret[p.index];
+				std::size_t chars = reads[i].size / sizeof(char_t);
+				std::size_t old_size = str.size() - chars;
+
+				if (!reads[i].ok) {
+					str.resize(old_size);
+					continue;
+				}
+
+				std::size_t end = find_terminator(str.data() + old_size, chars);
+				if (end != chars) {
+					str.resize(old_size + end);
+					continue;
+				}
+
+				p.address += reads[i].size;
+				p.remaining -= reads[i].size;
+				if (p.remaining >= sizeof(char_t))
+					open[alive++] = p;
+			}
+
+			open.resize(alive);
+			first = false;
+		}
+
+		return ret;
+	}
+
 	template <typename t>
 	inline t read_memory( std::uint64_t address ) {
 		t buffer{};
-		ReadProcessMemory(state.proc, reinterpret_cast<LPCVOID>(address), &buffer, sizeof(t), nullptr);
+		read_bytes(address, &buffer, sizeof(t));
 		return buffer;
 	}
 
 	template <>
 	inline std::string read_memory<std::string>( std::uint64_t address ) {
-		std::string buffer;
-		char temp[256];
-		ReadProcessMemory(state.proc, reinterpret_cast<LPCVOID>(address), &temp, sizeof(temp), nullptr);
-		temp[255] = '\0'; // fix warning | would crash (?) on std::string initializer in case of no null terminator
-		buffer = std::string(temp);
-		return buffer;
+		return read_c_string(address);
 	}
 
 	template <typename t>
 	inline bool write_memory( std::uint64_t address, t value ) {
-		return WriteProcessMemory(state.proc, reinterpret_cast<LPVOID>(address), &value, sizeof(t), nullptr);
+		auto process = attached_process();
+		return process && WriteProcessMemory(process->get(), reinterpret_cast<LPVOID>(address), &value, sizeof(t), nullptr);
 	}
 
 	template <>
 	inline bool write_memory<std::string>( std::uint64_t address, std::string value ) {
-		return WriteProcessMemory(state.proc, reinterpret_cast<LPVOID>(address), value.c_str(), value.size() + 1, nullptr);
+		auto process = attached_process();
+		return process && WriteProcessMemory(process->get(), reinterpret_cast<LPVOID>(address), value.c_str(), value.size() + 1, nullptr);
 	}
 
 	namespace rtti {
@@ -133,14 +441,52 @@ namespace reblox::memory {
 			//char        name[]; //needs to be done dynamically(ish)
 		};
 
-		inline std::string get_mangled_object_name(std::uint64_t object_addr) { // C++ needs a verbose parent namespace access operator
-			if (!state.proc || !object_addr)
-				return {};
+		// vfptr -> mangled type name. get_mangled_vtable_name fills it, attach seeds it from disk (attach.h)
+		class vtable_cache {
+		public:
+			auto lookup( std::uint64_t vfptr ) -> std::optional<std::string> {
+				std::shared_lock guard(lock);
+				auto it = names.find(vfptr);
+				stats::add(it == names.end() ? stats::counter::vtable_cache_misses : stats::counter::vtable_cache_hits);
+				if (it == names.end())
+					return std::nullopt;
+				return it->second;
+			}
+
+			// generation is the attach the name was read under, a name from a target we've since left is dropped.
+			// detach bumps the generation before it clears, so nothing stale gets in after the clear either
+			auto store( std::uint64_t vfptr, std::string name, std::uint64_t generation ) -> void {
+				std::unique_lock guard(lock);
+				if (generation == attach_generation())
+					names.insert_or_assign(vfptr, std::move(name));
+			}
+
+			auto clear( void ) -> void {
+				std::unique_lock guard(lock);
+				names.clear();
+			}
+
+			auto entries( void ) -> std::vector<std::pair<std::uint64_t, std::string>> {
+				std::shared_lock guard(lock);
+				return { names.begin(), names.end() };
+			}
 
-			std::uint64_t vfptr = read_memory<std::uint64_t>(object_addr);
-			if (!vfptr)
+		private:
+			std::shared_mutex lock;
+			std::unordered_map<std::uint64_t, std::string> names;
+		};
+
+		inline vtable_cache vtables;
+
+		inline std::string get_mangled_vtable_name(std::uint64_t vfptr) {
+			if (!attached() || !vfptr)
 				return {};
 
+			if (auto cached = vtables.lookup(vfptr))
+				return *cached;
+
+			std::uint64_t generation = attach_generation();
+
 			std::uint64_t col_ptr_addr = vfptr - sizeof(std::uint64_t);
 			std::uint64_t col_addr = read_memory<std::uint64_t>(col_ptr_addr);
 			if (!col_addr)
@@ -164,7 +510,17 @@ namespace reblox::memory {
 				read_memory<TypeDescriptor>(type_desc_addr);
 
 			std::uint64_t name_addr = type_desc_addr + sizeof(TypeDescriptor);
-			return read_memory<std::string>(name_addr);
+			std::string name = read_memory<std::string>(name_addr);
+			if (!name.empty())
+				vtables.store(vfptr, name, generation);
+			return name;
+		}
+
+		inline std::string get_mangled_object_name(std::uint64_t object_addr) { // C++ needs a verbose parent namespace access operator
+			if (!attached() || !object_addr)
+				return {};
+
+			return get_mangled_vtable_name(read_memory<std::uint64_t>(object_addr));
 		}
 
 		inline std::string demangle_msvc_rtti(const std::string& name)
@@ -0,0 +1,370 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <cstdio>
+#include <cwctype>
+#include "memory.h"
+
+namespace reblox::memory {
+	struct module_section {
+		char name[IMAGE_SIZEOF_SHORT_NAME + 1];
+		std::uint32_t rva;
+		std::uint32_t size;
+		std::uint32_t characteristics;
+	};
+
+	struct module_export {
+		std::string name; // empty for ordinal-only exports
+		std::uint32_t rva;
+		std::uint16_t ordinal;
+		bool forwarded; // rva points at a "dll.func" string, not code
+	};
+
+	struct module_info {
+		std::wstring name;
+		std::string name_utf8;
+		std::wstring path;
+		std::uint64_t base;
+		std::uint32_t size;
+		std::uint32_t timestamp; // IMAGE_FILE_HEADER::TimeDateStamp, identifies the build
+		bool is_64;
+		std::vector<module_section> sections; // sorted by rva
+		std::vector<module_export> exports;
+
+		auto contains( std::uint64_t address ) const -> bool {
+			return address - base < size;
+		}
+
+		auto section_at( std::uint64_t address ) const -> const module_section* {
+			std::uint64_t rva = address - base;
+			auto it = std::upper_bound(sections.begin(), sections.end(), rva, [](std::uint64_t value, const module_section& s) { return value < s.rva; });
+			if (it == sections.begin())
+				return nullptr;
+			--it;
+			return rva - it->rva < (std::max)(it->size, 1u) ? &*it : nullptr;
+		}
+	};
+
+	struct module_location {
+		const module_info* module;
+		const module_section* section;
+		std::uint64_t offset; // from the section if there is one, otherwise from the module base
+	};
+
+	inline auto get_modules( std::int32_t pid ) -> std::vector<ME32> {
+		auto snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE | TH32CS_SNAPMODULE32, static_cast<DWORD>(pid));
+		std::vector<ME32> ret;
+		if (snapshot == INVALID_HANDLE_VALUE)
+			return ret;
+
+		ME32 module_entry{};
+		module_entry.dwSize = sizeof(ME32);
+
+		if (!Module32First(snapshot, &module_entry)) goto cleanup;
+		do {
+			ret.push_back(module_entry);
+		} while (Module32Next(snapshot, &module_entry));
+
+	cleanup:
+		CloseHandle(snapshot);
+		return ret;
+	}
+
+	// reads everything we want out of the mapped headers: sections, timestamp and the export table.
+	// the export directory and the three arrays it points at are pulled with a single read
+	inline auto parse_module( const ME32& entry ) -> module_info {
+		module_info ret{};
+		ret.name = entry.szModule;
+		ret.name_utf8 = WStringToString(ret.name);
+		ret.path = entry.szExePath;
+		ret.base = reinterpret_cast<std::uint64_t>(entry.modBaseAddr);
+		ret.size = entry.modBaseSize;
+
+		std::uint8_t headers[page_size];
+		if (!read_bytes(ret.base, headers, sizeof(headers)))
+			return ret;
+
+		auto dos = reinterpret_cast<const IMAGE_DOS_HEADER*>(headers);
+		if (dos->e_magic != IMAGE_DOS_SIGNATURE || dos->e_lfanew <= 0 || dos->e_lfanew > static_cast<LONG>(sizeof(headers) - sizeof(IMAGE_NT_HEADERS64)))
+			return ret;
+
+		auto nt = reinterpret_cast<const IMAGE_NT_HEADERS64*>(headers + dos->e_lfanew);
+		if (nt->Signature != IMAGE_NT_SIGNATURE)
+			return ret;
+
+		ret.timestamp = nt->FileHeader.TimeDateStamp;
+		ret.is_64 = nt->OptionalHeader.Magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC;
+
+		IMAGE_DATA_DIRECTORY export_dir{};
+		if (ret.is_64)
+			export_dir = nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+		else
+			export_dir = reinterpret_cast<const IMAGE_NT_HEADERS32*>(nt)->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+
+		// IMAGE_FIRST_SECTION only depends on FileHeader so it's the same for both header flavours
+		// a corrupt SizeOfOptionalHeader can put it past the headers we read
+		auto first_section = reinterpret_cast<const std::uint8_t*>(IMAGE_FIRST_SECTION(nt));
+		if (first_section > headers + sizeof(headers))
+			return ret;
+		std::size_t section_count = nt->FileHeader.NumberOfSections;
+		std::size_t max_sections = (headers + sizeof(headers) - first_section) / sizeof(IMAGE_SECTION_HEADER);
+		section_count = (std::min)(section_count, max_sections);
+
+		for (std::size_t i = 0; i < section_count; i++) {
+			IMAGE_SECTION_HEADER header;
+			std::memcpy(&header, first_section + i * sizeof(header), sizeof(header));
+
+			module_section& section = ret.sections.emplace_back();
+			std::memcpy(section.name, header.Name, IMAGE_SIZEOF_SHORT_NAME);
+			section.name[IMAGE_SIZEOF_SHORT_NAME] = '\0';
+			section.rva = header.VirtualAddress;
+			section.size = header.Misc.VirtualSize ? header.Misc.VirtualSize : header.SizeOfRawData;
+			section.characteristics = header.Characteristics;
+		}
+		std::sort(ret.sections.begin(), ret.sections.end(), [](const module_section& a, const module_section& b) { return a.rva < b.rva; });
+
+		if (!export_dir.VirtualAddress || export_dir.Size < sizeof(IMAGE_EXPORT_DIRECTORY) || export_dir.VirtualAddress >= ret.size)
+			return ret;
+
+		IMAGE_EXPORT_DIRECTORY directory;
+		if (!read_bytes(ret.base + export_dir.VirtualAddress, &directory, sizeof(directory)))
+			return ret;
+
+		constexpr std::uint32_t max_exports = 1 << 20;
+		if (directory.NumberOfFunctions > max_exports || directory.NumberOfNames > directory.NumberOfFunctions)
+			return ret;
+
+		// one window covering the directory and the function/name/ordinal arrays, linkers put them next to each other
+		std::uint64_t lo = export_dir.VirtualAddress;
+		std::uint64_t hi = static_cast<std::uint64_t>(export_dir.VirtualAddress) + export_dir.Size;
+		auto widen = [&](std::uint32_t rva, std::uint64_t bytes) {
+			lo = (std::min)(lo, static_cast<std::uint64_t>(rva));
+			hi = (std::max)(hi, rva + bytes);
+		};
+		widen(directory.AddressOfFunctions, directory.NumberOfFunctions * 4ull);
+		widen(directory.AddressOfNames, directory.NumberOfNames * 4ull);
+		widen(directory.AddressOfNameOrdinals, directory.NumberOfNames * 2ull);
+		if (hi > ret.size || hi - lo > 0x4000000)
+			return ret;
+
+		std::vector<std::uint8_t> window(static_cast<std::size_t>(hi - lo));
+		if (!read_bytes(ret.base + lo, window.data(), window.size()))
+			return ret;
+
+		auto functions = reinterpret_cast<const std::uint32_t*>(window.data() + (directory.AddressOfFunctions - lo));
+		auto names = reinterpret_cast<const std::uint32_t*>(window.data() + (directory.AddressOfNames - lo));
+		auto ordinals = reinterpret_cast<const std::uint16_t*>(window.data() + (directory.AddressOfNameOrdinals - lo));
+
+		ret.exports.resize(directory.NumberOfFunctions);
+		for (std::uint32_t i = 0; i < directory.NumberOfFunctions; i++) {
+			auto& exp = ret.exports[i];
+			exp.rva = functions[i];
+			exp.ordinal = static_cast<std::uint16_t>(directory.Base + i);
+			exp.forwarded = exp.rva - export_dir.VirtualAddress < export_dir.Size;
+		}
+
+		// names that live inside the window are free, the rest go out as one batch
+		std::vector<std::uint64_t> far_names;
+		std::vector<std::uint32_t> far_index;
+		for (std::uint32_t i = 0; i < directory.NumberOfNames; i++) {
+			if (ordinals[i] >= ret.exports.size())
+				continue;
+
+			std::uint32_t rva = names[i];
+			if (rva >= lo && rva < hi) {
+				auto str = reinterpret_cast<const char*>(window.data() + (rva - lo));
+				std::size_t length = find_terminator(str, static_cast<std::size_t>(hi - rva));
+				ret.exports[ordinals[i]].name.assign(str, length);
+			}
+			else {
+				far_names.push_back(ret.base + rva);
+				far_index.push_back(ordinals[i]);
+			}
+		}
+
+		if (!far_names.empty()) {
+			auto resolved = read_c_strings(far_names, 512);
+			for (std::size_t i = 0; i < resolved.size(); i++)
+				ret.exports[far_index[i]].name = std::move(resolved[i]);
+		}
+
+		// unused slots in the function array are zero
+		std::erase_if(ret.exports, [](const module_export& exp) { return exp.rva == 0; });
+		return ret;
+	}
+
+	// one published version of the module list, sorted by base. lookups are a binary search over a flat array
+	// of bases; modules that are still loaded are carried over between versions as-is
+	struct module_snapshot {
+		std::vector<std::shared_ptr<const module_info>> modules;
+		std::vector<std::uint64_t> bases;
+		std::vector<std::uint64_t> ends;
+		std::uint64_t generation = 0;
+
+		static constexpr std::size_t none = ~std::size_t(0);
+
+		auto index_of( std::uint64_t address ) const -> std::size_t {
+			auto it = std::upper_bound(bases.begin(), bases.end(), address);
+			if (it == bases.begin())
+				return none;
+
+			std::size_t i = static_cast<std::size_t>(it - bases.begin()) - 1;
+			return address < ends[i] ? i : none;
+		}
+
+		auto find( std::uint64_t address ) const -> const module_info* {
+			std::size_t i = index_of(address);
+			return i == none ? nullptr : modules[i].get();
+		}
+	};
+
+	// every module of the attached process. built on attach, refresh() (a background task on the frame loop)
+	// only parses modules that weren't there before and publishes a new snapshot, so pool workers looking
+	// modules up never see one half built. a module_info from find() stays good until the next detach, even
+	// if its module unloads: dropped modules are parked rather than freed
+	class module_map {
+	public:
+		module_map( void ) {
+			published.store(std::make_shared<const module_snapshot>(), std::memory_order_release);
+		}
+
+		auto build( std::span<const ME32> entries ) -> void {
+			std::lock_guard guard(refresh_lock);
+			retired.clear();
+			publish(merge(module_snapshot{}, entries), current()->generation + 1);
+		}
+
+		// returns true if anything was loaded or unloaded since the last call
+		auto refresh( void ) -> bool {
+			if (attached_source() || !attached())
+				return false; // files don't load anything
+
+			std::lock_guard guard(refresh_lock);
+			std::uint64_t attach = attach_generation();
+			auto previous = current();
+			auto entries = get_modules(state.pid);
+			if (entries.empty())
+				return false;
+
+			// both sorted by base, so the same list is the same pointers in the same order
+			auto next = merge(*previous, entries);
+			if (next == previous->modules || attach != attach_generation())
+				return false; // unchanged, or detached while we were parsing and the map is the next attach's now
+
+			for (auto& module : previous->modules) {
+				auto kept = std::lower_bound(next.begin(), next.end(), module, by_base);
+				if (kept == next.end() || *kept != module)
+					retired.push_back(module);
+			}
+			publish(std::move(next), previous->generation + 1);
+			return true;
+		}
+
+		auto clear( void ) -> void {
+			std::lock_guard guard(refresh_lock);
+			publish({}, current()->generation + 1);
+			retired.clear();
+		}
+
+		// the whole list, kept alive for as long as the caller holds it
+		auto current( void ) const -> std::shared_ptr<const module_snapshot> {
+			return published.load(std::memory_order_acquire);
+		}
+
+		auto find( std::uint64_t address ) const -> const module_info* {
+			return current()->find(address);
+		}
+
+		auto locate( std::uint64_t address ) const -> module_location {
+			const module_info* module = find(address);
+			if (!module)
+				return {};
+
+			const module_section* section = module->section_at(address);
+			return { module, section, address - module->base - (section ? section->rva : 0) };
+		}
+
+		// "module!section+0xNN", writes into buf so it can run for every visible row without allocating
+		auto describe( std::uint64_t address, char* buf, std::size_t size ) const -> std::size_t {
+			auto location = locate(address);
+			if (!location.module || !size)
+				return 0;
+
+			int written = location.section
+				? snprintf(buf, size, "%s!%s+0x%llX", location.module->name_utf8.c_str(), location.section->name, static_cast<unsigned long long>(location.offset))
+				: snprintf(buf, size, "%s+0x%llX", location.module->name_utf8.c_str(), static_cast<unsigned long long>(location.offset));
+			return written < 0 ? 0 : (std::min)(static_cast<std::size_t>(written), size - 1);
+		}
+
+		auto describe( std::uint64_t address ) const -> std::string {
+			char buf[512];
+			return std::string(buf, describe(address, buf, sizeof(buf)));
+		}
+
+		auto by_name( std::wstring_view name ) const -> const module_info* {
+			for (auto& module : current()->modules) {
+				if (module->name.size() == name.size() && std::equal(name.begin(), name.end(), module->name.begin(), [](wchar_t a, wchar_t b) { return towlower(a) == towlower(b); }))
+					return module.get();
+			}
+			return nullptr;
+		}
+
+		// bumped on every change, lets caches keyed on modules (symbols, annotations) know when to drop
+		auto get_generation( void ) const -> std::uint64_t {
+			return current()->generation;
+		}
+
+	private:
+		static auto by_base( const std::shared_ptr<const module_info>& a, const std::shared_ptr<const module_info>& b ) -> bool {
+			return a->base < b->base;
+		}
+
+		// the modules of entries, sorted by base. ones previous already has are shared, not parsed again
+		static auto merge( const module_snapshot& previous, std::span<const ME32> entries ) -> std::vector<std::shared_ptr<const module_info>> {
+			std::vector<std::shared_ptr<const module_info>> next;
+			next.reserve(entries.size());
+
+			for (auto& entry : entries) {
+				std::uint64_t base = reinterpret_cast<std::uint64_t>(entry.modBaseAddr);
+				std::size_t i = previous.index_of(base);
+				if (i != module_snapshot::none) {
+					auto& existing = previous.modules[i];
+					if (existing->base == base && existing->size == entry.modBaseSize && existing->name == entry.szModule) {
+						next.push_back(existing);
+						continue;
+					}
+				}
+
+				next.push_back(std::make_shared<const module_info>(parse_module(entry)));
+			}
+
+			std::sort(next.begin(), next.end(), by_base);
+			return next;
+		}
+
+		auto publish( std::vector<std::shared_ptr<const module_info>>&& modules, std::uint64_t generation ) -> void {
+			auto next = std::make_shared<module_snapshot>();
+			next->modules = std::move(modules);
+			next->generation = generation;
+			next->bases.reserve(next->modules.size());
+			next->ends.reserve(next->modules.size());
+			for (auto& module : next->modules) {
+				next->bases.push_back(module->base);
+				next->ends.push_back(module->base + module->size);
+			}
+			published.store(std::move(next), std::memory_order_release);
+		}
+
+		std::atomic<std::shared_ptr<const module_snapshot>> published;
+		std::mutex refresh_lock; // build, refresh and clear, one at a time
+		std::vector<std::shared_ptr<const module_info>> retired; // unloaded since the attach, see find()
+	};
+
+	inline module_map modules;
+}
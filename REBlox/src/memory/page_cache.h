@@ -0,0 +1,217 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <emmintrin.h>
+#include "memory.h"
+#include "read_engine.h"
+
+namespace reblox::memory {
+	using page_heat = std::array<std::uint8_t, page_size>;
+
+	struct cached_page {
+		std::array<std::uint8_t, page_size> data;
+		std::unique_ptr<page_heat> heat; // refreshes left in each byte's change fade, only while something is fading
+		std::uint64_t version; // bumped every time a fetch for this page lands
+		std::uint64_t last_used; // frame number, for eviction
+		bool ok; // false if the page couldn't be read, data is zero then
+	};
+
+	// ages every byte's heat by one refresh and resets it to fade where before and after differ, 16 bytes at a
+	// time. returns true while anything is still warm
+	inline auto mark_changes( const std::uint8_t* before, const std::uint8_t* after, std::uint8_t* heat, std::uint8_t fade ) -> bool {
+		const __m128i one = _mm_set1_epi8(1);
+		const __m128i full = _mm_set1_epi8(static_cast<char>(fade));
+		const __m128i zero = _mm_setzero_si128();
+
+		int warm = 0;
+		for (std::size_t i = 0; i < page_size; i += 16) {
+			__m128i same = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(before + i)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(after + i)));
+			__m128i aged = _mm_subs_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(heat + i)), one);
+			__m128i next = _mm_or_si128(_mm_and_si128(same, aged), _mm_andnot_si128(same, full));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(heat + i), next);
+			warm |= _mm_movemask_epi8(_mm_cmpeq_epi8(next, zero)) ^ 0xFFFF;
+		}
+
+		return warm != 0;
+	}
+
+	// page granular cache of target memory for views that must never block on ReadProcessMemory. lives on
+	// the UI thread: views peek, missing pages are queued here and fed to the read engine a few at a time
+	// (visible before prefetch), and they land when reads.drain() runs their completions. keeping the queue
+	// on our side means requests for rows that scrolled away are simply dropped at the next begin_frame()
+	class page_cache {
+	public:
+		enum struct priority {
+			visible,
+			prefetch
+		};
+
+		static constexpr std::size_t capacity = 2048; // pages, 8 MiB
+		static constexpr std::uint8_t max_fade = 64;
+		static constexpr std::size_t max_outstanding = 16; // reads handed to the engine at once
+
+		static constexpr auto page_of( std::uint64_t address ) -> std::uint64_t {
+			return address & ~static_cast<std::uint64_t>(page_size - 1);
+		}
+
+		// drops requests nobody re-asked for and trims the cache. once per frame, after reads.drain()
+		auto begin_frame( void ) -> void {
+			frame++;
+			for (auto& queue : queues)
+				queue.clear();
+			queued.clear();
+			std::swap(wanted, wanted_before);
+			wanted.clear();
+
+			evict();
+		}
+
+		// the page if we have it (possibly stale while a refresh is in flight), nullptr if it's still coming
+		auto find( std::uint64_t page ) -> const cached_page* {
+			auto it = pages.find(page);
+			if (it == pages.end())
+				return nullptr;
+
+			it->second->last_used = frame;
+			return it->second.get();
+		}
+
+		// queues a fetch unless the page is cached and fresh or already on its way. a page counts as a hit or a
+		// miss once when a view starts wanting it, not on every frame it stays wanted
+		auto request( std::uint64_t page, priority p ) -> void {
+			if (wanted.insert(page).second && !wanted_before.contains(page))
+				stats::add(pages.contains(page) ? stats::counter::page_cache_hits : stats::counter::page_cache_misses);
+
+			if (queued.contains(page) || in_flight.contains(page) || (pages.contains(page) && !stale.contains(page)))
+				return;
+
+			queued.insert(page);
+			queues[static_cast<std::size_t>(p)].push_back(page);
+			pump();
+		}
+
+		// how many refreshes a changed byte stays highlighted for
+		auto set_fade( std::uint8_t refreshes ) -> void {
+			fade = std::clamp(refreshes, std::uint8_t(1), max_fade);
+		}
+
+		auto get_fade( void ) const -> std::uint8_t {
+			return fade;
+		}
+
+		auto is_pending( std::uint64_t page ) const -> bool {
+			return queued.contains(page) || in_flight.contains(page);
+		}
+
+		// marks pages in [begin, end) for re-fetch. the old bytes stay visible until the new ones land
+		auto invalidate( std::uint64_t begin, std::uint64_t end ) -> void {
+			for (std::uint64_t page = page_of(begin); page < end; page += page_size) {
+				if (pages.contains(page))
+					stale.insert(page);
+			}
+		}
+
+		auto clear( void ) -> void {
+			for (auto& queue : queues)
+				queue.clear();
+			epoch++; // completions of reads already in the engine are ignored
+
+			pages.clear();
+			queued.clear();
+			in_flight.clear();
+			stale.clear();
+			wanted.clear();
+			wanted_before.clear();
+		}
+
+	private:
+		auto pump( void ) -> void {
+			while (in_flight.size() < max_outstanding) {
+				auto& queue = !queues[0].empty() ? queues[0] : queues[1];
+				if (queue.empty())
+					return;
+
+				std::uint64_t page = queue.front();
+				queue.pop_front();
+				queued.erase(page);
+				in_flight.insert(page);
+
+				reads.submit(page, page_size, [this, page, requested_epoch = epoch](read_result& result) {
+					if (requested_epoch != epoch)
+						return;
+
+					in_flight.erase(page);
+					land(page, result);
+					pump();
+				});
+			}
+		}
+
+		auto land( std::uint64_t page, const read_result& result ) -> void {
+			stale.erase(page);
+
+			auto data = std::make_unique<cached_page>();
+			std::memcpy(data->data.data(), result.data.data(), page_size);
+			data->ok = result.ok;
+
+			auto& slot = pages[page];
+			std::uint64_t version = slot ? slot->version + 1 : 1;
+			if (slot && slot->ok && data->ok)
+				diff(*slot, *data);
+			slot = std::move(data);
+			slot->version = version;
+			slot->last_used = frame;
+		}
+
+		auto diff( cached_page& before, cached_page& after ) -> void {
+			after.heat = std::move(before.heat);
+			if (!after.heat) {
+				if (std::memcmp(before.data.data(), after.data.data(), page_size) == 0)
+					return;
+				after.heat = std::make_unique<page_heat>();
+				after.heat->fill(0);
+			}
+
+			if (!mark_changes(before.data.data(), after.data.data(), after.heat->data(), fade))
+				after.heat.reset();
+		}
+
+		auto evict( void ) -> void {
+			if (pages.size() <= capacity)
+				return;
+
+			// drop the least recently used quarter in one go so this doesn't run every frame
+			std::vector<std::pair<std::uint64_t, std::uint64_t>> ages;
+			ages.reserve(pages.size());
+			for (auto& [page, data] : pages)
+				ages.emplace_back(data->last_used, page);
+
+			std::size_t drop = pages.size() - capacity * 3 / 4;
+			std::nth_element(ages.begin(), ages.begin() + drop, ages.end());
+			for (std::size_t i = 0; i < drop; i++) {
+				pages.erase(ages[i].second);
+				stale.erase(ages[i].second);
+			}
+		}
+
+		std::unordered_map<std::uint64_t, std::unique_ptr<cached_page>> pages;
+		std::deque<std::uint64_t> queues[2]; // by priority, not handed to the engine yet
+		std::unordered_set<std::uint64_t> queued;
+		std::unordered_set<std::uint64_t> in_flight; // with the engine
+		std::unordered_set<std::uint64_t> stale;
+		std::unordered_set<std::uint64_t> wanted; // requested this frame
+		std::unordered_set<std::uint64_t> wanted_before; // and the one before, for the hit / miss counts
+		std::uint64_t frame = 0;
+		std::uint64_t epoch = 0;
+		std::uint8_t fade = 8;
+	};
+
+	inline page_cache pages;
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <unordered_set>
+#include "memory.h"
+#include "modules.h"
+#include "regions.h"
+#include "symbols.h"
+#include "scan.h"
+
+namespace reblox::memory {
+	struct pointer_entry {
+		std::uint64_t value; // what it points at
+		std::uint64_t location; // where the pointer lives
+	};
+
+	// every aligned qword in readable memory that points into readable memory, sorted by what it points at.
+	// that's the reverse index pointer path searches walk, built once per target state
+	class pointer_map {
+	public:
+		auto build( std::uint64_t* scanned = nullptr, const job& work = make_job() ) -> std::size_t {
+			timeline::scope traced("pointers", "map build");
+			entries.clear();
+
+			std::vector<std::uint64_t> starts;
+			std::vector<std::uint64_t> ends;
+			for (auto& region : regions.all()) {
+				if (region.readable()) {
+					starts.push_back(region.base);
+					ends.push_back(region.end());
+				}
+			}
+
+			std::mutex lock;
+			std::uint64_t bytes = for_each_chunk_parallel({}, 0, [&](const scan_chunk& chunk) {
+				std::vector<pointer_entry> found;
+				std::size_t count = chunk.starts / sizeof(std::uint64_t);
+				for (std::size_t i = 0; i < count; i++) {
+					std::uint64_t value;
+					std::memcpy(&value, chunk.bytes.data() + i * sizeof(value), sizeof(value));
+					if (value < 0x10000 || value >= 0x800000000000)
+						continue;
+
+					std::size_t below = branchless_upper_bound(starts.data(), starts.size(), value);
+					if (below && value < ends[below - 1])
+						found.push_back({ value, chunk.address + i * sizeof(value) });
+				}
+
+				std::lock_guard guard(lock);
+				entries.insert(entries.end(), found.begin(), found.end());
+			}, work);
+
+			// chunks finish in any order, the location keeps equal values in a stable order for the searches
+			std::sort(entries.begin(), entries.end(), [](const pointer_entry& a, const pointer_entry& b) { return a.value != b.value ? a.value < b.value : a.location < b.location; });
+			traced.set_arg("pointers", entries.size());
+
+			if (scanned)
+				*scanned = bytes;
+			return entries.size();
+		}
+
+		// pointers to anything in [target - max_offset, target]
+		auto referrers( std::uint64_t target, std::uint64_t max_offset ) const -> std::span<const pointer_entry> {
+			std::uint64_t low = target > max_offset ? target - max_offset : 0;
+			auto first = std::lower_bound(entries.begin(), entries.end(), low, [](const pointer_entry& entry, std::uint64_t value) { return entry.value < value; });
+			auto last = std::upper_bound(first, entries.end(), target, [](std::uint64_t value, const pointer_entry& entry) { return value < entry.value; });
+			return { first, last };
+		}
+
+		auto size( void ) const -> std::size_t {
+			return entries.size();
+		}
+
+	private:
+		std::vector<pointer_entry> entries;
+	};
+
+	// [[[base] + offsets[0]] + offsets[1]] ... + offsets.back() == target, with base inside a module image so it
+	// survives a restart (modulo ASLR, which is why it's printed as module+rva)
+	struct pointer_path {
+		std::uint64_t base;
+		std::vector<std::uint64_t> offsets;
+	};
+
+	struct pointer_search {
+		std::size_t max_depth = 4;
+		std::uint64_t max_offset = 0x1000;
+		std::size_t max_results = 1000;
+		std::size_t max_nodes = 1 << 22; // bounds the breadth first search on targets that everything points at
+	};
+
+	// breadth first from the target backwards: every pointer landing at most max_offset below a node becomes
+	// a node one level up. nodes inside a module are static roots and end a path, everything else keeps going.
+	// each address is expanded once, so the shortest paths come out first and cycles can't blow it up
+	inline auto find_pointer_paths( const pointer_map& map, std::uint64_t target, const pointer_search& search = {} ) -> std::vector<pointer_path> {
+		struct node {
+			std::uint64_t address;
+			std::uint64_t offset; // from the value stored at address to the next node's address
+			std::uint32_t parent; // next node towards the target, none for the target itself
+		};
+		constexpr std::uint32_t none = ~0u;
+
+		std::vector<pointer_path> ret;
+		std::vector<node> nodes{ { target, 0, none } };
+		std::unordered_set<std::uint64_t> seen{ target };
+
+		timeline::scope traced("pointers", "path search");
+		std::size_t level_begin = 0;
+		for (std::size_t depth = 0; depth < search.max_depth && ret.size() < search.max_results; depth++) {
+			std::size_t level_end = nodes.size();
+			timeline::scope level("pointers", "level", "nodes", level_end - level_begin);
+			for (std::size_t i = level_begin; i < level_end && ret.size() < search.max_results; i++) {
+				for (auto& entry : map.referrers(nodes[i].address, search.max_offset)) {
+					std::uint64_t offset = nodes[i].address - entry.value;
+
+					if (modules.find(entry.location)) {
+						pointer_path path{ entry.location, { offset } };
+						for (std::uint32_t at = static_cast<std::uint32_t>(i); nodes[at].parent != none; at = nodes[at].parent)
+							path.offsets.push_back(nodes[at].offset);
+
+						ret.push_back(std::move(path));
+						if (ret.size() >= search.max_results)
+							break;
+						continue;
+					}
+
+					if (nodes.size() < search.max_nodes && seen.insert(entry.location).second)
+						nodes.push_back({ entry.location, offset, static_cast<std::uint32_t>(i) });
+				}
+			}
+
+			if (level_end == nodes.size())
+				break;
+			level_begin = level_end;
+		}
+
+		traced.set_arg("paths", ret.size());
+		return ret;
+	}
+
+	// "module.dll+0x1234 -> 0x10 -> 0x8"
+	inline auto format_pointer_path( const pointer_path& path ) -> std::string {
+		char buf[512];
+		const module_info* module = modules.find(path.base);
+		if (module)
+			snprintf(buf, sizeof(buf), "%s+0x%llX", module->name_utf8.c_str(), static_cast<unsigned long long>(path.base - module->base));
+		else
+			snprintf(buf, sizeof(buf), "0x%llX", static_cast<unsigned long long>(path.base));
+
+		std::string ret = buf;
+		for (auto offset : path.offsets) {
+			snprintf(buf, sizeof(buf), " -> 0x%llX", static_cast<unsigned long long>(offset));
+			ret += buf;
+		}
+		return ret;
+	}
+}
@@ -0,0 +1,191 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <span>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+#include <emmintrin.h>
+#include "memory.h"
+#include "modules.h"
+#include "regions.h"
+#include "symbols.h"
+
+namespace reblox::memory {
+	enum struct pointer_kind : std::uint8_t {
+		data, // not a pointer into anything committed
+		module, // into a module image
+		heap, // into private (or mapped) memory
+		vtable // into a module and a vfptr with a known RTTI type
+	};
+
+	struct pointer_class {
+		pointer_kind kind;
+		const module_info* module; // module and vtable
+		const std::string* type; // vtable, demangled. owned by the classifier, valid until its index changes
+	};
+
+	// classifies qwords against a flat index of committed regions with the owning module folded in. a batch
+	// rejects everything outside user space two values at a time, the rest is a branchless search. vfptr
+	// candidates (aligned, into a module's non-executable pages) we haven't seen before are handed to a worker
+	// that walks the RTTI through the vtable cache, so classifying never reads target memory itself. the worker's
+	// requests carry the attach they were made under; after a detach they're dropped, not resolved against
+	// whatever is attached by the time it gets to them
+	class pointer_classifier {
+	public:
+		auto classify( std::span<const std::uint64_t> values, std::span<pointer_class> out ) -> void {
+			sync();
+
+			const __m128i zero = _mm_setzero_si128();
+			std::size_t i = 0;
+			for (; i + 2 <= values.size(); i += 2) {
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values.data() + i));
+
+				// nothing above bit 46 and something above bit 15, per 64 bit lane
+				__m128i high_clear = _mm_cmpeq_epi32(_mm_srli_epi64(v, 47), zero);
+				__m128i low_only = _mm_cmpeq_epi32(_mm_srli_epi64(v, 16), zero);
+				high_clear = _mm_and_si128(high_clear, _mm_shuffle_epi32(high_clear, _MM_SHUFFLE(2, 3, 0, 1)));
+				low_only = _mm_and_si128(low_only, _mm_shuffle_epi32(low_only, _MM_SHUFFLE(2, 3, 0, 1)));
+				int candidates = _mm_movemask_pd(_mm_castsi128_pd(_mm_andnot_si128(low_only, high_clear)));
+
+				out[i] = candidates & 1 ? lookup(values[i]) : pointer_class{};
+				out[i + 1] = candidates & 2 ? lookup(values[i + 1]) : pointer_class{};
+			}
+
+			for (; i < values.size(); i++)
+				out[i] = values[i] >= 0x10000 && values[i] < 0x800000000000 ? lookup(values[i]) : pointer_class{};
+		}
+
+		auto classify( std::uint64_t value ) -> pointer_class {
+			pointer_class ret;
+			classify({ &value, 1 }, { &ret, 1 });
+			return ret;
+		}
+
+	private:
+		auto sync( void ) -> void {
+			const std::uint64_t attached_now = attach_generation();
+			{
+				std::lock_guard guard(lock);
+				if (attach != attached_now) {
+					queue.clear();
+					resolved.clear();
+				}
+				for (auto& entry : resolved) {
+					if (entry.generation == attached_now && !entry.mangled.empty())
+						types.insert_or_assign(entry.vfptr, rtti::demangle_msvc_rtti(entry.mangled));
+				}
+				resolved.clear();
+			}
+
+			if (attach == attached_now && region_generation == regions.get_generation() && module_generation == modules.get_generation())
+				return;
+
+			attach = attached_now;
+			region_generation = regions.get_generation();
+			module_generation = modules.get_generation();
+			starts.clear();
+			ends.clear();
+			spans.clear();
+			types.clear();
+			checked.clear();
+
+			for (auto& region : regions.all()) {
+				if (!region.readable())
+					continue;
+
+				const module_info* module = region.type == MEM_IMAGE ? modules.find(region.base) : nullptr;
+				starts.push_back(region.base);
+				ends.push_back(region.end());
+				spans.push_back({ module, module ? pointer_kind::module : pointer_kind::heap, region.executable() });
+			}
+		}
+
+		auto lookup( std::uint64_t value ) -> pointer_class {
+			std::size_t below = branchless_upper_bound(starts.data(), starts.size(), value);
+			if (!below || value >= ends[below - 1])
+				return {};
+
+			const span_info& span = spans[below - 1];
+			if (span.kind != pointer_kind::module || span.executable || (value & 7))
+				return { span.kind, span.module, nullptr };
+
+			if (auto it = types.find(value); it != types.end())
+				return { pointer_kind::vtable, span.module, &it->second };
+
+			if (checked.insert(value).second) {
+				if (auto type = check(value))
+					return { pointer_kind::vtable, span.module, type };
+			}
+			return { span.kind, span.module, nullptr };
+		}
+
+		// first time we see this candidate: take it from the vtable cache if it's there, otherwise queue it
+		auto check( std::uint64_t vfptr ) -> const std::string* {
+			if (auto cached = rtti::vtables.lookup(vfptr))
+				return &types.insert_or_assign(vfptr, rtti::demangle_msvc_rtti(*cached)).first->second;
+
+			std::lock_guard guard(lock);
+			queue.push_back({ vfptr, attach });
+			if (!worker.joinable())
+				worker = std::jthread([this](std::stop_token stop) { run(stop); });
+			wake.notify_one();
+			return nullptr;
+		}
+
+		auto run( std::stop_token stop ) -> void {
+			std::unique_lock guard(lock);
+			while (!stop.stop_requested()) {
+				wake.wait(guard, stop, [&] { return !queue.empty(); });
+				if (stop.stop_requested())
+					break;
+
+				request next = std::move(queue.back());
+				queue.pop_back();
+				if (next.generation != attach_generation())
+					continue;
+
+				guard.unlock();
+				next.mangled = rtti::get_mangled_vtable_name(next.vfptr);
+				guard.lock();
+
+				// detached while it was walking, sync drops it
+				resolved.push_back(std::move(next));
+			}
+		}
+
+		struct request {
+			std::uint64_t vfptr;
+			std::uint64_t generation; // attach_generation() when it was queued
+			std::string mangled;
+		};
+
+		struct span_info {
+			const module_info* module;
+			pointer_kind kind;
+			bool executable;
+		};
+
+		// UI thread only, parallel arrays sorted by start
+		std::vector<std::uint64_t> starts;
+		std::vector<std::uint64_t> ends;
+		std::vector<span_info> spans;
+		std::unordered_map<std::uint64_t, std::string> types; // vfptr -> demangled name
+		std::unordered_set<std::uint64_t> checked; // vfptr candidates already looked up or queued
+		std::uint64_t region_generation = ~0ull;
+		std::uint64_t module_generation = ~0ull;
+		std::uint64_t attach = ~0ull; // attach_generation() the index and types were built under
+
+		// shared with the worker. demangling stays on the classifying thread, DbgHelp isn't thread safe
+		std::mutex lock;
+		std::condition_variable_any wake;
+		std::vector<request> queue;
+		std::vector<request> resolved;
+		std::jthread worker; // last, so it stops before the rest goes away
+	};
+
+	inline pointer_classifier pointers;
+}
@@ -0,0 +1,197 @@
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <vector>
+#include <optional>
+#include <psapi.h>
+#include "memory.h"
+#include "processes.h"
+#pragma comment (lib, "psapi.lib")
+
+namespace reblox::memory {
+	struct process_details {
+		std::uint64_t working_set;
+		std::uint32_t module_count;
+		DWORD parent_pid;
+		bool wow64;
+		bool accessible; // false if OpenProcess was denied, the other fields are then zero
+	};
+
+	inline auto query_process_details( const process_info& process ) -> process_details {
+		process_details ret{};
+		ret.parent_pid = process.parent_pid;
+
+		HANDLE proc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, process.pid);
+		if (!proc)
+			return ret;
+
+		ret.accessible = true;
+
+		PROCESS_MEMORY_COUNTERS counters{};
+		counters.cb = sizeof(counters);
+		if (GetProcessMemoryInfo(proc, &counters, sizeof(counters)))
+			ret.working_set = counters.WorkingSetSize;
+
+		BOOL wow64 = FALSE;
+		if (IsWow64Process(proc, &wow64))
+			ret.wow64 = wow64;
+
+		CloseHandle(proc);
+
+		auto snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE | TH32CS_SNAPMODULE32, process.pid);
+		if (snapshot != INVALID_HANDLE_VALUE) {
+			ME32 module_entry{};
+			module_entry.dwSize = sizeof(ME32);
+			for (BOOL ok = Module32First(snapshot, &module_entry); ok; ok = Module32Next(snapshot, &module_entry))
+				ret.module_count++;
+			CloseHandle(snapshot);
+		}
+
+		return ret;
+	}
+
+	// details for the picker rows that are actually on screen. the UI asks every frame for its visible rows,
+	// a worker thread fills in whatever is missing or older than the ttl. requests from rows that scrolled
+	// away are dropped at the start of the next frame, so nothing off screen is ever queried
+	class process_details_cache {
+	public:
+		static constexpr std::chrono::seconds ttl{ 5 };
+
+		// the one the worker is on stays in flight, only what it hasn't picked up yet is dropped. an entry
+		// pruned since it was queued stays gone
+		auto begin_frame( void ) -> void {
+			std::lock_guard guard(lock);
+			for (auto& key : queue) {
+				if (auto it = entries.find(key); it != entries.end())
+					it->second.queued = false;
+			}
+			queue.clear();
+		}
+
+		// copies cached details into out. returns false if there's nothing yet (a fetch is queued)
+		auto get( const process_info& process, process_details& out ) -> bool {
+			auto now = std::chrono::steady_clock::now();
+			entry_key key{ process.pid, process.creation_time };
+
+			std::lock_guard guard(lock);
+			auto& entry = entries[key];
+			bool in_flight = fetching && *fetching == key;
+			if (!entry.queued && !in_flight && (!entry.valid || now - entry.fetched > ttl)) {
+				entry.queued = true;
+				entry.parent_pid = process.parent_pid;
+				queue.push_back(key);
+				start();
+				wake.notify_one();
+			}
+
+			if (!entry.valid)
+				return false;
+
+			out = entry.details;
+			return true;
+		}
+
+		// drops entries for processes that aren't in the snapshot anymore
+		auto prune( const process_snapshot& snapshot ) -> void {
+			std::lock_guard guard(lock);
+			if (pruned_generation == snapshot.generation)
+				return;
+
+			pruned_generation = snapshot.generation;
+			std::unordered_map<entry_key, entry_t, key_hash> kept;
+			for (auto& process : snapshot.processes) {
+				auto it = entries.find({ process->pid, process->creation_time });
+				if (it != entries.end())
+					kept.insert(*it);
+			}
+			entries = std::move(kept);
+		}
+
+		// set whenever a fetch lands, so a UI waiting on input only still redraws the row. null for none
+		auto set_wake_event( HANDLE event ) -> void {
+			wake_event.store(event, std::memory_order_relaxed);
+		}
+
+	private:
+		struct entry_key {
+			DWORD pid;
+			std::uint64_t creation_time;
+			bool operator==( const entry_key& ) const = default;
+		};
+
+		struct key_hash {
+			auto operator()( const entry_key& key ) const -> std::size_t {
+				return std::hash<std::uint64_t>{}(key.creation_time ^ (static_cast<std::uint64_t>(key.pid) << 32));
+			}
+		};
+
+		struct entry_t {
+			process_details details{};
+			std::chrono::steady_clock::time_point fetched{};
+			DWORD parent_pid = 0;
+			bool valid = false;
+			bool queued = false;
+		};
+
+		auto start( void ) -> void {
+			if (!worker.joinable())
+				worker = std::jthread([this](std::stop_token stop) { run(stop); });
+		}
+
+		auto run( std::stop_token stop ) -> void {
+			std::unique_lock guard(lock);
+			while (!stop.stop_requested()) {
+				wake.wait(guard, stop, [&] { return !queue.empty(); });
+				if (stop.stop_requested())
+					break;
+
+				// newest request first, that's the row the user just scrolled to
+				entry_key key = queue.back();
+				queue.pop_back();
+
+				auto pending = entries.find(key);
+				if (pending == entries.end())
+					continue;
+
+				process_info process{};
+				process.pid = key.pid;
+				process.creation_time = key.creation_time;
+				process.parent_pid = pending->second.parent_pid;
+				pending->second.queued = false;
+				fetching = key;
+
+				guard.unlock();
+				process_details details = query_process_details(process);
+				guard.lock();
+				fetching.reset();
+
+				auto it = entries.find(key);
+				if (it == entries.end())
+					continue;
+
+				it->second.details = details;
+				it->second.fetched = std::chrono::steady_clock::now();
+				it->second.valid = true;
+
+				if (HANDLE event = wake_event.load(std::memory_order_relaxed))
+					SetEvent(event);
+			}
+		}
+
+		std::mutex lock;
+		std::condition_variable_any wake;
+		std::vector<entry_key> queue;
+		std::unordered_map<entry_key, entry_t, key_hash> entries;
+		std::optional<entry_key> fetching; // the worker's request in flight, begin_frame doesn't touch it
+		std::uint64_t pruned_generation = ~0ull;
+		std::atomic<HANDLE> wake_event{ nullptr };
+		std::jthread worker; // last, so it stops before the rest goes away
+	};
+
+	inline process_details_cache details_cache;
+}
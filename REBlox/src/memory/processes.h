@@ -0,0 +1,114 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <cctype>
+#include "memory.h"
+
+namespace reblox::memory {
+	struct process_info {
+		DWORD pid;
+		DWORD parent_pid;
+		std::uint64_t creation_time; // FILETIME, 0 if we can't open the process. pid + this identifies a process
+		std::wstring exe;
+		std::string name; // utf-8
+		std::string lower_name;
+		std::string label; // "name (PID: 1234)", what the picker shows
+	};
+
+	struct process_snapshot {
+		std::vector<std::shared_ptr<const process_info>> processes;
+		std::uint64_t generation;
+	};
+
+	inline auto get_creation_time( DWORD pid ) -> std::uint64_t {
+		HANDLE proc = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+		if (!proc)
+			return 0;
+
+		FILETIME creation{}, exit{}, kernel{}, user{};
+		std::uint64_t ret = 0;
+		if (GetProcessTimes(proc, &creation, &exit, &kernel, &user))
+			ret = (static_cast<std::uint64_t>(creation.dwHighDateTime) << 32) | creation.dwLowDateTime;
+
+		CloseHandle(proc);
+		return ret;
+	}
+
+	// the process list the UI reads while a background thread refreshes it. readers grab the published
+	// snapshot and keep it alive for as long as they need it; refresh builds a new one and swaps it in.
+	// processes that are still around are carried over as-is, so their strings are only built once
+	class process_list {
+	public:
+		process_list( void ) {
+			published.store(std::make_shared<const process_snapshot>(process_snapshot{ {}, 0 }));
+		}
+
+		auto current( void ) const -> std::shared_ptr<const process_snapshot> {
+			return published.load(std::memory_order_acquire);
+		}
+
+		auto get_generation( void ) const -> std::uint64_t {
+			return current()->generation;
+		}
+
+		// returns true if a new snapshot was published
+		auto refresh( void ) -> bool {
+			std::lock_guard guard(refresh_lock);
+			auto previous = current();
+
+			std::unordered_map<DWORD, const std::shared_ptr<const process_info>*> known;
+			known.reserve(previous->processes.size());
+			for (auto& info : previous->processes)
+				known.emplace(info->pid, &info);
+
+			auto entries = get_processes();
+			std::vector<std::shared_ptr<const process_info>> next;
+			next.reserve(entries.size());
+
+			bool changed = entries.size() != previous->processes.size();
+			for (auto& entry : entries) {
+				std::uint64_t creation_time = get_creation_time(entry.th32ProcessID);
+
+				auto it = known.find(entry.th32ProcessID);
+				if (it != known.end() && (*it->second)->creation_time == creation_time && (*it->second)->exe == entry.szExeFile) {
+					next.push_back(*it->second);
+					continue;
+				}
+
+				next.push_back(make_info(entry, creation_time));
+				changed = true;
+			}
+
+			if (!changed)
+				return false;
+
+			published.store(std::make_shared<const process_snapshot>(process_snapshot{ std::move(next), previous->generation + 1 }), std::memory_order_release);
+			return true;
+		}
+
+	private:
+		static auto make_info( const PE32& entry, std::uint64_t creation_time ) -> std::shared_ptr<const process_info> {
+			auto info = std::make_shared<process_info>();
+			info->pid = entry.th32ProcessID;
+			info->parent_pid = entry.th32ParentProcessID;
+			info->creation_time = creation_time;
+			info->exe = entry.szExeFile;
+			info->name = WStringToString(info->exe);
+			info->lower_name = info->name;
+			std::transform(info->lower_name.begin(), info->lower_name.end(), info->lower_name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+			info->label = info->name + " (PID: " + std::to_string(info->pid) + ")";
+			return info;
+		}
+
+		std::atomic<std::shared_ptr<const process_snapshot>> published;
+		std::mutex refresh_lock;
+	};
+
+	inline process_list processes;
+}
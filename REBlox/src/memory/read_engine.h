@@ -0,0 +1,239 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include "memory.h"
+
+namespace reblox::memory {
+	// bounded multi producer multi consumer queue, one sequence number per cell (Vyukov). push and pop are a
+	// CAS on their index plus a release store on the cell, no locks anywhere. capacity must be a power of two
+	template <typename t, std::size_t capacity>
+	class mpmc_queue {
+		static_assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+
+	public:
+		mpmc_queue( void ) {
+			for (std::size_t i = 0; i < capacity; i++)
+				cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
+		auto try_push( t value ) -> bool {
+			std::size_t position = tail.load(std::memory_order_relaxed);
+			for (;;) {
+				cell& slot = cells[position & (capacity - 1)];
+				std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+				std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+				if (diff == 0) {
+					if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						slot.value = std::move(value);
+						slot.sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (diff < 0) {
+					return false; // full
+				}
+				else {
+					position = tail.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		auto try_pop( t& out ) -> bool {
+			std::size_t position = head.load(std::memory_order_relaxed);
+			for (;;) {
+				cell& slot = cells[position & (capacity - 1)];
+				std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+				std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+				if (diff == 0) {
+					if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						out = std::move(slot.value);
+						slot.sequence.store(position + capacity, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (diff < 0) {
+					return false; // empty
+				}
+				else {
+					position = head.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+	private:
+		struct cell {
+			std::atomic<std::size_t> sequence;
+			t value;
+		};
+
+		// producers and consumers hammer different lines
+		alignas(64) std::atomic<std::size_t> tail{ 0 };
+		alignas(64) std::atomic<std::size_t> head{ 0 };
+		alignas(64) cell cells[capacity];
+	};
+
+	struct read_result {
+		std::uint64_t address;
+		std::vector<std::uint8_t> data; // always the requested size, zero where the read failed
+		bool ok;
+	};
+
+	// reads target memory on a small worker pool so the UI thread never waits on ReadProcessMemory.
+	// submit() hands the result to a callback that runs on the UI thread from drain(), once per frame.
+	// only the views' small reads come through here; scans and other long walks are tasks on the shared
+	// scheduler, whose lanes keep them behind what the user is waiting on
+	class read_engine {
+	public:
+		using callback = std::function<void( read_result& )>;
+
+		~read_engine( void ) {
+			stopping.store(true);
+			signal.fetch_add(1);
+			signal.notify_all();
+			workers.clear();
+
+			job* leftover = nullptr;
+			while (requests.try_pop(leftover))
+				delete leftover;
+			while (completed.try_pop(leftover))
+				delete leftover;
+			for (auto work : overflow)
+				delete work;
+		}
+
+		auto submit( std::uint64_t address, std::size_t size, callback done ) -> void {
+			auto work = new job{ { address, {}, false }, std::move(done) };
+			work->result.data.resize(size);
+			enqueue(work);
+		}
+
+		// runs the callbacks of finished submit()s. UI thread, once per frame
+		auto drain( std::size_t limit = SIZE_MAX ) -> std::size_t {
+			std::size_t ran = 0;
+			job* done = nullptr;
+			while (ran < limit && take_completed(done)) {
+				std::unique_ptr<job> owned(done);
+				outstanding.fetch_sub(1, std::memory_order_relaxed);
+				owned->done(owned->result);
+				ran++;
+			}
+			return ran;
+		}
+
+		// set whenever a submit() completes, so a sleeping UI thread wakes up to drain it. null for none
+		auto set_wake_event( HANDLE event ) -> void {
+			wake_event.store(event, std::memory_order_relaxed);
+		}
+
+		// submitted and not yet drained
+		auto pending( void ) const -> std::size_t {
+			return outstanding.load(std::memory_order_relaxed);
+		}
+
+	private:
+		struct job {
+			read_result result;
+			callback done;
+			std::chrono::steady_clock::time_point queued_at;
+		};
+
+		auto enqueue( job* work ) -> void {
+			std::call_once(started, [this] { start(); });
+			outstanding.fetch_add(1, std::memory_order_relaxed);
+			work->queued_at = std::chrono::steady_clock::now();
+
+			// the workers never block, so a full queue always has room again shortly
+			while (!requests.try_push(work))
+				std::this_thread::yield();
+
+			signal.fetch_add(1, std::memory_order_release);
+			signal.notify_one();
+		}
+
+		auto start( void ) -> void {
+			std::size_t count = std::clamp<std::size_t>(std::thread::hardware_concurrency() / 2, 2, 4);
+			for (std::size_t i = 0; i < count; i++)
+				workers.emplace_back([this] {
+					timeline::engine.name_thread("read engine");
+					run();
+				});
+		}
+
+		auto run( void ) -> void {
+			while (!stopping.load()) {
+				job* work = nullptr;
+				std::uint32_t seen = signal.load(std::memory_order_acquire);
+				if (!requests.try_pop(work)) {
+					signal.wait(seen, std::memory_order_acquire);
+					continue;
+				}
+
+				execute(work);
+			}
+		}
+
+		auto execute( job* work ) -> void {
+			stats::record(stats::timer::engine_wait, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - work->queued_at).count()));
+			stats::scoped_timer timing(stats::timer::engine_job);
+			timeline::scope traced("engine", "read", "bytes", work->result.data.size());
+			stats::add(stats::counter::engine_jobs);
+
+			read_result& result = work->result;
+			result.ok = read_bytes(result.address, result.data.data(), result.data.size());
+			if (!result.ok)
+				std::memset(result.data.data(), 0, result.data.size());
+
+			finish(work);
+		}
+
+		// only the UI thread drains completions, and it may be the one stuck in submit() on a full request
+		// queue. so a worker never waits for room here: what doesn't fit goes on the overflow list
+		auto finish( job* work ) -> void {
+			if (!completed.try_push(work)) {
+				std::lock_guard guard(overflow_lock);
+				overflow.push_back(work);
+				overflowed.store(true, std::memory_order_release);
+			}
+
+			if (HANDLE event = wake_event.load(std::memory_order_relaxed))
+				SetEvent(event);
+		}
+
+		auto take_completed( job*& out ) -> bool {
+			if (completed.try_pop(out))
+				return true;
+			if (!overflowed.load(std::memory_order_acquire))
+				return false;
+
+			std::lock_guard guard(overflow_lock);
+			if (overflow.empty())
+				return false;
+			out = overflow.back();
+			overflow.pop_back();
+			overflowed.store(!overflow.empty(), std::memory_order_release);
+			return true;
+		}
+
+		mpmc_queue<job*, 4096> requests;
+		mpmc_queue<job*, 4096> completed;
+		std::mutex overflow_lock;
+		std::vector<job*> overflow; // completions that didn't fit in completed
+		std::atomic<bool> overflowed{ false };
+		std::atomic<std::uint32_t> signal{ 0 }; // bumped on every submit, workers wait on it when idle
+		std::atomic<std::size_t> outstanding{ 0 };
+		std::atomic<bool> stopping{ false };
+		std::atomic<HANDLE> wake_event{ nullptr };
+		std::once_flag started;
+		std::vector<std::jthread> workers; // last, so they're joined before the queues go away
+	};
+
+	inline read_engine reads;
+}
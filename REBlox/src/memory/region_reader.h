@@ -0,0 +1,289 @@
+#pragma once
+#include <cstdint>
+#include <new>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <utility>
+#include <algorithm>
+#include "memory.h"
+#include "scheduler.h"
+#include "stats.h"
+#include "timeline.h"
+
+// pipelined reads for the scanners: a worker compares one chunk while another worker reads the next into a
+// second buffer, so a walk runs at the speed of the slower of the two instead of their sum
+namespace reblox::memory {
+	// page aligned and only ever grows, so a recycled one is usually big enough already
+	class aligned_buffer {
+	public:
+		aligned_buffer( void ) = default;
+
+		aligned_buffer( aligned_buffer&& other ) noexcept
+			: bytes(std::exchange(other.bytes, nullptr)), capacity(std::exchange(other.capacity, 0)) {}
+
+		aligned_buffer& operator=( aligned_buffer&& other ) noexcept {
+			std::swap(bytes, other.bytes);
+			std::swap(capacity, other.capacity);
+			return *this;
+		}
+
+		~aligned_buffer( void ) {
+			free();
+		}
+
+		auto reserve( std::size_t size ) -> void {
+			if (size <= capacity)
+				return;
+
+			free();
+			capacity = (size + page_size - 1) & ~(page_size - 1);
+			bytes = static_cast<std::uint8_t*>(::operator new(capacity, std::align_val_t{ page_size }));
+		}
+
+		auto data( void ) const -> std::uint8_t* {
+			return bytes;
+		}
+
+		auto size( void ) const -> std::size_t {
+			return capacity;
+		}
+
+	private:
+		auto free( void ) -> void {
+			if (bytes)
+				::operator delete(bytes, std::align_val_t{ page_size });
+			bytes = nullptr;
+			capacity = 0;
+		}
+
+		std::uint8_t* bytes = nullptr;
+		std::size_t capacity = 0;
+	};
+
+	// a free list of buffers per thread, so a walk doesn't go back to the allocator for megabytes every time.
+	// a thread gives back what it took, no locking
+	class buffer_pool {
+	public:
+		static constexpr std::size_t kept = 2; // per thread, what one region_reader holds
+
+		auto acquire( std::size_t size ) -> aligned_buffer {
+			auto& mine = local();
+			aligned_buffer ret;
+			if (!mine.empty()) {
+				ret = std::move(mine.back());
+				mine.pop_back();
+			}
+			ret.reserve(size);
+			return ret;
+		}
+
+		auto release( aligned_buffer&& buffer ) -> void {
+			auto& mine = local();
+			if (mine.size() < kept && buffer.size())
+				mine.push_back(std::move(buffer));
+		}
+
+	private:
+		static auto local( void ) -> std::vector<aligned_buffer>& {
+			thread_local std::vector<aligned_buffer> free;
+			return free;
+		}
+	};
+
+	inline buffer_pool buffers;
+
+	// sizes a walk's chunks from how long their reads take. a read well under target means its fixed cost (the
+	// call, the hand off) is a big share and the chunks double; well over it and they halve, so cancelling,
+	// progress and the split between workers stay responsive on a slow target. shared by a walk's threads
+	class chunk_sizer {
+	public:
+		static constexpr std::size_t min_size = 0x10000;
+		static constexpr std::size_t max_size = 0x200000;
+		static constexpr std::uint64_t target_ns = 1000000;
+
+		explicit chunk_sizer( std::size_t initial ) : size(std::clamp(initial, min_size, max_size)) {}
+
+		auto get( void ) const -> std::size_t {
+			return size.load(std::memory_order_relaxed);
+		}
+
+		// bytes took ns to read. scaled to the current size first, the short chunk at a region's end says as
+		// much about the rate as a full one
+		auto record( std::size_t bytes, std::uint64_t ns ) -> void {
+			std::size_t current = get();
+			if (!bytes)
+				return;
+
+			std::uint64_t projected = ns * current / bytes;
+			if (projected < target_ns / 2 && current < max_size)
+				size.compare_exchange_strong(current, current * 2, std::memory_order_relaxed);
+			else if (projected > target_ns * 2 && current > min_size)
+				size.compare_exchange_strong(current, current / 2, std::memory_order_relaxed);
+		}
+
+	private:
+		std::atomic<std::size_t> size;
+	};
+
+	// a read into a buffer the caller owns. whoever claims it first does it: the pool worker that gets to its
+	// task, or the walk itself once it needs the bytes and nobody has started on them, so a walk never sits
+	// behind a read that's still queued while every worker is busy comparing
+	struct read_request {
+		std::uint64_t address = 0;
+		std::uint8_t* buffer = nullptr;
+		std::size_t size = 0;
+		bool ok = false;
+		std::uint64_t ns = 0; // the read itself, without the time it queued
+		std::atomic<bool> claimed{ false };
+		std::atomic<bool> done{ false };
+	};
+
+	// the scanners' reads as tasks on the shared pool, in the io lane so a free worker takes them before any
+	// more compare work. a walk has at most one read out at a time
+	class prefetcher {
+	public:
+		// the task keeps its own reference, a request the walk took back can still be sitting in a queue
+		auto submit( const std::shared_ptr<read_request>& request ) -> void {
+			pool.submit(reading, [request] {
+				if (!request->claimed.exchange(true, std::memory_order_acq_rel))
+					execute(*request);
+			});
+		}
+
+		// the bytes are in once this returns. a read no worker has started is done right here
+		auto wait( read_request& request ) -> void {
+			if (!request.claimed.exchange(true, std::memory_order_acq_rel)) {
+				stats::add(stats::counter::scan_inline_reads);
+				execute(request);
+				return;
+			}
+			request.done.wait(false, std::memory_order_acquire);
+		}
+
+		// a read whose bytes nobody wants anymore: taken back if it hasn't started, waited out if it has
+		auto abandon( read_request& request ) -> void {
+			if (request.claimed.exchange(true, std::memory_order_acq_rel))
+				request.done.wait(false, std::memory_order_acquire);
+		}
+
+	private:
+		static auto execute( read_request& request ) -> void {
+			timeline::scope traced("scan", "read chunk", "bytes", request.size);
+			auto begin = std::chrono::steady_clock::now();
+			request.ok = read_bytes(request.address, request.buffer, request.size);
+			request.ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+			request.done.store(true, std::memory_order_release);
+			request.done.notify_all();
+		}
+
+		job reading = make_job(lane::io); // never cancelled, a walk takes back its own reads
+	};
+
+	inline prefetcher prefetch;
+
+	// walks ranges a chunk at a time, always one read ahead of the caller: two pooled buffers, one being read
+	// into while the other is looked at. a chunk reads overlap bytes past its own, up to its range's limit, so
+	// a match across the seam is still whole
+	class region_reader {
+	public:
+		struct chunk {
+			std::uint64_t address;
+			std::size_t starts; // bytes of its own, the rest is overlap
+			std::size_t size;
+			std::uint8_t* data; // the caller's until the next call to next(), it may read into it again
+			bool ok; // false if any of it couldn't be read
+		};
+
+		region_reader( std::size_t overlap, chunk_sizer& sizer ) : overlap(overlap), sizer(sizer) {
+			for (auto& entry : slots)
+				entry.buffer = buffers.acquire(chunk_sizer::max_size + overlap);
+		}
+
+		~region_reader( void ) {
+			for (auto& entry : slots) {
+				if (entry.request)
+					prefetch.abandon(*entry.request);
+				buffers.release(std::move(entry.buffer));
+			}
+		}
+
+		region_reader( const region_reader& ) = delete;
+		region_reader& operator=( const region_reader& ) = delete;
+
+		// [begin, end) with reads allowed up to limit, walked in the order they were added
+		auto add( std::uint64_t begin, std::uint64_t end, std::uint64_t limit ) -> void {
+			if (ranges.empty())
+				cursor = begin;
+			ranges.push_back({ begin, end, limit });
+		}
+
+		// the next chunk, once it's read. false at the end
+		auto next( chunk& out ) -> bool {
+			if (in_flight < 0 && !issue(0))
+				return false;
+
+			slot& ready = slots[in_flight];
+			read_request& request = *ready.request;
+			{
+				stats::scoped_timer timing(stats::timer::scan_wait);
+				if (!request.done.load(std::memory_order_acquire)) {
+					timeline::scope traced("scan", "wait chunk");
+					prefetch.wait(request);
+				}
+			}
+			sizer.record(request.size, request.ns);
+
+			// the other buffer was the last chunk handed out, done with now
+			int other = in_flight ^ 1;
+			out = { request.address, ready.starts, request.size, ready.buffer.data(), request.ok };
+			in_flight = -1;
+			issue(other);
+			return true;
+		}
+
+	private:
+		struct range {
+			std::uint64_t begin;
+			std::uint64_t end;
+			std::uint64_t limit;
+		};
+
+		struct slot {
+			aligned_buffer buffer;
+			std::shared_ptr<read_request> request; // a fresh one per read, the last may still be queued
+			std::size_t starts = 0;
+		};
+
+		auto issue( int index ) -> bool {
+			while (current < ranges.size() && cursor >= ranges[current].end) {
+				if (++current < ranges.size())
+					cursor = ranges[current].begin;
+			}
+			if (current == ranges.size())
+				return false;
+
+			const range& walking = ranges[current];
+			slot& into = slots[index];
+			into.starts = static_cast<std::size_t>((std::min)(static_cast<std::uint64_t>(sizer.get()), walking.end - cursor));
+			into.request = std::make_shared<read_request>();
+			into.request->address = cursor;
+			into.request->buffer = into.buffer.data();
+			into.request->size = static_cast<std::size_t>((std::min)(static_cast<std::uint64_t>(into.starts + overlap), walking.limit - cursor));
+			cursor += into.starts;
+
+			prefetch.submit(into.request);
+			in_flight = index;
+			return true;
+		}
+
+		std::size_t overlap;
+		chunk_sizer& sizer;
+		std::vector<range> ranges;
+		std::size_t current = 0; // range being walked
+		std::uint64_t cursor = 0; // where its next chunk starts
+		slot slots[2];
+		int in_flight = -1; // slot with a read out, -1 for none
+	};
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include "memory.h"
+
+namespace reblox::memory {
+	struct memory_region {
+		std::uint64_t base;
+		std::uint64_t size;
+		DWORD protect;
+		DWORD type; // MEM_IMAGE, MEM_MAPPED or MEM_PRIVATE
+
+		auto readable( void ) const -> bool {
+			constexpr DWORD mask = PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+			return (protect & mask) && !(protect & PAGE_GUARD);
+		}
+
+		auto writable( void ) const -> bool {
+			return (protect & (PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)) && !(protect & PAGE_GUARD);
+		}
+
+		auto executable( void ) const -> bool {
+			return protect & (PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY);
+		}
+
+		auto end( void ) const -> std::uint64_t {
+			return base + size;
+		}
+	};
+
+	// committed regions of the attached process, sorted by base
+	class region_map {
+	public:
+		auto build( void ) -> void {
+			std::vector<memory_region> next;
+			MEMORY_BASIC_INFORMATION mbi{};
+			std::uint64_t address = 0;
+
+			while (query_memory(address, mbi)) {
+				std::uint64_t base = reinterpret_cast<std::uint64_t>(mbi.BaseAddress);
+				if (mbi.State == MEM_COMMIT)
+					next.push_back({ base, mbi.RegionSize, mbi.Protect, mbi.Type });
+
+				if (base + mbi.RegionSize <= address)
+					break;
+				address = base + mbi.RegionSize;
+			}
+
+			committed = std::move(next);
+			bases.resize(committed.size());
+			for (std::size_t i = 0; i < committed.size(); i++)
+				bases[i] = committed[i].base;
+			generation++;
+		}
+
+		auto clear( void ) -> void {
+			committed.clear();
+			bases.clear();
+			generation++;
+		}
+
+		auto find( std::uint64_t address ) const -> const memory_region* {
+			auto it = std::upper_bound(bases.begin(), bases.end(), address);
+			if (it == bases.begin())
+				return nullptr;
+
+			const memory_region& region = committed[it - bases.begin() - 1];
+			return address < region.end() ? &region : nullptr;
+		}
+
+		auto all( void ) const -> const std::vector<memory_region>& {
+			return committed;
+		}
+
+		auto get_generation( void ) const -> std::uint64_t {
+			return generation;
+		}
+
+	private:
+		std::vector<memory_region> committed;
+		std::vector<std::uint64_t> bases;
+		std::uint64_t generation = 0;
+	};
+
+	inline region_map regions;
+}
@@ -0,0 +1,425 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <optional>
+#include <algorithm>
+#include <type_traits>
+#include <unordered_map>
+#include "memory.h"
+#include "modules.h"
+#include "regions.h"
+#include "symbols.h"
+#include "batch.h"
+#include "scheduler.h"
+#include "region_reader.h"
+
+namespace reblox::memory {
+	struct scan_options {
+		std::uint64_t begin = 0;
+		std::uint64_t end = ~0ull;
+		std::size_t alignment = 1; // hits must start on a multiple of this
+		bool writable_only = false; // skip code and read only data, what you want for values
+		bool executable_only = false; // only code, what you want for signatures
+	};
+
+	struct scan_chunk {
+		std::uint64_t address;
+		std::span<const std::uint8_t> bytes;
+		std::size_t starts; // hits starting at or past this offset belong to the next chunk, which overlaps this one
+	};
+
+	inline constexpr std::size_t scan_chunk_size = 0x100000; // for_each_chunk's, and where a parallel walk's sizing starts
+	inline constexpr std::size_t scan_partition_size = 0x800000; // what the pool splits a parallel walk into, a few chunks each
+
+	struct scan_span {
+		std::uint64_t begin;
+		std::uint64_t end;
+	};
+
+	// what a scan with these options walks: the readable regions, clipped to [options.begin, options.end)
+	inline auto scan_spans( const scan_options& options ) -> std::vector<scan_span> {
+		std::vector<scan_span> ret;
+		for (auto& region : regions.all()) {
+			if (!region.readable() || (options.writable_only && !region.writable()) || (options.executable_only && !region.executable()))
+				continue;
+
+			std::uint64_t begin = (std::max)(region.base, options.begin);
+			std::uint64_t end = (std::min)(region.end(), options.end);
+			if (begin < end)
+				ret.push_back({ begin, end });
+		}
+		return ret;
+	}
+
+	template <typename fn_t>
+	inline auto process_chunk( const scan_chunk& chunk, fn_t& fn ) -> void {
+		stats::scoped_timer timing(stats::timer::scan_chunk);
+		timeline::scope traced("scan", "chunk", "address", chunk.address);
+		stats::add(stats::counter::scan_chunks);
+		fn(chunk);
+	}
+
+	// for a chunk that didn't read as a whole: retried a page at a time into buffer, the readable pages go out
+	// on their own. each carries up to overlap bytes of the pages after it, as far as those read, so a hit
+	// across the seam between two readable pages isn't lost. returns the bytes scanned
+	template <typename fn_t>
+	inline auto scan_pages( std::uint64_t address, std::size_t starts, std::size_t size, std::size_t overlap, std::uint8_t* buffer, fn_t& fn ) -> std::uint64_t {
+		std::uint64_t scanned = 0;
+		for (std::size_t page = 0; page < starts; page += page_size) {
+			std::size_t length = (std::min)(page_size, size - page);
+			if (!read_bytes(address + page, buffer, length))
+				continue;
+
+			std::size_t wanted = (std::min)(page + page_size + overlap, size) - page;
+			while (length < wanted) {
+				std::size_t more = (std::min)(page_size, wanted - length);
+				if (!read_bytes(address + page + length, buffer + length, more))
+					break;
+				length += more;
+			}
+
+			std::size_t page_starts = (std::min)(page_size, starts - page);
+			process_chunk(scan_chunk{ address + page, { buffer, length }, page_starts }, fn);
+			scanned += page_starts;
+		}
+		return scanned;
+	}
+
+	// reads the chunk at address (starts bytes of its own, up to size with the overlap) into buffer and hands it
+	// to fn, page by page if it doesn't read whole. returns the bytes scanned
+	template <typename fn_t>
+	inline auto scan_one_chunk( std::uint64_t address, std::size_t starts, std::size_t size, std::size_t overlap, std::uint8_t* buffer, fn_t& fn ) -> std::uint64_t {
+		bool read = false;
+		{
+			timeline::scope traced("scan", "read chunk", "bytes", size);
+			read = read_bytes(address, buffer, size);
+		}
+		if (!read)
+			return scan_pages(address, starts, size, overlap, buffer, fn);
+
+		process_chunk(scan_chunk{ address, { buffer, size }, starts }, fn);
+		return starts;
+	}
+
+	// hands fn every readable region in [options.begin, options.end) a chunk at a time, in address order on the
+	// calling thread. a chunk carries overlap extra bytes from the next one so hits across the seam aren't
+	// lost. returns the number of bytes scanned
+	template <typename fn_t>
+	inline auto for_each_chunk( const scan_options& options, std::size_t overlap, fn_t&& fn ) -> std::uint64_t {
+		std::vector<std::uint8_t> buffer(scan_chunk_size + overlap);
+		std::uint64_t scanned = 0;
+		for (auto& span : scan_spans(options)) {
+			timeline::scope partition("scan", "region", "bytes", span.end - span.begin);
+			for (std::uint64_t address = span.begin; address < span.end; address += scan_chunk_size) {
+				std::size_t starts = static_cast<std::size_t>((std::min)(static_cast<std::uint64_t>(scan_chunk_size), span.end - address));
+				std::size_t size = static_cast<std::size_t>((std::min)(static_cast<std::uint64_t>(starts + overlap), span.end - address));
+				scanned += scan_one_chunk(address, starts, size, overlap, buffer.data(), fn);
+			}
+		}
+		return scanned;
+	}
+
+	// queues a walk over the chunks on the shared pool and returns right away. fn runs on several threads at
+	// once and sees the chunks in no particular order, so it keeps what it finds per call and merges under a
+	// lock. the partitions of every span are numbered as one range for the pool to split, so a big region
+	// spreads over the workers and small ones group up. a task reads its partitions through a region_reader,
+	// the next chunk already on its way while fn looks at this one, in chunks sized from how the walk's reads
+	// have been going. the job's total grows by the bytes to walk before this returns and advances as chunks
+	// finish, cancelling it stops handing out chunks. fn and the walk's state are owned by the queued tasks,
+	// scanned has to outlive the job
+	template <typename fn_t>
+	inline auto schedule_chunks( const scan_options& options, std::size_t overlap, fn_t fn, const job& work, std::atomic<std::uint64_t>* scanned ) -> void {
+		std::vector<scan_span> spans = scan_spans(options);
+		std::vector<std::uint64_t> first_partition; // of each span
+		std::uint64_t partitions = 0;
+		for (auto& span : spans) {
+			first_partition.push_back(partitions);
+			partitions += (span.end - span.begin + scan_partition_size - 1) / scan_partition_size;
+			work->add_total(span.end - span.begin);
+		}
+
+		auto sizer = std::make_shared<chunk_sizer>(scan_chunk_size);
+		pool.parallel_for(work, 0, partitions, 1, [spans = std::move(spans), first_partition = std::move(first_partition), overlap, fn = std::move(fn), work, scanned, sizer](std::uint64_t first, std::uint64_t last) {
+			region_reader reader(overlap, *sizer);
+			for (std::uint64_t index = first; index < last; index++) {
+				std::size_t span = static_cast<std::size_t>(std::upper_bound(first_partition.begin(), first_partition.end(), index) - first_partition.begin()) - 1;
+				std::uint64_t begin = spans[span].begin + (index - first_partition[span]) * scan_partition_size;
+				reader.add(begin, (std::min)(begin + scan_partition_size, spans[span].end), spans[span].end);
+			}
+
+			region_reader::chunk chunk;
+			while (!work->cancelled() && reader.next(chunk)) {
+				if (chunk.ok) {
+					process_chunk(scan_chunk{ chunk.address, { chunk.data, chunk.size }, chunk.starts }, fn);
+					scanned->fetch_add(chunk.starts, std::memory_order_relaxed);
+				}
+				else {
+					scanned->fetch_add(scan_pages(chunk.address, chunk.starts, chunk.size, overlap, chunk.data, fn), std::memory_order_relaxed);
+				}
+				work->advance(chunk.starts);
+			}
+		});
+	}
+
+	// schedule_chunks, returning once the walk is done with the bytes scanned
+	template <typename fn_t>
+	inline auto for_each_chunk_parallel( const scan_options& options, std::size_t overlap, fn_t&& fn, const job& work ) -> std::uint64_t {
+		std::atomic<std::uint64_t> scanned{ 0 };
+		schedule_chunks(options, overlap, [&fn](const scan_chunk& chunk) { fn(chunk); }, work, &scanned);
+		work->wait();
+		return scanned.load(std::memory_order_relaxed);
+	}
+
+	// the occurrences of needle that start in chunk, appended to found in address order. memchr on the first
+	// byte does the heavy lifting, the CRT's is vectorized
+	inline auto find_bytes( const scan_chunk& chunk, std::span<const std::uint8_t> needle, std::size_t alignment, std::vector<std::uint64_t>& found ) -> void {
+		const std::uint8_t* data = chunk.bytes.data();
+		const std::uint8_t* end = data + chunk.starts;
+		for (const std::uint8_t* p = data; p < end; p++) {
+			p = static_cast<const std::uint8_t*>(std::memchr(p, needle[0], end - p));
+			if (!p)
+				break;
+
+			std::size_t offset = static_cast<std::size_t>(p - data);
+			if ((chunk.address + offset) % alignment == 0 && offset + needle.size() <= chunk.bytes.size() && std::memcmp(p, needle.data(), needle.size()) == 0)
+				found.push_back(chunk.address + offset);
+		}
+	}
+
+	// every occurrence of needle, in address order
+	inline auto scan_bytes( std::span<const std::uint8_t> needle, const scan_options& options, std::uint64_t* scanned = nullptr, const job& work = make_job() ) -> std::vector<std::uint64_t> {
+		std::vector<std::uint64_t> hits;
+		if (needle.empty())
+			return hits;
+
+		const std::size_t alignment = (std::max)(options.alignment, std::size_t(1));
+		std::mutex lock;
+		std::uint64_t bytes = for_each_chunk_parallel(options, needle.size() - 1, [&](const scan_chunk& chunk) {
+			std::vector<std::uint64_t> found;
+			find_bytes(chunk, needle, alignment, found);
+
+			std::lock_guard guard(lock);
+			hits.insert(hits.end(), found.begin(), found.end());
+		}, work);
+
+		std::sort(hits.begin(), hits.end());
+		if (scanned)
+			*scanned = bytes;
+		return hits;
+	}
+
+	// exact value, naturally aligned unless the options say otherwise
+	template <typename t>
+	inline auto scan_value( t value, scan_options options, std::uint64_t* scanned = nullptr, const job& work = make_job() ) -> std::vector<std::uint64_t> {
+		static_assert(std::is_trivially_copyable_v<t>);
+		if (options.alignment == 1)
+			options.alignment = alignof(t);
+
+		std::uint8_t bytes[sizeof(t)];
+		std::memcpy(bytes, &value, sizeof(t));
+		return scan_bytes(bytes, options, scanned, work);
+	}
+
+	// text as a t: decimal or 0x hex for integers, anything strtod takes for floats. nothing if it isn't all
+	// one number
+	template <typename t>
+	inline auto parse_value( const std::string& text ) -> std::optional<t> {
+		char* end = nullptr;
+		t value;
+		if constexpr (std::is_floating_point_v<t>)
+			value = static_cast<t>(std::strtod(text.c_str(), &end));
+		else if constexpr (std::is_signed_v<t>)
+			value = static_cast<t>(std::strtoll(text.c_str(), &end, 0));
+		else
+			value = static_cast<t>(std::strtoull(text.c_str(), &end, 0));
+
+		if (end == text.c_str() || *end)
+			return std::nullopt;
+		return value;
+	}
+
+	// IDA style byte pattern, "48 8B 05 ?? ?? ?? ?? 48 85 C0". a single ? works as a wildcard too
+	struct signature {
+		std::vector<std::uint8_t> bytes;
+		std::vector<std::uint8_t> mask; // 0xFF for bytes that have to match, 0 for wildcards
+		std::size_t anchor; // first byte that isn't a wildcard, what memchr looks for
+	};
+
+	inline auto parse_signature( std::string_view pattern ) -> std::optional<signature> {
+		signature ret{};
+		std::size_t i = 0;
+		while (i < pattern.size()) {
+			if (pattern[i] == ' ') {
+				i++;
+				continue;
+			}
+
+			if (pattern[i] == '?') {
+				ret.bytes.push_back(0);
+				ret.mask.push_back(0);
+				i += i + 1 < pattern.size() && pattern[i + 1] == '?' ? 2 : 1;
+				continue;
+			}
+
+			auto nibble = [](char c) -> int {
+				if (c >= '0' && c <= '9') return c - '0';
+				if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+				if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+				return -1;
+			};
+
+			int high = nibble(pattern[i]);
+			int low = i + 1 < pattern.size() ? nibble(pattern[i + 1]) : -1;
+			if (high < 0 || low < 0)
+				return std::nullopt;
+
+			ret.bytes.push_back(static_cast<std::uint8_t>(high << 4 | low));
+			ret.mask.push_back(0xFF);
+			i += 2;
+		}
+
+		auto fixed = std::find(ret.mask.begin(), ret.mask.end(), 0xFF);
+		if (fixed == ret.mask.end())
+			return std::nullopt;
+
+		ret.anchor = static_cast<std::size_t>(fixed - ret.mask.begin());
+		return ret;
+	}
+
+	// the matches of sig that start in chunk, appended to found in address order
+	inline auto find_signature( const scan_chunk& chunk, const signature& sig, std::vector<std::uint64_t>& found ) -> void {
+		const std::size_t length = sig.bytes.size();
+		const std::uint8_t* data = chunk.bytes.data();
+		if (chunk.bytes.size() < length)
+			return;
+
+		// the anchor can sit anywhere in [anchor, starts + anchor), everything before it is wildcards
+		const std::uint8_t* p = data + sig.anchor;
+		const std::uint8_t* end = data + (std::min)(chunk.starts, chunk.bytes.size() - length + 1) + sig.anchor;
+		for (; p < end; p++) {
+			p = static_cast<const std::uint8_t*>(std::memchr(p, sig.bytes[sig.anchor], end - p));
+			if (!p)
+				break;
+
+			const std::uint8_t* start = p - sig.anchor;
+			std::size_t i = sig.anchor + 1;
+			while (i < length && (start[i] & sig.mask[i]) == sig.bytes[i])
+				i++;
+
+			if (i == length)
+				found.push_back(chunk.address + static_cast<std::uint64_t>(start - data));
+		}
+	}
+
+	inline auto scan_signature( const signature& sig, const scan_options& options, std::uint64_t* scanned = nullptr, const job& work = make_job() ) -> std::vector<std::uint64_t> {
+		std::vector<std::uint64_t> hits;
+
+		std::mutex lock;
+		std::uint64_t bytes = for_each_chunk_parallel(options, sig.bytes.size() - 1, [&](const scan_chunk& chunk) {
+			std::vector<std::uint64_t> found;
+			find_signature(chunk, sig, found);
+
+			std::lock_guard guard(lock);
+			hits.insert(hits.end(), found.begin(), found.end());
+		}, work);
+
+		std::sort(hits.begin(), hits.end());
+		if (scanned)
+			*scanned = bytes;
+		return hits;
+	}
+
+	struct census_entry {
+		std::uint64_t vfptr;
+		std::string mangled;
+		std::string type; // demangled
+		std::uint64_t count; // qwords in writable memory that hold this vfptr
+	};
+
+	// counts live objects per RTTI type. every aligned qword in writable memory that points into a module's
+	// non-executable sections is a vfptr candidate; the distinct candidates are then walked as coroutines in one
+	// read_batch, and whatever doesn't lead to a Complete Object Locator drops out
+	inline auto rtti_census( std::uint64_t min_count = 1, std::uint64_t* scanned = nullptr, const job& work = make_job() ) -> std::vector<census_entry> {
+		std::vector<std::uint64_t> starts;
+		std::vector<std::uint64_t> ends;
+		for (auto& module : modules.current()->modules) {
+			for (auto& section : module->sections) {
+				if (!(section.characteristics & IMAGE_SCN_MEM_EXECUTE) && (section.characteristics & IMAGE_SCN_MEM_READ)) {
+					starts.push_back(module->base + section.rva);
+					ends.push_back(module->base + section.rva + section.size);
+				}
+			}
+		}
+
+		std::unordered_map<std::uint64_t, std::uint64_t> counts;
+		scan_options options;
+		options.writable_only = true;
+
+		timeline::scope census("rtti", "census");
+		std::uint64_t bytes = 0;
+		{
+			timeline::scope pass("rtti", "candidates");
+			std::mutex lock;
+			bytes = for_each_chunk_parallel(options, 0, [&](const scan_chunk& chunk) {
+				std::vector<std::uint64_t> found;
+				std::size_t count = chunk.starts / sizeof(std::uint64_t);
+				for (std::size_t i = 0; i < count; i++) {
+					std::uint64_t value;
+					std::memcpy(&value, chunk.bytes.data() + i * sizeof(value), sizeof(value));
+					if (value & 7)
+						continue;
+
+					std::size_t below = branchless_upper_bound(starts.data(), starts.size(), value);
+					if (below && value < ends[below - 1])
+						found.push_back(value);
+				}
+
+				std::lock_guard guard(lock);
+				for (auto value : found)
+					counts[value]++;
+			}, work);
+			pass.set_arg("candidates", counts.size());
+		}
+
+		std::vector<std::uint64_t> vfptrs;
+		for (auto& [vfptr, count] : counts) {
+			if (count >= min_count)
+				vfptrs.push_back(vfptr);
+		}
+
+		read_batch batch;
+		std::vector<task<std::string>> tasks;
+		tasks.reserve(vfptrs.size());
+		{
+			timeline::scope pass("rtti", "resolve", "vfptrs", vfptrs.size());
+			for (auto vfptr : vfptrs)
+				tasks.push_back(rtti::mangled_vtable_name(batch, vfptr));
+			batch.run(std::span(tasks));
+		}
+
+		timeline::scope pass("rtti", "demangle");
+		std::vector<census_entry> ret;
+		for (std::size_t i = 0; i < vfptrs.size(); i++) {
+			std::string mangled = tasks[i].result();
+			if (mangled.empty())
+				continue;
+
+			std::string type = rtti::demangle_msvc_rtti(mangled);
+			ret.push_back({ vfptrs[i], std::move(mangled), std::move(type), counts[vfptrs[i]] });
+		}
+
+		std::sort(ret.begin(), ret.end(), [](const census_entry& a, const census_entry& b) { return a.count != b.count ? a.count > b.count : a.vfptr < b.vfptr; });
+		pass.set_arg("types", ret.size());
+
+		if (scanned)
+			*scanned = bytes;
+		return ret;
+	}
+}
@@ -0,0 +1,210 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <vector>
+#include <chrono>
+#include <type_traits>
+#include "scan.h"
+#include "scheduler.h"
+
+namespace reblox::memory {
+	// a scan that runs in the background and can be looked at while it does. every chunk's hits are merged into
+	// the result store as soon as that chunk is compared, kept by chunk address so the partial set is always in
+	// address order. cancelling stops handing out chunks, what was found so far stays and is as good as a
+	// finished scan's over the chunks that were done. starting again drops the last scan; its tasks own the
+	// state they write to, so one still winding down can't touch the new results
+	class scan_session {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		struct progress {
+			std::uint64_t walked; // bytes of the walk the scan is through, readable or not
+			std::uint64_t total; // bytes it walks in all
+			std::uint64_t scanned; // of walked, the bytes that could be read and compared
+			std::uint64_t hits;
+			double seconds; // since the start, up to the last chunk if it's over
+			bool running;
+			bool cancelled;
+
+			auto fraction( void ) const -> float {
+				return total ? static_cast<float>(static_cast<double>(walked) / total) : (running ? 0.0f : 1.0f);
+			}
+
+			auto bytes_per_second( void ) const -> double {
+				return seconds > 0 ? scanned / seconds : 0;
+			}
+		};
+
+		~scan_session( void ) {
+			cancel();
+		}
+
+		template <typename t>
+		auto start_value( t value, scan_options options, lane priority = lane::interactive ) -> void {
+			static_assert(std::is_trivially_copyable_v<t>);
+			if (options.alignment == 1)
+				options.alignment = alignof(t);
+
+			std::uint8_t bytes[sizeof(t)];
+			std::memcpy(bytes, &value, sizeof(t));
+			start_bytes(bytes, options, priority);
+		}
+
+		auto start_bytes( std::span<const std::uint8_t> needle, const scan_options& options, lane priority = lane::interactive ) -> void {
+			auto next = restart(priority);
+			if (needle.empty())
+				return;
+
+			const std::size_t alignment = (std::max)(options.alignment, std::size_t(1));
+			schedule_chunks(options, needle.size() - 1, [next, needle = std::vector<std::uint8_t>(needle.begin(), needle.end()), alignment](const scan_chunk& chunk) {
+				std::vector<std::uint64_t> found;
+				find_bytes(chunk, needle, alignment, found);
+				next->merge(chunk.address, std::move(found));
+			}, next->work, &next->scanned);
+		}
+
+		auto start_signature( const signature& sig, const scan_options& options, lane priority = lane::interactive ) -> void {
+			auto next = restart(priority);
+			schedule_chunks(options, sig.bytes.size() - 1, [next, sig](const scan_chunk& chunk) {
+				std::vector<std::uint64_t> found;
+				find_signature(chunk, sig, found);
+				next->merge(chunk.address, std::move(found));
+			}, next->work, &next->scanned);
+		}
+
+		// returns right away, chunks already being compared finish and still land in the results
+		auto cancel( void ) -> void {
+			if (current)
+				current->work->cancel();
+		}
+
+		// cancel() and wait for the chunks in flight, after this nothing reads memory on the scan's behalf
+		auto stop( void ) -> void {
+			if (!current)
+				return;
+			current->work->cancel();
+			current->work->wait();
+		}
+
+		auto clear( void ) -> void {
+			stop();
+			current.reset();
+		}
+
+		auto get_progress( void ) const -> progress {
+			if (!current)
+				return {};
+
+			auto& work = current->work;
+			bool running = !work->done();
+			std::lock_guard guard(current->lock);
+			auto until = running ? clock::now() : current->last_merge;
+			return {
+				work->get_completed(),
+				work->get_total(),
+				current->scanned.load(std::memory_order_relaxed),
+				current->hits,
+				std::chrono::duration<double>(until - current->started).count(),
+				running,
+				work->cancelled(),
+			};
+		}
+
+		auto result_count( void ) const -> std::uint64_t {
+			if (!current)
+				return 0;
+			std::lock_guard guard(current->lock);
+			return current->hits;
+		}
+
+		// up to count results from the first-th on, in address order. what's at an index moves while the scan
+		// runs, as chunks below it finish
+		auto results( std::uint64_t first, std::size_t count, std::vector<std::uint64_t>& out ) const -> void {
+			out.clear();
+			if (!current)
+				return;
+
+			std::lock_guard guard(current->lock);
+			auto [it, below] = current->seek(first);
+			std::uint64_t skip = first - below;
+			for (; it != current->partitions.end() && out.size() < count; ++it, skip = 0) {
+				auto& found = it->second;
+				std::size_t take = (std::min)(found.size() - static_cast<std::size_t>(skip), count - out.size());
+				out.insert(out.end(), found.begin() + static_cast<std::ptrdiff_t>(skip), found.begin() + static_cast<std::ptrdiff_t>(skip + take));
+			}
+		}
+
+		auto results( void ) const -> std::vector<std::uint64_t> {
+			std::vector<std::uint64_t> ret;
+			results(0, static_cast<std::size_t>(result_count()), ret);
+			return ret;
+		}
+
+	private:
+		struct state {
+			using partition_map = std::map<std::uint64_t, std::vector<std::uint64_t>>;
+
+			job work;
+			std::atomic<std::uint64_t> scanned{ 0 };
+			clock::time_point started = clock::now();
+
+			mutable std::mutex lock;
+			partition_map partitions; // hits by the address of the chunk they're in
+			std::uint64_t hits = 0;
+			clock::time_point last_merge = started;
+
+			// the partition the last seek landed in and the index of its first hit. the table asks for about the
+			// same rows every frame, so a seek walks from here and not from the first partition; merge keeps
+			// below right as partitions land under it (map iterators survive the insert)
+			partition_map::const_iterator cursor = partitions.end();
+			std::uint64_t cursor_below = 0;
+
+			auto merge( std::uint64_t chunk, std::vector<std::uint64_t>&& found ) -> void {
+				std::lock_guard guard(lock);
+				last_merge = clock::now();
+				if (found.empty())
+					return;
+				hits += found.size();
+				if (cursor != partitions.end() && chunk < cursor->first)
+					cursor_below += found.size();
+				partitions.emplace(chunk, std::move(found));
+			}
+
+			// the partition holding the index-th hit and the index of its first, end() past the last. under lock
+			auto seek( std::uint64_t index ) -> std::pair<partition_map::const_iterator, std::uint64_t> {
+				auto it = cursor;
+				std::uint64_t below = cursor_below;
+				if (it == partitions.end() || index < below / 2) {
+					it = partitions.begin();
+					below = 0;
+				}
+
+				while (index < below) {
+					--it;
+					below -= it->second.size();
+				}
+				while (it != partitions.end() && index >= below + it->second.size()) {
+					below += it->second.size();
+					++it;
+				}
+
+				cursor = it;
+				cursor_below = it == partitions.end() ? 0 : below;
+				return { it, below };
+			}
+		};
+
+		auto restart( lane priority ) -> std::shared_ptr<state> {
+			cancel();
+			current = std::make_shared<state>();
+			current->work = make_job(priority);
+			return current;
+		}
+
+		std::shared_ptr<state> current;
+	};
+}
@@ -0,0 +1,292 @@
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include "stats.h"
+#include "timeline.h"
+
+namespace reblox::memory {
+	enum struct lane : std::uint8_t {
+		io, // a read something is about to block on. short, and ahead of everything so the reader keeps moving
+		interactive, // the user is waiting on it
+		normal,
+		background, // refreshes and anything else that can take as long as it likes
+		count
+	};
+
+	inline constexpr std::size_t lane_count = static_cast<std::size_t>(lane::count);
+
+	// what a group of tasks shares: the lane, cancellation, progress and completion. tasks of a cancelled job
+	// that haven't started are dropped, running ones see cancelled() and return early
+	class job_state {
+	public:
+		explicit job_state( lane priority ) : priority(priority) {}
+
+		auto cancel( void ) -> void {
+			stopped.store(true, std::memory_order_relaxed);
+		}
+
+		auto cancelled( void ) const -> bool {
+			return stopped.load(std::memory_order_relaxed);
+		}
+
+		// progress is in whatever unit the job picks, bytes for anything that walks memory
+		auto add_total( std::uint64_t amount ) -> void {
+			total.fetch_add(amount, std::memory_order_relaxed);
+		}
+
+		auto advance( std::uint64_t amount ) -> void {
+			completed.fetch_add(amount, std::memory_order_relaxed);
+		}
+
+		auto get_total( void ) const -> std::uint64_t {
+			return total.load(std::memory_order_relaxed);
+		}
+
+		auto get_completed( void ) const -> std::uint64_t {
+			return completed.load(std::memory_order_relaxed);
+		}
+
+		// no task queued or running. a job nothing was submitted to is done
+		auto done( void ) const -> bool {
+			return pending.load(std::memory_order_acquire) == 0;
+		}
+
+		auto get_lane( void ) const -> lane {
+			return priority;
+		}
+
+		// blocks until done(), running this job's queued tasks on the calling thread meanwhile. never anyone
+		// else's: the UI thread stopping a scan mustn't end up running an unrelated census for a frame
+		auto wait( void ) -> void;
+
+	private:
+		friend class scheduler;
+
+		lane priority;
+		std::atomic<std::size_t> pending{ 0 };
+		std::atomic<bool> stopped{ false };
+		std::atomic<std::uint64_t> completed{ 0 };
+		std::atomic<std::uint64_t> total{ 0 };
+	};
+
+	using job = std::shared_ptr<job_state>;
+
+	inline auto make_job( lane priority = lane::normal ) -> job {
+		return std::make_shared<job_state>(priority);
+	}
+
+	// one pool of workers for every engine, so concurrent scans, censuses and captures share the cores instead
+	// of each bringing its own threads. every worker has a deque per lane: it pushes and pops its own at the
+	// back (the task it just split off is the one whose data is warm), idle workers steal from the front of
+	// someone else's (the oldest, biggest piece). tasks from outside the pool go through a shared deque. a
+	// worker always takes the most urgent lane it can find anywhere before looking at the next one
+	class scheduler {
+	public:
+		using task_function = std::function<void( void )>;
+
+		~scheduler( void ) {
+			stopping.store(true);
+			signal.fetch_add(1, std::memory_order_release);
+			signal.notify_all();
+			workers.clear();
+		}
+
+		auto submit( const job& owner, task_function fn ) -> void {
+			std::call_once(started, [this] { start(); });
+			owner->pending.fetch_add(1, std::memory_order_relaxed);
+
+			queue& target = *queues[worker_index() == none ? outside : worker_index()];
+			{
+				std::lock_guard guard(target.lock);
+				target.lanes[static_cast<std::size_t>(owner->priority)].push_back({ owner, std::move(fn) });
+			}
+			wake_worker();
+			wake_waiters(); // it may be a waited job's, and that waiter can run it
+		}
+
+		// fn(first, last) over [begin, end) in pieces of at most grain. a task covering more than that splits
+		// off its upper half as a new task before starting, so idle workers find work at every size
+		template <typename fn_t>
+		auto parallel_for( const job& owner, std::uint64_t begin, std::uint64_t end, std::uint64_t grain, fn_t fn ) -> void {
+			if (begin < end)
+				push_range(owner, begin, end, (std::max)(grain, std::uint64_t(1)), std::make_shared<fn_t>(std::move(fn)));
+		}
+
+		// runs one queued task on the calling thread, false if there was none. with only, just a task of that job
+		auto help( const job_state* only = nullptr ) -> bool {
+			std::call_once(started, [this] { start(); });
+			return run_one(worker_index() == none ? outside : worker_index(), only);
+		}
+
+		auto worker_count( void ) -> std::size_t {
+			std::call_once(started, [this] { start(); });
+			return outside;
+		}
+
+	private:
+		friend class job_state;
+
+		struct task {
+			job owner;
+			task_function fn;
+		};
+
+		struct queue {
+			std::mutex lock;
+			std::deque<task> lanes[lane_count];
+		};
+
+		static constexpr std::size_t none = ~std::size_t(0);
+
+		static auto worker_index( void ) -> std::size_t& {
+			thread_local std::size_t index = none;
+			return index;
+		}
+
+		auto start( void ) -> void {
+			outside = (std::max)(std::thread::hardware_concurrency(), 2u) - 1;
+			for (std::size_t i = 0; i <= outside; i++)
+				queues.push_back(std::make_unique<queue>());
+			for (std::size_t i = 0; i < outside; i++) {
+				workers.emplace_back([this, i] {
+					worker_index() = i;
+					timeline::engine.name_thread("scheduler");
+					run();
+				});
+			}
+		}
+
+		template <typename fn_t>
+		auto push_range( const job& owner, std::uint64_t begin, std::uint64_t end, std::uint64_t grain, std::shared_ptr<fn_t> body ) -> void {
+			submit(owner, [this, owner, begin, end, grain, body] {
+				std::uint64_t last = end;
+				for (;;) {
+					std::uint64_t pieces = (last - begin + grain - 1) / grain;
+					if (pieces <= 1)
+						break;
+					std::uint64_t middle = begin + pieces / 2 * grain;
+					push_range(owner, middle, last, grain, body);
+					last = middle;
+				}
+				(*body)(begin, last);
+			});
+		}
+
+		auto run_one( std::size_t self, const job_state* only = nullptr ) -> bool {
+			task work;
+			if (!take(self, only, work))
+				return false;
+			execute(work);
+			return true;
+		}
+
+		auto take( std::size_t self, const job_state* only, task& out ) -> bool {
+			for (std::size_t lane = 0; lane < lane_count; lane++) {
+				if (only && lane != static_cast<std::size_t>(only->priority))
+					continue;
+				if (self != outside && pop(*queues[self], lane, true, only, out))
+					return true;
+				if (pop(*queues[outside], lane, false, only, out))
+					return true;
+
+				// starting next to the thief, so they don't all pile onto the first queue
+				for (std::size_t i = 1; i <= outside; i++) {
+					std::size_t victim = (self + i) % outside;
+					if (victim != self && pop(*queues[victim], lane, false, only, out)) {
+						stats::add(stats::counter::scheduler_steals);
+						return true;
+					}
+				}
+			}
+			return false;
+		}
+
+		static auto pop( queue& from, std::size_t lane, bool back, const job_state* only, task& out ) -> bool {
+			std::lock_guard guard(from.lock);
+			auto& tasks = from.lanes[lane];
+			if (tasks.empty())
+				return false;
+
+			if (only) {
+				auto it = std::find_if(tasks.begin(), tasks.end(), [only](const task& queued) { return queued.owner.get() == only; });
+				if (it == tasks.end())
+					return false;
+				out = std::move(*it);
+				tasks.erase(it);
+			}
+			else if (back) {
+				out = std::move(tasks.back());
+				tasks.pop_back();
+			}
+			else {
+				out = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			return true;
+		}
+
+		auto execute( task& work ) -> void {
+			if (!work.owner->cancelled()) {
+				stats::add(stats::counter::scheduler_tasks);
+				work.fn();
+			}
+
+			// the last task of a job wakes whoever waits on it
+			if (work.owner->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				wake_waiters();
+			work = {};
+		}
+
+		auto run( void ) -> void {
+			while (!stopping.load()) {
+				std::uint32_t seen = signal.load(std::memory_order_acquire);
+				if (!run_one(worker_index()))
+					signal.wait(seen, std::memory_order_acquire);
+			}
+		}
+
+		// idle workers sleep on signal, any of them can take a new task so one is enough
+		auto wake_worker( void ) -> void {
+			signal.fetch_add(1, std::memory_order_release);
+			signal.notify_one();
+		}
+
+		// waiters sleep on their own signal: one only runs its own job's tasks, so a notify it absorbed for
+		// someone else's task would leave that task queued with every worker asleep. all of them wake on every
+		// submit and finished job, and the notify is skipped when nobody waits. both sides are seq_cst, so a
+		// waiter either sees the bump or is counted in waiting before it's read
+		auto wake_waiters( void ) -> void {
+			waiter_signal.fetch_add(1);
+			if (waiting.load())
+				waiter_signal.notify_all();
+		}
+
+		std::vector<std::unique_ptr<queue>> queues; // by worker, then one for tasks from outside the pool
+		std::size_t outside = 0; // its index, and the number of workers
+		std::atomic<std::uint32_t> signal{ 0 };
+		std::atomic<std::uint32_t> waiter_signal{ 0 };
+		std::atomic<std::uint32_t> waiting{ 0 }; // threads in job_state::wait
+		std::atomic<bool> stopping{ false };
+		std::once_flag started;
+		std::vector<std::jthread> workers; // last, so they're joined before the queues go away
+	};
+
+	inline scheduler pool;
+
+	inline auto job_state::wait( void ) -> void {
+		pool.waiting.fetch_add(1);
+		while (!done()) {
+			std::uint32_t seen = pool.waiter_signal.load();
+			if (!pool.help(this) && !done())
+				pool.waiter_signal.wait(seen);
+		}
+		pool.waiting.fetch_sub(1);
+	}
+}
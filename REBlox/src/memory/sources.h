@@ -0,0 +1,496 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <span>
+#include <memory>
+#include <functional>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include "memory.h"
+#include "modules.h"
+#include "regions.h"
+#include "scheduler.h"
+
+namespace reblox::memory {
+	// read only view of a whole file. snapshots and dumps are served straight out of the mapping, so the os
+	// pages them in as they're read and a 30 GB dump costs nothing up front
+	class mapped_file {
+	public:
+		explicit mapped_file( const std::filesystem::path& path ) {
+			file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return;
+
+			LARGE_INTEGER length{};
+			if (!GetFileSizeEx(file, &length) || length.QuadPart <= 0)
+				return;
+
+			mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (!mapping)
+				return;
+
+			view = static_cast<const std::uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			if (view)
+				bytes = static_cast<std::uint64_t>(length.QuadPart);
+		}
+
+		~mapped_file( void ) {
+			if (view)
+				UnmapViewOfFile(view);
+			if (mapping)
+				CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE)
+				CloseHandle(file);
+		}
+
+		mapped_file( const mapped_file& ) = delete;
+		mapped_file& operator=( const mapped_file& ) = delete;
+
+		auto data( void ) const -> const std::uint8_t* {
+			return view;
+		}
+
+		auto is_open( void ) const -> bool {
+			return view != nullptr;
+		}
+
+		auto size( void ) const -> std::uint64_t {
+			return bytes;
+		}
+
+		// [offset, offset + length) of the file, null if that runs off the end
+		auto at( std::uint64_t offset, std::uint64_t length ) const -> const std::uint8_t* {
+			if (offset > bytes || length > bytes - offset)
+				return nullptr;
+			return view + offset;
+		}
+
+	private:
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+		const std::uint8_t* view = nullptr;
+		std::uint64_t bytes = 0;
+	};
+
+	// where a source's bytes live in its file, sorted by base
+	struct mapped_range {
+		std::uint64_t base;
+		std::uint64_t size;
+		std::uint64_t offset; // into the file
+	};
+
+	// copies [address, address + size) out of ranges, crossing into the next range where they touch
+	inline auto read_ranges( const mapped_file& file, std::span<const mapped_range> ranges, std::uint64_t address, void* buffer, std::size_t size ) -> bool {
+		auto out = static_cast<std::uint8_t*>(buffer);
+		auto it = std::upper_bound(ranges.begin(), ranges.end(), address, [](std::uint64_t value, const mapped_range& range) { return value < range.base; });
+		if (it == ranges.begin())
+			return false;
+		--it;
+
+		while (size) {
+			if (it == ranges.end() || address < it->base || address - it->base >= it->size)
+				return false;
+
+			std::uint64_t offset = address - it->base;
+			std::size_t chunk = static_cast<std::size_t>((std::min)(static_cast<std::uint64_t>(size), it->size - offset));
+			const std::uint8_t* data = file.at(it->offset + offset, chunk);
+			if (!data)
+				return false;
+
+			std::memcpy(out, data, chunk);
+			out += chunk;
+			address += chunk;
+			size -= chunk;
+			++it;
+		}
+
+		return true;
+	}
+
+	inline auto make_module_entry( std::wstring_view path, std::uint64_t base, std::uint32_t size ) -> ME32 {
+		ME32 entry{};
+		entry.dwSize = sizeof(ME32);
+		entry.modBaseAddr = reinterpret_cast<BYTE*>(base);
+		entry.modBaseSize = size;
+
+		std::size_t slash = path.find_last_of(L"\\/");
+		std::wstring_view name = slash == std::wstring_view::npos ? path : path.substr(slash + 1);
+		name.copy(entry.szModule, (std::min)(name.size(), std::size(entry.szModule) - 1));
+		path.copy(entry.szExePath, (std::min)(path.size(), std::size(entry.szExePath) - 1));
+		return entry;
+	}
+
+	// our own capture format, .rbxs: a header, the module list, one record per committed region, then the
+	// bytes of every region that was readable, laid out back to back after the tables
+	namespace snapshot {
+		inline constexpr std::uint32_t magic = 0x53584252; // "RBXS"
+		inline constexpr std::uint32_t version = 1;
+		inline constexpr std::size_t chunk_size = 0x100000;
+
+		struct file_header {
+			std::uint32_t magic;
+			std::uint32_t version;
+			std::uint64_t process_base;
+			std::uint32_t pid;
+			std::uint32_t module_count;
+			std::uint32_t region_count;
+			std::uint32_t reserved;
+		};
+
+		// followed by path_length utf-16 code units
+		struct module_record {
+			std::uint64_t base;
+			std::uint32_t size;
+			std::uint32_t path_length;
+		};
+
+		struct region_record {
+			std::uint64_t base;
+			std::uint64_t size;
+			std::uint32_t protect;
+			std::uint32_t type;
+			std::uint64_t data; // file offset of the region's bytes, 0 if it wasn't captured
+		};
+
+		struct module_entry {
+			std::wstring path;
+			std::uint64_t base;
+			std::uint32_t size;
+		};
+
+		struct region_entry {
+			std::uint64_t base;
+			std::uint64_t size;
+			DWORD protect;
+			DWORD type;
+			bool captured;
+		};
+
+		// produces bytes [offset, offset + out.size()) of a captured region, zeroing whatever it can't
+		using fill_function = std::function<void( const region_entry&, std::uint64_t, std::span<std::uint8_t> )>;
+
+		// streams the region bytes a window of chunks at a time: the pool fills a window in parallel (reads are
+		// what takes the time on a live target) and it's written out in order, so a snapshot of any size never
+		// holds more than the window. fill runs on several threads at once
+		inline auto write( const std::filesystem::path& path, std::uint64_t process_base, std::uint32_t pid, std::span<const module_entry> modules, std::span<const region_entry> regions, const fill_function& fill ) -> bool {
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			if (!file)
+				return false;
+
+			std::uint64_t tables = sizeof(file_header) + regions.size() * sizeof(region_record);
+			for (auto& module : modules)
+				tables += sizeof(module_record) + module.path.size() * sizeof(std::uint16_t);
+			const std::uint64_t first_data = (tables + page_size - 1) & ~static_cast<std::uint64_t>(page_size - 1);
+			std::uint64_t data = first_data;
+
+			file_header header{ magic, version, process_base, pid, static_cast<std::uint32_t>(modules.size()), static_cast<std::uint32_t>(regions.size()), 0 };
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+			std::vector<std::uint16_t> units;
+			for (auto& module : modules) {
+				module_record record{ module.base, module.size, static_cast<std::uint32_t>(module.path.size()) };
+				units.assign(module.path.begin(), module.path.end());
+				file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+				file.write(reinterpret_cast<const char*>(units.data()), units.size() * sizeof(std::uint16_t));
+			}
+
+			for (auto& region : regions) {
+				region_record record{ region.base, region.size, static_cast<std::uint32_t>(region.protect), static_cast<std::uint32_t>(region.type), region.captured ? data : 0 };
+				file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+				if (region.captured)
+					data += region.size;
+			}
+
+			// region bytes start page aligned
+			const std::vector<std::uint8_t> padding(static_cast<std::size_t>(first_data - tables));
+			file.write(reinterpret_cast<const char*>(padding.data()), static_cast<std::streamsize>(padding.size()));
+
+			struct piece {
+				const region_entry* region;
+				std::uint64_t offset;
+				std::size_t size;
+			};
+			std::vector<piece> pieces;
+			for (auto& region : regions) {
+				if (!region.captured)
+					continue;
+
+				for (std::uint64_t offset = 0; offset < region.size; offset += chunk_size)
+					pieces.push_back({ &region, offset, static_cast<std::size_t>((std::min)(static_cast<std::uint64_t>(chunk_size), region.size - offset)) });
+			}
+
+			const std::size_t window = std::clamp<std::size_t>(pool.worker_count() * 2, 2, 16);
+			std::vector<std::vector<std::uint8_t>> buffers(window, std::vector<std::uint8_t>(chunk_size));
+			for (std::size_t first = 0; first < pieces.size() && file; first += window) {
+				std::size_t count = (std::min)(window, pieces.size() - first);
+				job work = make_job();
+				pool.parallel_for(work, 0, count, 1, [&](std::uint64_t begin, std::uint64_t end) {
+					for (std::uint64_t i = begin; i < end; i++) {
+						const piece& at = pieces[first + i];
+						fill(*at.region, at.offset, { buffers[i].data(), at.size });
+					}
+				});
+				work->wait();
+
+				for (std::size_t i = 0; i < count; i++)
+					file.write(reinterpret_cast<const char*>(buffers[i].data()), static_cast<std::streamsize>(pieces[first + i].size));
+			}
+
+			return file.good();
+		}
+
+		// everything readable in the attached target. pages that fail to read come out as zeros
+		inline auto capture( const std::filesystem::path& path ) -> bool {
+			if (!attached())
+				return false;
+
+			std::vector<module_entry> module_list;
+			for (auto& module : modules.current()->modules)
+				module_list.push_back({ module->path, module->base, module->size });
+
+			// toolhelp order puts the main module first, keep that for whoever opens the file
+			std::stable_partition(module_list.begin(), module_list.end(), [](const module_entry& module) { return module.base == state.process_base; });
+
+			std::vector<region_entry> region_list;
+			for (auto& region : regions.all())
+				region_list.push_back({ region.base, region.size, region.protect, region.type, region.readable() });
+
+			return write(path, state.process_base, static_cast<std::uint32_t>(state.pid), module_list, region_list, [](const region_entry& region, std::uint64_t offset, std::span<std::uint8_t> out) {
+				if (read_bytes(region.base + offset, out.data(), out.size()))
+					return;
+
+				for (std::size_t page = 0; page < out.size(); page += page_size) {
+					std::size_t size = (std::min)(page_size, out.size() - page);
+					if (!read_bytes(region.base + offset + page, out.data() + page, size))
+						std::memset(out.data() + page, 0, size);
+				}
+			});
+		}
+	}
+
+	class snapshot_source : public memory_source {
+	public:
+		// null if the file isn't a snapshot or doesn't hold together
+		static auto open( const std::filesystem::path& path ) -> std::unique_ptr<snapshot_source> {
+			std::unique_ptr<snapshot_source> ret(new snapshot_source(path));
+			if (!ret->load())
+				return nullptr;
+			return ret;
+		}
+
+		auto read( std::uint64_t address, void* buffer, std::size_t size ) -> bool override {
+			return read_ranges(file, ranges, address, buffer, size);
+		}
+
+		auto query( std::uint64_t address, MEMORY_BASIC_INFORMATION& out ) -> bool override {
+			auto it = std::upper_bound(regions.begin(), regions.end(), address, [](std::uint64_t value, const snapshot::region_record& region) { return value < region.base + region.size; });
+			if (it == regions.end())
+				return false;
+
+			out = {};
+			out.BaseAddress = reinterpret_cast<void*>(it->base);
+			out.AllocationBase = out.BaseAddress;
+			out.RegionSize = static_cast<SIZE_T>(it->size);
+			out.State = MEM_COMMIT;
+			out.Protect = it->protect;
+			out.Type = it->type;
+			return true;
+		}
+
+		auto modules( void ) -> std::vector<ME32> override {
+			return module_list;
+		}
+
+		auto get_header( void ) const -> const snapshot::file_header& {
+			return header;
+		}
+
+	private:
+		explicit snapshot_source( const std::filesystem::path& path ) : file(path) {}
+
+		auto load( void ) -> bool {
+			const std::uint8_t* raw = file.at(0, sizeof(header));
+			if (!raw)
+				return false;
+
+			std::memcpy(&header, raw, sizeof(header));
+			if (header.magic != snapshot::magic || header.version != snapshot::version)
+				return false;
+
+			std::uint64_t offset = sizeof(header);
+			for (std::uint32_t i = 0; i < header.module_count; i++) {
+				snapshot::module_record record;
+				if (!(raw = file.at(offset, sizeof(record))))
+					return false;
+				std::memcpy(&record, raw, sizeof(record));
+				offset += sizeof(record);
+
+				if (!(raw = file.at(offset, record.path_length * sizeof(std::uint16_t))))
+					return false;
+				std::wstring path(record.path_length, L'\0');
+				for (std::uint32_t c = 0; c < record.path_length; c++) {
+					std::uint16_t unit;
+					std::memcpy(&unit, raw + c * sizeof(unit), sizeof(unit));
+					path[c] = static_cast<wchar_t>(unit);
+				}
+				offset += record.path_length * sizeof(std::uint16_t);
+
+				module_list.push_back(make_module_entry(path, record.base, record.size));
+			}
+
+			if (!(raw = file.at(offset, static_cast<std::uint64_t>(header.region_count) * sizeof(snapshot::region_record))))
+				return false;
+			regions.resize(header.region_count);
+			std::memcpy(regions.data(), raw, regions.size() * sizeof(snapshot::region_record));
+			std::sort(regions.begin(), regions.end(), [](const auto& a, const auto& b) { return a.base < b.base; });
+
+			for (auto& region : regions) {
+				if (region.data && file.at(region.data, region.size))
+					ranges.push_back({ region.base, region.size, region.data });
+			}
+
+			return true;
+		}
+
+		mapped_file file;
+		snapshot::file_header header{};
+		std::vector<snapshot::region_record> regions; // sorted by base
+		std::vector<mapped_range> ranges; // the captured ones
+		std::vector<ME32> module_list;
+	};
+
+	// full memory (Memory64ListStream) or classic (MemoryListStream) minidumps as written by MiniDumpWriteDump,
+	// procdump or task manager. protections and types come from the memory info stream when the dump has one
+	class minidump_source : public memory_source {
+	public:
+		static auto open( const std::filesystem::path& path ) -> std::unique_ptr<minidump_source> {
+			std::unique_ptr<minidump_source> ret(new minidump_source(path));
+			if (!ret->load())
+				return nullptr;
+			return ret;
+		}
+
+		auto read( std::uint64_t address, void* buffer, std::size_t size ) -> bool override {
+			return read_ranges(file, ranges, address, buffer, size);
+		}
+
+		auto query( std::uint64_t address, MEMORY_BASIC_INFORMATION& out ) -> bool override {
+			auto it = std::upper_bound(infos.begin(), infos.end(), address, [](std::uint64_t value, const memory_region& region) { return value < region.end(); });
+			if (it == infos.end())
+				return false;
+
+			out = {};
+			out.BaseAddress = reinterpret_cast<void*>(it->base);
+			out.AllocationBase = out.BaseAddress;
+			out.RegionSize = static_cast<SIZE_T>(it->size);
+			out.State = MEM_COMMIT;
+			out.Protect = it->protect;
+			out.Type = it->type;
+			return true;
+		}
+
+		auto modules( void ) -> std::vector<ME32> override {
+			return module_list;
+		}
+
+	private:
+		explicit minidump_source( const std::filesystem::path& path ) : file(path) {}
+
+		auto stream( ULONG type, ULONG& size ) -> const std::uint8_t* {
+			PMINIDUMP_DIRECTORY directory = nullptr;
+			void* data = nullptr;
+			size = 0;
+			if (!MiniDumpReadDumpStream(const_cast<std::uint8_t*>(file.data()), type, &directory, &data, &size) || !data)
+				return nullptr;
+
+			// DbgHelp doesn't check the stream against the file size, we do
+			auto bytes = static_cast<const std::uint8_t*>(data);
+			return file.at(static_cast<std::uint64_t>(bytes - file.data()), size) ? bytes : nullptr;
+		}
+
+		auto load( void ) -> bool {
+			if (!file.is_open())
+				return false;
+
+			ULONG size = 0;
+			if (auto list = reinterpret_cast<const MINIDUMP_MEMORY64_LIST*>(stream(Memory64ListStream, size)); list && size >= offsetof(MINIDUMP_MEMORY64_LIST, MemoryRanges)) {
+				std::uint64_t count = (size - offsetof(MINIDUMP_MEMORY64_LIST, MemoryRanges)) / sizeof(MINIDUMP_MEMORY_DESCRIPTOR64);
+				count = (std::min)(count, static_cast<std::uint64_t>(list->NumberOfMemoryRanges));
+
+				std::uint64_t offset = list->BaseRva;
+				for (std::uint64_t i = 0; i < count; i++) {
+					auto& range = list->MemoryRanges[i];
+					ranges.push_back({ range.StartOfMemoryRange, range.DataSize, offset });
+					offset += range.DataSize;
+				}
+			}
+			else if (auto list = reinterpret_cast<const MINIDUMP_MEMORY_LIST*>(stream(MemoryListStream, size)); list && size >= offsetof(MINIDUMP_MEMORY_LIST, MemoryRanges)) {
+				std::uint64_t count = (size - offsetof(MINIDUMP_MEMORY_LIST, MemoryRanges)) / sizeof(MINIDUMP_MEMORY_DESCRIPTOR);
+				count = (std::min)(count, static_cast<std::uint64_t>(list->NumberOfMemoryRanges));
+
+				for (std::uint64_t i = 0; i < count; i++) {
+					auto& range = list->MemoryRanges[i];
+					ranges.push_back({ range.StartOfMemoryRange, range.Memory.DataSize, range.Memory.Rva });
+				}
+			}
+			else {
+				return false;
+			}
+
+			std::erase_if(ranges, [&](const mapped_range& range) { return !file.at(range.offset, range.size); });
+			std::sort(ranges.begin(), ranges.end(), [](const mapped_range& a, const mapped_range& b) { return a.base < b.base; });
+
+			if (auto list = reinterpret_cast<const MINIDUMP_MEMORY_INFO_LIST*>(stream(MemoryInfoListStream, size)); list && size >= sizeof(MINIDUMP_MEMORY_INFO_LIST) && list->SizeOfHeader <= size && list->SizeOfEntry >= sizeof(MINIDUMP_MEMORY_INFO)) {
+				auto entries = reinterpret_cast<const std::uint8_t*>(list) + list->SizeOfHeader;
+				std::uint64_t count = (std::min)(static_cast<std::uint64_t>(list->NumberOfEntries), (size - list->SizeOfHeader) / list->SizeOfEntry);
+
+				for (std::uint64_t i = 0; i < count; i++) {
+					MINIDUMP_MEMORY_INFO info;
+					std::memcpy(&info, entries + i * list->SizeOfEntry, sizeof(info));
+					if (info.State == MEM_COMMIT)
+						infos.push_back({ info.BaseAddress, info.RegionSize, info.Protect, info.Type });
+				}
+			}
+			else {
+				// no protections in the dump, every captured range is plain read/write data
+				for (auto& range : ranges)
+					infos.push_back({ range.base, range.size, PAGE_READWRITE, MEM_PRIVATE });
+			}
+			std::sort(infos.begin(), infos.end(), [](const memory_region& a, const memory_region& b) { return a.base < b.base; });
+
+			if (auto list = reinterpret_cast<const MINIDUMP_MODULE_LIST*>(stream(ModuleListStream, size)); list && size >= offsetof(MINIDUMP_MODULE_LIST, Modules)) {
+				std::uint64_t count = (size - offsetof(MINIDUMP_MODULE_LIST, Modules)) / sizeof(MINIDUMP_MODULE);
+				count = (std::min)(count, static_cast<std::uint64_t>(list->NumberOfModules));
+
+				for (std::uint64_t i = 0; i < count; i++) {
+					auto& module = list->Modules[i];
+					std::wstring path;
+					if (auto name = file.at(module.ModuleNameRva, sizeof(std::uint32_t))) {
+						std::uint32_t length; // MINIDUMP_STRING, byte length then utf-16
+						std::memcpy(&length, name, sizeof(length));
+						if (auto units = file.at(module.ModuleNameRva + sizeof(length), length)) {
+							path.resize(length / sizeof(std::uint16_t));
+							for (std::size_t c = 0; c < path.size(); c++) {
+								std::uint16_t unit;
+								std::memcpy(&unit, units + c * sizeof(unit), sizeof(unit));
+								path[c] = static_cast<wchar_t>(unit);
+							}
+						}
+					}
+
+					module_list.push_back(make_module_entry(path, module.BaseOfImage, module.SizeOfImage));
+				}
+			}
+
+			return !ranges.empty();
+		}
+
+		mapped_file file;
+		std::vector<mapped_range> ranges; // sorted by base
+		std::vector<memory_region> infos; // committed, sorted by base
+		std::vector<ME32> module_list;
+	};
+}
@@ -0,0 +1,252 @@
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <array>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <bit>
+#include <string_view>
+#include <algorithm>
+
+// counters and latency histograms for the memory layer and the engines on top of it. every thread writes
+// its own shard without a lock or a locked instruction (one writer, relaxed load and store), readers add the
+// shards up. cheap enough to leave on: a counter is two plain moves, a timed scope two clock reads more
+namespace reblox::memory::stats {
+	enum struct counter : std::uint32_t {
+		reads, // read_bytes calls, one ReadProcessMemory (or source read) each
+		bytes_read,
+		failed_reads,
+		queries, // VirtualQueryEx / source queries
+		scatter_batches,
+		scatter_entries, // blocks asked for across all scatter batches
+		batch_ticks, // read_batch rounds, each one scatter batch
+		engine_jobs,
+		page_cache_hits,
+		page_cache_misses,
+		vtable_cache_hits,
+		vtable_cache_misses,
+		scan_chunks,
+		scan_inline_reads, // chunks a walk read itself, no worker had picked the read up by the time it needed it
+		scheduler_tasks,
+		scheduler_steals, // tasks a worker took from another worker's deque
+		count
+	};
+
+	inline constexpr std::string_view counter_names[] = {
+		"reads", "bytes_read", "failed_reads", "queries", "scatter_batches", "scatter_entries", "batch_ticks",
+		"engine_jobs", "page_cache_hits", "page_cache_misses", "vtable_cache_hits", "vtable_cache_misses", "scan_chunks",
+		"scan_inline_reads", "scheduler_tasks", "scheduler_steals",
+	};
+
+	enum struct timer : std::uint32_t {
+		read, // one read_bytes
+		query,
+		scatter, // one read_scatter, all of its reads
+		engine_wait, // submitted to a worker picking it up
+		engine_job, // a worker running it
+		batch_tick,
+		scan_chunk, // a scan's work on one chunk, after it was read
+		scan_wait, // a scan waiting on its next chunk's read, ~0 while the reads keep ahead
+		count
+	};
+
+	inline constexpr std::string_view timer_names[] = {
+		"read", "query", "scatter", "engine_wait", "engine_job", "batch_tick", "scan_chunk", "scan_wait",
+	};
+
+	inline constexpr std::size_t counter_count = static_cast<std::size_t>(counter::count);
+	inline constexpr std::size_t timer_count = static_cast<std::size_t>(timer::count);
+	static_assert(std::size(counter_names) == counter_count && std::size(timer_names) == timer_count);
+
+	// HDR style log-linear buckets over nanoseconds: exact below 2^sub_bits, then 2^sub_bits buckets per power
+	// of two, so a bucket is never wider than ~3% of what it holds. tops out around 18 minutes
+	inline constexpr unsigned sub_bits = 5;
+	inline constexpr unsigned max_bits = 40;
+	inline constexpr std::size_t bucket_count = static_cast<std::size_t>(max_bits - sub_bits + 1) << sub_bits;
+
+	inline constexpr auto bucket_of( std::uint64_t ns ) -> std::size_t {
+		ns = (std::min)(ns, (std::uint64_t{ 1 } << max_bits) - 1);
+		if (ns < (1ull << sub_bits))
+			return static_cast<std::size_t>(ns);
+
+		unsigned exponent = static_cast<unsigned>(std::bit_width(ns)) - 1;
+		std::uint64_t sub = (ns >> (exponent - sub_bits)) & ((1ull << sub_bits) - 1);
+		return (static_cast<std::size_t>(exponent - sub_bits + 1) << sub_bits) + static_cast<std::size_t>(sub);
+	}
+
+	// smallest value that lands in bucket
+	inline constexpr auto bucket_floor( std::size_t bucket ) -> std::uint64_t {
+		if (bucket < (1ull << sub_bits))
+			return bucket;
+
+		unsigned exponent = static_cast<unsigned>(bucket >> sub_bits) + sub_bits - 1;
+		std::uint64_t sub = bucket & ((1ull << sub_bits) - 1);
+		return ((1ull << sub_bits) + sub) << (exponent - sub_bits);
+	}
+
+	struct histogram {
+		std::array<std::uint64_t, bucket_count> buckets{};
+		std::uint64_t count = 0;
+		std::uint64_t total_ns = 0;
+		std::uint64_t max_ns = 0;
+
+		// q in [0, 1], the middle of the bucket the q-th value is in
+		auto percentile( double q ) const -> std::uint64_t {
+			if (!count)
+				return 0;
+
+			std::uint64_t rank = static_cast<std::uint64_t>(q * (count - 1)) + 1;
+			std::uint64_t seen = 0;
+			for (std::size_t i = 0; i < bucket_count; i++) {
+				seen += buckets[i];
+				if (seen >= rank)
+					return (std::min)((bucket_floor(i) + bucket_floor(i + 1)) / 2, max_ns);
+			}
+			return max_ns;
+		}
+
+		auto mean_ns( void ) const -> double {
+			return count ? static_cast<double>(total_ns) / count : 0;
+		}
+	};
+
+	// the totals at one point, minus whatever was there at the last reset
+	struct report {
+		std::array<std::uint64_t, counter_count> counters{};
+		std::array<histogram, timer_count> timers{};
+		double seconds = 0; // since the reset
+
+		auto get( counter which ) const -> std::uint64_t {
+			return counters[static_cast<std::size_t>(which)];
+		}
+
+		auto get( timer which ) const -> const histogram& {
+			return timers[static_cast<std::size_t>(which)];
+		}
+
+		// hits / (hits + misses), 0 with neither
+		auto ratio( counter hits, counter misses ) const -> double {
+			std::uint64_t total = get(hits) + get(misses);
+			return total ? static_cast<double>(get(hits)) / total : 0;
+		}
+	};
+
+	class registry {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		auto add( counter which, std::uint64_t amount ) -> void {
+			bump(local().counters[static_cast<std::size_t>(which)], amount);
+		}
+
+		auto record( timer which, std::uint64_t ns ) -> void {
+			auto& mine = local();
+			std::size_t index = static_cast<std::size_t>(which);
+			bump(mine.buckets[index][bucket_of(ns)], 1);
+			bump(mine.totals[index], ns);
+			if (ns > mine.maxima[index].load(std::memory_order_relaxed))
+				mine.maxima[index].store(ns, std::memory_order_relaxed);
+		}
+
+		auto take( void ) -> report {
+			std::lock_guard guard(lock);
+			report ret = sum();
+			for (std::size_t i = 0; i < counter_count; i++)
+				ret.counters[i] -= baseline.counters[i];
+			for (std::size_t t = 0; t < timer_count; t++) {
+				auto& current = ret.timers[t];
+				auto& base = baseline.timers[t];
+				for (std::size_t b = 0; b < bucket_count; b++)
+					current.buckets[b] -= base.buckets[b];
+				current.count -= base.count;
+				current.total_ns -= base.total_ns;
+				if (!current.count)
+					current.max_ns = 0;
+			}
+			ret.seconds = std::chrono::duration<double>(clock::now() - since).count();
+			return ret;
+		}
+
+		// shards only ever grow, so a reset remembers the totals and take() subtracts them. maxima can't be
+		// subtracted and keep whatever came before until a thread sees a bigger one
+		auto reset( void ) -> void {
+			std::lock_guard guard(lock);
+			baseline = sum();
+			since = clock::now();
+		}
+
+	private:
+		struct shard {
+			std::atomic<std::uint64_t> counters[counter_count]{};
+			std::atomic<std::uint64_t> buckets[timer_count][bucket_count]{};
+			std::atomic<std::uint64_t> totals[timer_count]{};
+			std::atomic<std::uint64_t> maxima[timer_count]{};
+		};
+
+		// only the owning thread writes, so no read-modify-write instruction is needed
+		static auto bump( std::atomic<std::uint64_t>& value, std::uint64_t amount ) -> void {
+			value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+		}
+
+		// shards outlive their threads, a finished worker's numbers stay in the totals
+		auto local( void ) -> shard& {
+			thread_local shard* mine = [this] {
+				std::lock_guard guard(lock);
+				return shards.emplace_back(std::make_unique<shard>()).get();
+			}();
+			return *mine;
+		}
+
+		auto sum( void ) -> report {
+			report ret;
+			for (auto& entry : shards) {
+				for (std::size_t i = 0; i < counter_count; i++)
+					ret.counters[i] += entry->counters[i].load(std::memory_order_relaxed);
+				for (std::size_t t = 0; t < timer_count; t++) {
+					auto& out = ret.timers[t];
+					for (std::size_t b = 0; b < bucket_count; b++) {
+						std::uint64_t hits = entry->buckets[t][b].load(std::memory_order_relaxed);
+						out.buckets[b] += hits;
+						out.count += hits;
+					}
+					out.total_ns += entry->totals[t].load(std::memory_order_relaxed);
+					out.max_ns = (std::max)(out.max_ns, entry->maxima[t].load(std::memory_order_relaxed));
+				}
+			}
+			return ret;
+		}
+
+		std::mutex lock;
+		std::vector<std::unique_ptr<shard>> shards;
+		report baseline;
+		clock::time_point since = clock::now();
+	};
+
+	inline registry engine;
+
+	inline auto add( counter which, std::uint64_t amount = 1 ) -> void {
+		engine.add(which, amount);
+	}
+
+	inline auto record( timer which, std::uint64_t ns ) -> void {
+		engine.record(which, ns);
+	}
+
+	class scoped_timer {
+	public:
+		explicit scoped_timer( timer which ) : which(which), started(registry::clock::now()) {}
+
+		~scoped_timer( void ) {
+			record(which, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(registry::clock::now() - started).count()));
+		}
+
+		scoped_timer( const scoped_timer& ) = delete;
+		scoped_timer& operator=( const scoped_timer& ) = delete;
+
+	private:
+		timer which;
+		registry::clock::time_point started;
+	};
+}
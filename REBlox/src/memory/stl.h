@@ -0,0 +1,278 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <span>
+#include <unordered_map>
+#include <type_traits>
+#include "memory.h"
+
+// readers for MSVC (x64, release / _ITERATOR_DEBUG_LEVEL 0) standard containers living in the target.
+// everything here works on raw layouts, so keys/values have to be trivially copyable. for remote
+// std::string members use string_layout as the type and resolve them afterwards with read_strings
+namespace reblox::memory::stl {
+	struct vector_layout {
+		std::uint64_t first;
+		std::uint64_t last;
+		std::uint64_t end;
+	};
+
+	struct string_layout {
+		union {
+			char buf[16];
+			std::uint64_t ptr;
+		} bx;
+		std::uint64_t size;
+		std::uint64_t capacity;
+	};
+
+	struct tree_layout { // std::map / std::set
+		std::uint64_t head;
+		std::uint64_t size;
+	};
+
+	struct tree_node_layout {
+		std::uint64_t left;
+		std::uint64_t parent;
+		std::uint64_t right;
+		char color;
+		char is_nil;
+	};
+
+	struct list_node_layout {
+		std::uint64_t next;
+		std::uint64_t prev;
+	};
+
+	struct hash_layout { // std::unordered_map / std::unordered_set
+		float max_load_factor; // _Traitsobj, hasher and key_eq are empty
+		std::uint64_t list_head;
+		std::uint64_t list_size;
+		vector_layout buckets; // two iterators (lo, hi) per bucket
+		std::uint64_t mask;
+		std::uint64_t max_index;
+	};
+
+	static_assert(sizeof(string_layout) == 0x20);
+	static_assert(sizeof(hash_layout) == 0x40);
+
+	// anything bigger than this is almost certainly garbage and not worth a multi-GB read
+	inline constexpr std::size_t max_elements = 1 << 24;
+
+	template <typename key_t, typename value_t>
+	struct pair_layout {
+		key_t first;
+		value_t second;
+	};
+
+	template <typename t>
+	inline constexpr std::size_t node_value_offset(std::size_t header) {
+		return (header + alignof(t) - 1) & ~(alignof(t) - 1);
+	}
+
+	template <typename t>
+	inline auto read_vector( std::uint64_t address ) -> std::vector<t> {
+		static_assert(std::is_trivially_copyable_v<t>);
+
+		auto layout = read_memory<vector_layout>(address);
+		if (layout.last <= layout.first || (layout.last - layout.first) % sizeof(t) != 0)
+			return {};
+
+		std::size_t count = static_cast<std::size_t>((layout.last - layout.first) / sizeof(t));
+		if (count > max_elements)
+			return {};
+
+		std::vector<t> ret(count);
+		if (!read_bytes(layout.first, ret.data(), count * sizeof(t)))
+			return {};
+
+		return ret;
+	}
+
+	template <typename char_t>
+	inline auto string_is_inline( const string_layout& layout ) -> bool {
+		return layout.capacity < sizeof(layout.bx.buf) / sizeof(char_t);
+	}
+
+	// resolves many string objects at once: inline (SSO) ones are free, heap ones go out in one scatter batch
+	template <typename char_t = char>
+	inline auto read_strings( std::span<const string_layout> layouts ) -> std::vector<std::basic_string<char_t>> {
+		std::vector<std::basic_string<char_t>> ret(layouts.size());
+		std::vector<scatter_read> reads;
+
+		for (std::size_t i = 0; i < layouts.size(); i++) {
+			auto& layout = layouts[i];
+			if (layout.size > layout.capacity || layout.size > max_elements)
+				continue;
+
+			ret[i].resize(static_cast<std::size_t>(layout.size));
+			if (string_is_inline<char_t>(layout))
+				std::memcpy(ret[i].data(), layout.bx.buf, ret[i].size() * sizeof(char_t));
+			else if (layout.size)
+				reads.push_back({ layout.bx.ptr, ret[i].data(), ret[i].size() * sizeof(char_t), false });
+		}
+
+		read_scatter(reads);
+		for (auto& read : reads) {
+			if (!read.ok)
+				std::memset(read.buffer, 0, read.size);
+		}
+
+		return ret;
+	}
+
+	template <typename char_t = char>
+	inline auto read_string( std::uint64_t address ) -> std::basic_string<char_t> {
+		string_layout layout = read_memory<string_layout>(address);
+		return read_strings<char_t>(std::span<const string_layout>(&layout, 1))[0];
+	}
+
+	// walks the red-black tree one level at a time, every level is a single scatter batch. nodes are then
+	// put back in key order locally, so a 100k element map costs ~2*log2(n) batches instead of n reads
+	template <typename key_t, typename value_t>
+	inline auto read_map( std::uint64_t address ) -> std::vector<std::pair<key_t, value_t>> {
+		using pair_t = pair_layout<key_t, value_t>;
+		static_assert(std::is_trivially_copyable_v<key_t> && std::is_trivially_copyable_v<value_t>);
+
+		constexpr std::size_t value_offset = node_value_offset<pair_t>(offsetof(tree_node_layout, is_nil) + 1);
+		constexpr std::size_t node_size = value_offset + sizeof(pair_t);
+
+		auto tree = read_memory<tree_layout>(address);
+		if (!tree.head || !tree.size || tree.size > max_elements)
+			return {};
+
+		auto head = read_memory<tree_node_layout>(tree.head);
+		if (!head.is_nil || head.parent == tree.head)
+			return {};
+
+		struct node {
+			std::uint64_t left;
+			std::uint64_t right;
+			pair_t value;
+		};
+		std::vector<node> nodes;
+		std::unordered_map<std::uint64_t, std::uint32_t> index;
+		nodes.reserve(static_cast<std::size_t>(tree.size));
+		index.reserve(static_cast<std::size_t>(tree.size));
+
+		std::vector<std::uint64_t> frontier{ head.parent };
+		std::vector<std::uint64_t> next_frontier;
+		std::vector<std::uint8_t> level;
+		std::vector<scatter_read> reads;
+
+		while (!frontier.empty() && nodes.size() < tree.size) {
+			level.resize(frontier.size() * node_size);
+			reads.clear();
+			for (std::size_t i = 0; i < frontier.size(); i++)
+				reads.push_back({ frontier[i], level.data() + i * node_size, node_size, false });
+			read_scatter(reads);
+
+			next_frontier.clear();
+			for (std::size_t i = 0; i < frontier.size() && nodes.size() < tree.size; i++) {
+				if (!reads[i].ok)
+					continue;
+
+				tree_node_layout header;
+				std::memcpy(&header, level.data() + i * node_size, sizeof(header));
+				if (header.is_nil || !index.emplace(frontier[i], static_cast<std::uint32_t>(nodes.size())).second)
+					continue;
+
+				node& n = nodes.emplace_back();
+				n.left = header.left;
+				n.right = header.right;
+				std::memcpy(&n.value, level.data() + i * node_size + value_offset, sizeof(pair_t));
+
+				if (header.left != tree.head)
+					next_frontier.push_back(header.left);
+				if (header.right != tree.head)
+					next_frontier.push_back(header.right);
+			}
+
+			frontier.swap(next_frontier);
+		}
+
+		// in-order walk over what we pulled, no more remote reads from here
+		std::vector<std::pair<key_t, value_t>> ret;
+		ret.reserve(nodes.size());
+		std::vector<std::uint32_t> stack;
+		auto lookup = [&](std::uint64_t addr) -> std::int64_t {
+			auto it = index.find(addr);
+			return it == index.end() ? -1 : static_cast<std::int64_t>(it->second);
+		};
+
+		std::int64_t current = lookup(head.parent);
+		while ((current != -1 || !stack.empty()) && ret.size() < nodes.size()) {
+			while (current != -1) {
+				stack.push_back(static_cast<std::uint32_t>(current));
+				current = lookup(nodes[current].left);
+			}
+			std::uint32_t top = stack.back();
+			stack.pop_back();
+			ret.emplace_back(nodes[top].value.first, nodes[top].value.second);
+			current = lookup(nodes[top].right);
+		}
+
+		return ret;
+	}
+
+	// reads the bucket vector in one go, then advances every non-empty bucket's chain in lockstep.
+	// with a sane load factor that's a handful of scatter batches for the whole table
+	template <typename key_t, typename value_t>
+	inline auto read_unordered_map( std::uint64_t address ) -> std::vector<std::pair<key_t, value_t>> {
+		using pair_t = pair_layout<key_t, value_t>;
+		static_assert(std::is_trivially_copyable_v<key_t> && std::is_trivially_copyable_v<value_t>);
+
+		constexpr std::size_t value_offset = node_value_offset<pair_t>(sizeof(list_node_layout));
+		constexpr std::size_t node_size = value_offset + sizeof(pair_t);
+
+		auto hash = read_memory<hash_layout>(address);
+		if (!hash.list_head || !hash.list_size || hash.list_size > max_elements)
+			return {};
+
+		auto buckets = read_vector<std::uint64_t>(address + offsetof(hash_layout, buckets));
+		if (buckets.size() % 2 != 0)
+			return {};
+
+		struct chain {
+			std::uint64_t current;
+			std::uint64_t last;
+		};
+		std::vector<chain> chains;
+		for (std::size_t i = 0; i < buckets.size(); i += 2) {
+			if (buckets[i] != hash.list_head)
+				chains.push_back({ buckets[i], buckets[i + 1] });
+		}
+
+		std::vector<std::pair<key_t, value_t>> ret;
+		ret.reserve(static_cast<std::size_t>(hash.list_size));
+		std::vector<std::uint8_t> level;
+		std::vector<scatter_read> reads;
+
+		while (!chains.empty() && ret.size() < hash.list_size) {
+			level.resize(chains.size() * node_size);
+			reads.clear();
+			for (std::size_t i = 0; i < chains.size(); i++)
+				reads.push_back({ chains[i].current, level.data() + i * node_size, node_size, false });
+			read_scatter(reads);
+
+			std::size_t alive = 0;
+			for (std::size_t i = 0; i < chains.size(); i++) {
+				if (!reads[i].ok)
+					continue;
+
+				list_node_layout header;
+				std::memcpy(&header, level.data() + i * node_size, sizeof(header));
+				pair_t value;
+				std::memcpy(&value, level.data() + i * node_size + value_offset, sizeof(pair_t));
+				ret.emplace_back(value.first, value.second);
+
+				if (chains[i].current != chains[i].last && header.next != hash.list_head)
+					chains[alive++] = { header.next, chains[i].last };
+			}
+			chains.resize(alive);
+		}
+
+		return ret;
+	}
+}
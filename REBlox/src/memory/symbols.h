@@ -0,0 +1,192 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <cstring>
+#include <vector>
+#include <span>
+#include <numeric>
+#include <memory>
+#include <unordered_map>
+#include "modules.h"
+
+namespace reblox::memory {
+	struct symbol {
+		const module_info* module; // null if the address isn't inside any module
+		const module_export* exp; // closest export at or below the address, null if there is none
+		std::uint64_t offset; // from exp if set, otherwise from the module base
+	};
+
+	// number of elements <= value in a sorted array. the loop has a fixed trip count for a given n and
+	// the compare turns into a cmov, so there are no unpredictable branches to eat when resolving big batches
+	template <typename t>
+	inline auto branchless_upper_bound( const t* data, std::size_t count, t value ) -> std::size_t {
+		if (!count)
+			return 0;
+
+		const t* base = data;
+		while (count > 1) {
+			std::size_t half = count / 2;
+			base = base[half] <= value ? base + half : base;
+			count -= half;
+		}
+
+		return static_cast<std::size_t>(base - data) + (*base <= value);
+	}
+
+	// resolves addresses to module!export+0xNN against the export tables in the module map. each module's
+	// exports get sorted once (per module map generation) and formatted names are cached per address
+	class symbolizer {
+	public:
+		auto resolve( std::uint64_t address ) -> symbol {
+			sync();
+			std::size_t m = snapshot->index_of(address);
+			if (m == module_snapshot::none)
+				return {};
+
+			return lookup(m, address);
+		}
+
+		// resolves a whole batch, out[i] belongs to addresses[i]. addresses are walked in sorted order so
+		// consecutive hits in the same module skip the module lookup entirely
+		auto resolve( std::span<const std::uint64_t> addresses, std::span<symbol> out ) -> void {
+			sync();
+
+			thread_local std::vector<std::uint32_t> order;
+			order.resize(addresses.size());
+			std::iota(order.begin(), order.end(), 0u);
+			std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) { return addresses[a] < addresses[b]; });
+
+			std::size_t m = module_snapshot::none;
+			for (std::uint32_t i : order) {
+				std::uint64_t address = addresses[i];
+				if (m == module_snapshot::none || !snapshot->modules[m]->contains(address))
+					m = snapshot->index_of(address);
+
+				out[i] = m != module_snapshot::none ? lookup(m, address) : symbol{};
+			}
+		}
+
+		auto format( const symbol& sym, char* buf, std::size_t size ) const -> std::size_t {
+			if (!sym.module || !size)
+				return 0;
+
+			int written;
+			if (!sym.exp)
+				written = snprintf(buf, size, "%s+0x%llX", sym.module->name_utf8.c_str(), static_cast<unsigned long long>(sym.offset));
+			else if (sym.exp->name.empty())
+				written = snprintf(buf, size, "%s!#%u+0x%llX", sym.module->name_utf8.c_str(), sym.exp->ordinal, static_cast<unsigned long long>(sym.offset));
+			else
+				written = snprintf(buf, size, "%s!%s+0x%llX", sym.module->name_utf8.c_str(), sym.exp->name.c_str(), static_cast<unsigned long long>(sym.offset));
+
+			return written < 0 ? 0 : (std::min)(static_cast<std::size_t>(written), size - 1);
+		}
+
+		// cached "module!export+0xNN", empty if the address isn't in a module. meant to be called per visible row.
+		// a copy: the cache is dropped when it fills up or the modules change, a reference wouldn't survive that
+		auto name( std::uint64_t address ) -> std::string {
+			sync();
+			auto it = cache.find(address);
+			if (it != cache.end())
+				return it->second;
+
+			if (cache.size() >= max_cached)
+				cache.clear();
+
+			char buf[512];
+			return cache.emplace(address, std::string(buf, format(resolve(address), buf, sizeof(buf)))).first->second;
+		}
+
+		// name() into buf, for the rows drawn every frame. returns the length, 0 if it isn't in a module
+		auto name( std::uint64_t address, char* buf, std::size_t size ) -> std::size_t {
+			if (!size)
+				return 0;
+
+			sync();
+			auto it = cache.find(address);
+			if (it == cache.end())
+				return format(resolve(address), buf, size);
+
+			std::size_t length = (std::min)(it->second.size(), size - 1);
+			std::memcpy(buf, it->second.data(), length);
+			buf[length] = '\0';
+			return length;
+		}
+
+		// warms the cache for a batch (scan hits, a screen of rows) with one sorted pass
+		auto prefetch( std::span<const std::uint64_t> addresses ) -> void {
+			sync();
+			thread_local std::vector<std::uint64_t> missing;
+			thread_local std::vector<symbol> resolved;
+
+			missing.clear();
+			for (auto address : addresses) {
+				if (!cache.contains(address))
+					missing.push_back(address);
+			}
+			if (missing.empty())
+				return;
+
+			if (cache.size() + missing.size() > max_cached)
+				cache.clear();
+
+			resolved.resize(missing.size());
+			resolve(missing, resolved);
+
+			char buf[512];
+			for (std::size_t i = 0; i < missing.size(); i++)
+				cache.emplace(missing[i], std::string(buf, format(resolved[i], buf, sizeof(buf))));
+		}
+
+	private:
+		struct export_table {
+			std::vector<std::uint32_t> rvas; // sorted
+			std::vector<std::uint32_t> index; // into module_info::exports, parallel to rvas
+		};
+
+		static constexpr std::size_t max_cached = 1 << 18;
+
+		auto sync( void ) -> void {
+			auto latest = modules.current();
+			if (snapshot && snapshot->generation == latest->generation)
+				return;
+
+			snapshot = std::move(latest);
+			cache.clear();
+			tables.clear();
+			tables.resize(snapshot->modules.size());
+
+			for (std::size_t m = 0; m < snapshot->modules.size(); m++) {
+				auto& exports = snapshot->modules[m]->exports;
+				auto& table = tables[m];
+
+				for (std::uint32_t i = 0; i < exports.size(); i++) {
+					if (!exports[i].forwarded)
+						table.index.push_back(i);
+				}
+				std::sort(table.index.begin(), table.index.end(), [&](std::uint32_t a, std::uint32_t b) { return exports[a].rva < exports[b].rva; });
+
+				table.rvas.resize(table.index.size());
+				for (std::size_t i = 0; i < table.index.size(); i++)
+					table.rvas[i] = exports[table.index[i]].rva;
+			}
+		}
+
+		auto lookup( std::size_t m, std::uint64_t address ) const -> symbol {
+			const module_info* module = snapshot->modules[m].get();
+			const export_table& table = tables[m];
+			std::uint32_t rva = static_cast<std::uint32_t>(address - module->base);
+			std::size_t below = branchless_upper_bound(table.rvas.data(), table.rvas.size(), rva);
+			if (!below)
+				return { module, nullptr, rva };
+
+			const module_export* exp = &module->exports[table.index[below - 1]];
+			return { module, exp, rva - exp->rva };
+		}
+
+		std::shared_ptr<const module_snapshot> snapshot; // the modules the tables were built for
+		std::vector<export_table> tables; // parallel to snapshot->modules
+		std::unordered_map<std::uint64_t, std::string> cache;
+	};
+
+	inline symbolizer symbols;
+}
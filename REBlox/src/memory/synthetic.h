@@ -0,0 +1,618 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <span>
+#include <memory>
+#include <algorithm>
+#include <filesystem>
+#include "memory.h"
+#include "stl.h"
+#include "sources.h"
+
+// a fake target laid out the way an MSVC x64 build looks in memory: a PE image with real RTTI (type
+// descriptors, locators, hierarchy descriptors, vtables) and an export table, heaps full of objects, multi
+// level pointer chains and MSVC STL containers. every byte is a pure function of the config, so any size
+// can be served or written out without holding it, and the ground truth comes with it
+namespace reblox::memory::synthetic {
+	inline constexpr std::uint64_t image_base = 0x140000000;
+	inline constexpr std::uint64_t misc_base = 0x1F0000000000; // chains and container storage
+	inline constexpr std::uint64_t heap_base = 0x200000000000;
+	inline constexpr std::uint64_t heap_gap = 0x100000; // between heap regions, the first page of it is a guard page
+	inline constexpr std::uint64_t slot_size = 0x80; // one object per slot
+	inline constexpr std::size_t slot_words = slot_size / sizeof(std::uint64_t);
+
+	inline constexpr std::uint32_t text_rva = 0x1000;
+	inline constexpr std::uint32_t text_size = 0x10000;
+	inline constexpr std::uint32_t function_align = 0x40;
+	inline constexpr std::uint32_t data_size = 0x1000;
+	inline constexpr std::uint64_t chain_stride = 0x2000; // chain nodes further apart than a pointer search offset
+	inline constexpr std::uint64_t chain_offsets[] = { 0x18, 0x28, 0x40 };
+
+	// where the globals sit in .data
+	inline constexpr std::uint32_t chain_globals = 0x100;
+	inline constexpr std::uint32_t max_chains = (0x800 - chain_globals) / sizeof(std::uint64_t);
+	inline constexpr std::uint32_t vector_global = 0x800;
+	inline constexpr std::uint32_t short_string_global = 0x820;
+	inline constexpr std::uint32_t long_string_global = 0x840;
+	inline constexpr std::uint32_t map_global = 0x860;
+	inline constexpr std::uint32_t unordered_map_global = 0x880;
+
+	inline constexpr char signature_pattern[] = "48 8B 05 ?? ?? ?? ?? 48 85 C0 0F 84 ?? ?? ?? ?? 8B 88 5C 01 00 00";
+	inline constexpr std::uint32_t signature_function = 100;
+
+	struct config {
+		std::uint64_t seed = 1;
+		std::uint64_t heap_bytes = 256ull << 20;
+		std::uint64_t heap_region = 64ull << 20; // heaps are split into regions of this size
+		std::uint32_t types = 64;
+		std::uint32_t chains = 32;
+		std::uint32_t elements = 1000; // per container
+		std::uint32_t free_one_in = 8; // slots left empty
+	};
+
+	// the parts of MSVC's rttidata.h nothing else here reads. x64, so every pointer is an image rva
+	struct base_class_descriptor {
+		std::int32_t type_descriptor;
+		std::uint32_t contained_bases;
+		std::int32_t mdisp;
+		std::int32_t pdisp;
+		std::int32_t vdisp;
+		std::uint32_t attributes;
+		std::int32_t hierarchy;
+	};
+
+	struct class_hierarchy_descriptor {
+		std::uint32_t signature;
+		std::uint32_t attributes;
+		std::uint32_t base_count;
+		std::int32_t base_array;
+	};
+
+	struct type_truth {
+		std::string mangled;
+		std::uint64_t vfptr;
+		std::uint64_t type_descriptor;
+		std::uint32_t parent; // none for the roots
+		std::uint32_t depth;
+		std::uint64_t count; // live objects in the heaps
+	};
+
+	// [[[base] + offsets[0]] + offsets[1]] + offsets[2] == target
+	struct chain_truth {
+		std::uint64_t base;
+		std::vector<std::uint64_t> offsets;
+		std::uint64_t target;
+	};
+
+	// vector<uint32_t> holds i * 3 + 1, map<uint32_t, uint32_t> and unordered_map<uint32_t, uint32_t> map i to i * i
+	struct container_truth {
+		std::uint64_t vector;
+		std::uint64_t short_string;
+		std::uint64_t long_string;
+		std::uint64_t map;
+		std::uint64_t unordered_map;
+		std::uint32_t elements;
+		std::string short_text;
+		std::string long_text;
+	};
+
+	struct truth {
+		std::vector<type_truth> types;
+		std::vector<chain_truth> chains;
+		container_truth containers;
+		std::string signature;
+		std::uint64_t signature_address;
+		std::uint64_t objects;
+	};
+
+	inline constexpr std::uint32_t none = ~0u;
+
+	// splitmix64, all the randomness here is this applied to the seed and an index
+	inline constexpr auto mix( std::uint64_t x ) -> std::uint64_t {
+		x += 0x9E3779B97F4A7C15;
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EB;
+		return x ^ (x >> 31);
+	}
+
+	template <typename t>
+	inline auto store( std::vector<std::uint8_t>& buffer, std::size_t offset, const t& value ) -> void {
+		std::memcpy(buffer.data() + offset, &value, sizeof(t));
+	}
+
+	class target {
+	public:
+		explicit target( const config& wanted ) : settings(wanted) {
+			settings.types = std::clamp(settings.types, 1u, 4096u);
+			settings.chains = (std::min)(settings.chains, max_chains);
+			settings.free_one_in = (std::max)(settings.free_one_in, 2u);
+			settings.heap_region = (std::max)(settings.heap_region & ~static_cast<std::uint64_t>(page_size - 1), static_cast<std::uint64_t>(page_size));
+
+			build_image();
+			build_misc();
+			build_heaps();
+			count_objects();
+		}
+
+		// bytes [address, address + out.size()), false if any of it isn't inside a captured region
+		auto fill( std::uint64_t address, std::span<std::uint8_t> out ) const -> bool {
+			while (!out.empty()) {
+				auto it = std::upper_bound(region_list.begin(), region_list.end(), address, [](std::uint64_t value, const snapshot::region_entry& region) { return value < region.base + region.size; });
+				if (it == region_list.end() || address < it->base || !it->captured)
+					return false;
+
+				std::size_t size = static_cast<std::size_t>((std::min)(static_cast<std::uint64_t>(out.size()), it->base + it->size - address));
+				if (it->type == MEM_IMAGE)
+					std::memcpy(out.data(), image.data() + (address - image_base), size);
+				else if (it->base == misc_base)
+					std::memcpy(out.data(), misc.data() + (address - misc_base), size);
+				else
+					fill_heap(address, out.first(size));
+
+				address += size;
+				out = out.subspan(size);
+			}
+			return true;
+		}
+
+		auto regions( void ) const -> std::span<const snapshot::region_entry> {
+			return region_list;
+		}
+
+		auto modules( void ) const -> std::vector<snapshot::module_entry> {
+			return { { L"C:\\Synthetic\\Game.exe", image_base, static_cast<std::uint32_t>(image.size()) } };
+		}
+
+		auto get_truth( void ) const -> const truth& {
+			return ground_truth;
+		}
+
+		auto get_config( void ) const -> const config& {
+			return settings;
+		}
+
+		// what sits in a heap slot, none for a free one
+		auto object_type( std::uint64_t slot ) const -> std::uint32_t {
+			std::uint64_t h = mix(settings.seed ^ (slot * 0xD1B54A32D192ED03));
+			if (h % settings.free_one_in == 0)
+				return none;
+
+			// skewed toward low indices, so the census has a shape
+			std::uint64_t a = (h >> 16) % settings.types;
+			std::uint64_t b = (h >> 40) % settings.types;
+			return static_cast<std::uint32_t>(a * b / settings.types);
+		}
+
+		auto slot_address( std::uint64_t slot ) const -> std::uint64_t {
+			return heap_base + (slot / slots_per_region) * (settings.heap_region + heap_gap) + (slot % slots_per_region) * slot_size;
+		}
+
+	private:
+		auto build_image( void ) -> void {
+			const std::uint32_t types = settings.types;
+			const std::uint32_t functions = text_size / function_align;
+			auto function = [](std::uint32_t index) { return image_base + text_rva + index * function_align; };
+
+			// .rdata: type_info's vtable, then per type descriptor / base class descriptor / hierarchy / base
+			// array / locator / vtable, then the export table
+			const std::uint32_t rdata_rva = text_rva + text_size;
+			std::uint32_t cursor = rdata_rva;
+			auto take = [&](std::uint32_t size, std::uint32_t align) {
+				cursor = (cursor + align - 1) & ~(align - 1);
+				std::uint32_t at = cursor;
+				cursor += size;
+				return at;
+			};
+
+			std::vector<std::uint32_t> parent(types), depth(types), td(types), bcd(types), chd(types), bca(types), col(types), vtable(types);
+			for (std::uint32_t k = 0; k < types; k++) {
+				parent[k] = k ? (k - 1) / 2 : none;
+				depth[k] = k ? depth[parent[k]] + 1 : 0;
+			}
+
+			const std::uint32_t type_info_vftable = take(sizeof(std::uint64_t), 8);
+			for (std::uint32_t k = 0; k < types; k++) {
+				td[k] = take(0x40, 16);
+				bcd[k] = take(sizeof(base_class_descriptor), 4);
+				chd[k] = take(sizeof(class_hierarchy_descriptor), 4);
+				bca[k] = take((depth[k] + 2) * sizeof(std::int32_t), 8); // null terminated like the real ones
+				col[k] = take(sizeof(rtti::_s_RTTICompleteObjectLocator), 8);
+				vtable[k] = take((1 + 3 + depth[k]) * sizeof(std::uint64_t), 8);
+			}
+
+			constexpr std::uint32_t export_count = 16;
+			const std::uint32_t export_dir = take(sizeof(IMAGE_EXPORT_DIRECTORY), 4);
+			const std::uint32_t export_functions = take(export_count * 4, 4);
+			const std::uint32_t export_names = take(export_count * 4, 4);
+			const std::uint32_t export_ordinals = take(export_count * 2, 2);
+			const std::uint32_t export_strings = take(16 + export_count * 24, 1);
+			const std::uint32_t export_end = cursor;
+
+			const std::uint32_t rdata_size = ((cursor - rdata_rva) + page_size - 1) & ~static_cast<std::uint32_t>(page_size - 1);
+			const std::uint32_t data_rva = rdata_rva + rdata_size;
+			image.assign(data_rva + data_size, 0);
+
+			// headers
+			IMAGE_DOS_HEADER dos{};
+			dos.e_magic = IMAGE_DOS_SIGNATURE;
+			dos.e_lfanew = 0x80;
+			store(image, 0, dos);
+
+			IMAGE_NT_HEADERS64 nt{};
+			nt.Signature = IMAGE_NT_SIGNATURE;
+			nt.FileHeader.Machine = IMAGE_FILE_MACHINE_AMD64;
+			nt.FileHeader.NumberOfSections = 3;
+			nt.FileHeader.TimeDateStamp = static_cast<DWORD>(mix(settings.seed));
+			nt.FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER64);
+			nt.OptionalHeader.Magic = IMAGE_NT_OPTIONAL_HDR64_MAGIC;
+			nt.OptionalHeader.AddressOfEntryPoint = text_rva;
+			nt.OptionalHeader.BaseOfCode = text_rva;
+			nt.OptionalHeader.ImageBase = image_base;
+			nt.OptionalHeader.SectionAlignment = page_size;
+			nt.OptionalHeader.FileAlignment = 0x200;
+			nt.OptionalHeader.SizeOfImage = static_cast<DWORD>(image.size());
+			nt.OptionalHeader.SizeOfHeaders = 0x400;
+			nt.OptionalHeader.NumberOfRvaAndSizes = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+			nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT] = { export_dir, export_end - export_dir };
+			store(image, dos.e_lfanew, nt);
+
+			const struct {
+				const char* name;
+				std::uint32_t rva;
+				std::uint32_t size;
+				std::uint32_t characteristics;
+			} sections[] = {
+				{ ".text", text_rva, text_size, IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ },
+				{ ".rdata", rdata_rva, rdata_size, IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ },
+				{ ".data", data_rva, data_size, IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ | IMAGE_SCN_MEM_WRITE },
+			};
+			std::size_t section_at = dos.e_lfanew + offsetof(IMAGE_NT_HEADERS64, OptionalHeader) + sizeof(IMAGE_OPTIONAL_HEADER64);
+			for (auto& section : sections) {
+				IMAGE_SECTION_HEADER header{};
+				std::memcpy(header.Name, section.name, std::strlen(section.name));
+				header.Misc.VirtualSize = section.size;
+				header.VirtualAddress = section.rva;
+				header.SizeOfRawData = section.size;
+				header.Characteristics = section.characteristics;
+				store(image, section_at, header);
+				section_at += sizeof(header);
+			}
+
+			// .text: functions with a prologue, noise and an int3 tail, one of them holding the signature
+			static constexpr std::uint8_t prologue[] = { 0x40, 0x53, 0x48, 0x83, 0xEC, 0x20 };
+			for (std::uint32_t f = 0; f < functions; f++) {
+				std::size_t at = text_rva + f * function_align;
+				std::uint64_t h = mix(settings.seed * 31 + f);
+				std::uint32_t body = 16 + static_cast<std::uint32_t>(h % (function_align - 24));
+
+				std::memcpy(image.data() + at, prologue, sizeof(prologue));
+				for (std::uint32_t i = sizeof(prologue); i < body; i++)
+					image[at + i] = static_cast<std::uint8_t>(mix(h + i));
+				image[at + body] = 0xC3;
+				std::memset(image.data() + at + body + 1, 0xCC, function_align - body - 1);
+			}
+
+			static constexpr std::uint8_t signature_bytes[] = { 0x48, 0x8B, 0x05, 0x10, 0x32, 0x54, 0x00, 0x48, 0x85, 0xC0, 0x0F, 0x84, 0x20, 0x01, 0x00, 0x00, 0x8B, 0x88, 0x5C, 0x01, 0x00, 0x00 };
+			const std::size_t signature_at = text_rva + signature_function * function_align + sizeof(prologue);
+			std::memcpy(image.data() + signature_at, signature_bytes, sizeof(signature_bytes));
+			ground_truth.signature = signature_pattern;
+			ground_truth.signature_address = image_base + signature_at;
+
+			// RTTI, linked by rva like the compiler emits it
+			store(image, type_info_vftable, function(0));
+			for (std::uint32_t k = 0; k < types; k++) {
+				char name[0x30];
+				std::snprintf(name, sizeof(name), ".?AVType%u@Synthetic@@", k);
+				store(image, td[k], image_base + type_info_vftable); // TypeDescriptor::pVFTable
+				std::memcpy(image.data() + td[k] + sizeof(rtti::TypeDescriptor), name, std::strlen(name) + 1);
+
+				store(image, bcd[k], base_class_descriptor{ static_cast<std::int32_t>(td[k]), depth[k], 0, -1, 0, 0x40, static_cast<std::int32_t>(chd[k]) });
+				store(image, chd[k], class_hierarchy_descriptor{ 0, 0, depth[k] + 1, static_cast<std::int32_t>(bca[k]) });
+
+				std::uint32_t base = 0;
+				for (std::uint32_t at = k; at != none; at = parent[at])
+					store(image, bca[k] + base++ * sizeof(std::int32_t), static_cast<std::int32_t>(bcd[at]));
+
+				rtti::_s_RTTICompleteObjectLocator locator{ 1, 0, 0, static_cast<int>(td[k]), static_cast<int>(chd[k]), static_cast<int>(col[k]) };
+				std::memcpy(image.data() + col[k], &locator, sizeof(locator));
+
+				store(image, vtable[k], image_base + col[k]);
+				for (std::uint32_t v = 0; v < 3 + depth[k]; v++)
+					store(image, vtable[k] + (1 + v) * sizeof(std::uint64_t), function((k * 7 + v * 13) % functions));
+
+				ground_truth.types.push_back({ name, image_base + vtable[k] + sizeof(std::uint64_t), image_base + td[k], parent[k], depth[k], 0 });
+			}
+
+			// exports, "Game.exe" then Synthetic_Function00.. names
+			IMAGE_EXPORT_DIRECTORY directory{};
+			directory.Name = export_strings;
+			directory.Base = 1;
+			directory.NumberOfFunctions = export_count;
+			directory.NumberOfNames = export_count;
+			directory.AddressOfFunctions = export_functions;
+			directory.AddressOfNames = export_names;
+			directory.AddressOfNameOrdinals = export_ordinals;
+			store(image, export_dir, directory);
+			std::memcpy(image.data() + export_strings, "Game.exe", 9);
+			for (std::uint32_t i = 0; i < export_count; i++) {
+				std::uint32_t name = export_strings + 16 + i * 24;
+				std::snprintf(reinterpret_cast<char*>(image.data() + name), 24, "Synthetic_Function%02u", i);
+				store(image, export_functions + i * 4, text_rva + i * 37 % functions * function_align);
+				store(image, export_names + i * 4, name);
+				store(image, export_ordinals + i * 2, static_cast<std::uint16_t>(i));
+			}
+
+			this->data_rva = data_rva;
+			region_list.push_back({ image_base, page_size, PAGE_READONLY, MEM_IMAGE, true });
+			region_list.push_back({ image_base + text_rva, text_size, PAGE_EXECUTE_READ, MEM_IMAGE, true });
+			region_list.push_back({ image_base + rdata_rva, rdata_size, PAGE_READONLY, MEM_IMAGE, true });
+			region_list.push_back({ image_base + data_rva, data_size, PAGE_READWRITE, MEM_IMAGE, true });
+		}
+
+		// chains first, each node on its own stride, then the container storage well past them
+		auto build_misc( void ) -> void {
+			const std::uint32_t n = settings.elements;
+			const std::uint64_t chains_size = settings.chains * std::size(chain_offsets) * chain_stride;
+			const std::uint64_t containers = (chains_size + 0x10000 + page_size - 1) & ~static_cast<std::uint64_t>(page_size - 1);
+
+			std::uint64_t bucket_count = 8;
+			while (bucket_count < n)
+				bucket_count *= 2;
+
+			constexpr std::uint64_t map_node = 0x30;
+			constexpr std::uint64_t hash_node = 0x20;
+			const std::uint64_t vector_at = containers;
+			const std::uint64_t string_at = vector_at + (((n + 8) * sizeof(std::uint32_t) + 15) & ~15ull);
+			const std::uint64_t map_at = string_at + 0x40;
+			const std::uint64_t hash_at = map_at + (n + 1) * map_node;
+			const std::uint64_t buckets_at = hash_at + (n + 1) * hash_node;
+			const std::uint64_t end = buckets_at + bucket_count * 2 * sizeof(std::uint64_t);
+			misc.assign((end + page_size - 1) & ~static_cast<std::uint64_t>(page_size - 1), 0);
+
+			auto global = [&](std::uint32_t offset) { return static_cast<std::size_t>(data_rva + offset); };
+
+			for (std::uint32_t k = 0; k < settings.chains; k++) {
+				std::uint64_t node[std::size(chain_offsets)];
+				for (std::size_t level = 0; level < std::size(chain_offsets); level++)
+					node[level] = misc_base + (k * std::size(chain_offsets) + level) * chain_stride;
+
+				store(image, global(chain_globals + k * sizeof(std::uint64_t)), node[0]);
+				for (std::size_t level = 0; level + 1 < std::size(chain_offsets); level++)
+					store(misc, node[level] - misc_base + chain_offsets[level], node[level + 1]);
+
+				std::uint64_t target = node[std::size(node) - 1] + chain_offsets[std::size(chain_offsets) - 1];
+				store(misc, target - misc_base, static_cast<std::uint64_t>(k) * 1000 + 1337);
+				ground_truth.chains.push_back({ image_base + global(chain_globals + k * sizeof(std::uint64_t)), { std::begin(chain_offsets), std::end(chain_offsets) }, target });
+			}
+
+			// std::vector<std::uint32_t>, some spare capacity
+			for (std::uint32_t i = 0; i < n; i++)
+				store(misc, vector_at + i * sizeof(std::uint32_t), i * 3 + 1);
+			store(image, global(vector_global), stl::vector_layout{ misc_base + vector_at, misc_base + vector_at + n * sizeof(std::uint32_t), misc_base + vector_at + (n + 8) * sizeof(std::uint32_t) });
+
+			// std::string, one inline and one on the heap
+			auto& containers_truth = ground_truth.containers;
+			containers_truth.short_text = "synthetic";
+			containers_truth.long_text = "a synthetic string long enough to live outside the object";
+			stl::string_layout small{};
+			std::memcpy(small.bx.buf, containers_truth.short_text.data(), containers_truth.short_text.size());
+			small.size = containers_truth.short_text.size();
+			small.capacity = 15;
+			store(image, global(short_string_global), small);
+
+			std::memcpy(misc.data() + string_at, containers_truth.long_text.data(), containers_truth.long_text.size());
+			stl::string_layout large{};
+			large.bx.ptr = misc_base + string_at;
+			large.size = containers_truth.long_text.size();
+			large.capacity = 0x3F;
+			store(image, global(long_string_global), large);
+
+			// std::map<std::uint32_t, std::uint32_t>, a perfectly balanced tree under the nil head
+			using pair_t = stl::pair_layout<std::uint32_t, std::uint32_t>;
+			constexpr std::size_t map_value = stl::node_value_offset<pair_t>(offsetof(stl::tree_node_layout, is_nil) + 1);
+			const std::uint64_t head = misc_base + map_at;
+			auto map_node_address = [&](std::uint32_t i) { return head + (i + 1) * map_node; };
+
+			auto build = [&](auto& self, std::int64_t lo, std::int64_t hi, std::uint64_t parent_node) -> std::uint64_t {
+				if (lo > hi)
+					return head;
+
+				std::uint32_t mid = static_cast<std::uint32_t>((lo + hi) / 2);
+				std::uint64_t address = map_node_address(mid);
+				stl::tree_node_layout node{};
+				node.parent = parent_node;
+				node.left = self(self, lo, mid - 1ll, address);
+				node.right = self(self, mid + 1ll, hi, address);
+				node.color = 1;
+				store(misc, address - misc_base, node);
+				store(misc, address - misc_base + map_value, pair_t{ mid, mid * mid });
+				return address;
+			};
+
+			stl::tree_node_layout nil{};
+			nil.parent = n ? build(build, 0, n - 1ll, head) : head;
+			nil.left = n ? map_node_address(0) : head;
+			nil.right = n ? map_node_address(n - 1) : head;
+			nil.color = 1;
+			nil.is_nil = 1;
+			store(misc, map_at, nil);
+			store(image, global(map_global), stl::tree_layout{ head, n });
+
+			// std::unordered_map<std::uint32_t, std::uint32_t>, one list with each bucket's nodes together
+			constexpr std::size_t hash_value = stl::node_value_offset<pair_t>(sizeof(stl::list_node_layout));
+			const std::uint64_t list_head = misc_base + hash_at;
+			std::vector<std::vector<std::uint32_t>> buckets(bucket_count);
+			for (std::uint32_t i = 0; i < n; i++)
+				buckets[(i * 2654435761u) & (bucket_count - 1)].push_back(i);
+
+			std::uint64_t previous = list_head;
+			std::uint32_t placed = 0;
+			for (std::uint64_t b = 0; b < bucket_count; b++) {
+				std::uint64_t first = list_head, last = list_head;
+				for (auto key : buckets[b]) {
+					std::uint64_t address = list_head + ++placed * hash_node;
+					if (first == list_head)
+						first = address;
+					last = address;
+
+					store(misc, previous - misc_base, address); // previous->next
+					store(misc, address - misc_base + sizeof(std::uint64_t), previous);
+					store(misc, address - misc_base + hash_value, pair_t{ key, key * key });
+					previous = address;
+				}
+				store(misc, buckets_at + b * 2 * sizeof(std::uint64_t), first);
+				store(misc, buckets_at + (b * 2 + 1) * sizeof(std::uint64_t), last);
+			}
+			store(misc, previous - misc_base, list_head);
+			store(misc, hash_at + sizeof(std::uint64_t), previous); // head->prev
+
+			stl::hash_layout hash{};
+			hash.max_load_factor = 1.0f;
+			hash.list_head = list_head;
+			hash.list_size = n;
+			hash.buckets = { misc_base + buckets_at, misc_base + end, misc_base + end };
+			hash.mask = bucket_count - 1;
+			hash.max_index = bucket_count;
+			store(image, global(unordered_map_global), hash);
+
+			containers_truth.vector = image_base + global(vector_global);
+			containers_truth.short_string = image_base + global(short_string_global);
+			containers_truth.long_string = image_base + global(long_string_global);
+			containers_truth.map = image_base + global(map_global);
+			containers_truth.unordered_map = image_base + global(unordered_map_global);
+			containers_truth.elements = n;
+
+			region_list.push_back({ misc_base, misc.size(), PAGE_READWRITE, MEM_PRIVATE, true });
+		}
+
+		auto build_heaps( void ) -> void {
+			slots_per_region = settings.heap_region / slot_size;
+			slot_count = (settings.heap_bytes + slot_size - 1) / slot_size;
+
+			for (std::uint64_t first = 0; first < slot_count; first += slots_per_region) {
+				std::uint64_t base = slot_address(first);
+				std::uint64_t size = ((std::min)(slots_per_region, slot_count - first) * slot_size + page_size - 1) & ~static_cast<std::uint64_t>(page_size - 1);
+				region_list.push_back({ base, size, PAGE_READWRITE, MEM_PRIVATE, true });
+				region_list.push_back({ base + settings.heap_region, page_size, PAGE_READWRITE | PAGE_GUARD, MEM_PRIVATE, false });
+			}
+		}
+
+		auto count_objects( void ) -> void {
+			ground_truth.objects = 0;
+			for (std::uint64_t slot = 0; slot < slot_count; slot++) {
+				std::uint32_t type = object_type(slot);
+				if (type != none) {
+					ground_truth.types[type].count++;
+					ground_truth.objects++;
+				}
+			}
+		}
+
+		// vfptr, id and type, two floats, a pointer to another live object, then small integers. nothing but the
+		// vfptr and that pointer can pass for an address, which keeps the census and pointer truth exact
+		auto fill_slot( std::uint64_t slot, std::uint64_t* words ) const -> void {
+			std::uint32_t type = object_type(slot);
+			if (type == none || slot >= slot_count) {
+				std::memset(words, 0, slot_size);
+				return;
+			}
+
+			std::uint64_t h = mix(settings.seed + slot);
+			float health = static_cast<float>(slot % 1000);
+			float max_health = 100.0f;
+			std::uint32_t bits[2];
+			std::memcpy(&bits[0], &health, sizeof(float));
+			std::memcpy(&bits[1], &max_health, sizeof(float));
+
+			std::uint64_t other = h % slot_count;
+			words[0] = ground_truth.types[type].vfptr;
+			words[1] = (slot & 0xFFFFFFFF) | (static_cast<std::uint64_t>(type) << 48);
+			words[2] = bits[0] | static_cast<std::uint64_t>(bits[1]) << 32;
+			words[3] = object_type(other) != none ? slot_address(other) : 0;
+			for (std::size_t i = 4; i < slot_words; i++)
+				words[i] = (h >> (i * 3)) & 0xFFFF;
+		}
+
+		auto fill_heap( std::uint64_t address, std::span<std::uint8_t> out ) const -> void {
+			std::uint64_t region = (address - heap_base) / (settings.heap_region + heap_gap);
+			std::uint64_t offset = (address - heap_base) % (settings.heap_region + heap_gap);
+			std::uint64_t slot = region * slots_per_region + offset / slot_size;
+			std::size_t skip = static_cast<std::size_t>(offset % slot_size);
+
+			std::uint64_t words[slot_words];
+			std::size_t written = 0;
+			while (written < out.size()) {
+				fill_slot(slot++, words);
+				std::size_t size = (std::min)(static_cast<std::size_t>(slot_size) - skip, out.size() - written);
+				std::memcpy(out.data() + written, reinterpret_cast<const std::uint8_t*>(words) + skip, size);
+				written += size;
+				skip = 0;
+			}
+		}
+
+		config settings;
+		truth ground_truth;
+		std::vector<std::uint8_t> image;
+		std::vector<std::uint8_t> misc;
+		std::vector<snapshot::region_entry> region_list; // sorted by base
+		std::uint32_t data_rva = 0;
+		std::uint64_t slots_per_region = 0;
+		std::uint64_t slot_count = 0;
+	};
+
+	// serves a target straight from the generator, nothing touches the disk
+	class source : public memory_source {
+	public:
+		explicit source( const config& wanted ) : generated(wanted) {}
+
+		auto read( std::uint64_t address, void* buffer, std::size_t size ) -> bool override {
+			return generated.fill(address, { static_cast<std::uint8_t*>(buffer), size });
+		}
+
+		auto query( std::uint64_t address, MEMORY_BASIC_INFORMATION& out ) -> bool override {
+			auto regions = generated.regions();
+			auto it = std::upper_bound(regions.begin(), regions.end(), address, [](std::uint64_t value, const snapshot::region_entry& region) { return value < region.base + region.size; });
+			if (it == regions.end())
+				return false;
+
+			out = {};
+			out.BaseAddress = reinterpret_cast<void*>(it->base);
+			out.AllocationBase = out.BaseAddress;
+			out.RegionSize = static_cast<SIZE_T>(it->size);
+			out.State = MEM_COMMIT;
+			out.Protect = it->protect;
+			out.Type = it->type;
+			return true;
+		}
+
+		auto modules( void ) -> std::vector<ME32> override {
+			std::vector<ME32> ret;
+			for (auto& module : generated.modules())
+				ret.push_back(make_module_entry(module.path, module.base, module.size));
+			return ret;
+		}
+
+		auto get_target( void ) const -> const target& {
+			return generated;
+		}
+
+	private:
+		target generated;
+	};
+
+	// the attached target's generator if it is one, good until the next attach or detach
+	inline auto attached_target( void ) -> const target* {
+		auto generated = dynamic_cast<const source*>(attached_source().get());
+		return generated ? &generated->get_target() : nullptr;
+	}
+
+	// as an .rbxs, streamed a chunk at a time so the size is only bounded by the disk
+	inline auto write( const std::filesystem::path& path, const target& generated ) -> bool {
+		return snapshot::write(path, image_base, 0, generated.modules(), generated.regions(), [&](const snapshot::region_entry& region, std::uint64_t offset, std::span<std::uint8_t> out) {
+			generated.fill(region.base + offset, out);
+		});
+	}
+}
@@ -0,0 +1,301 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <windows.h>
+
+// scoped begin/end events on a per-thread timeline, written out on demand as Chrome trace JSON or Perfetto
+// protobuf for ui.perfetto.dev / chrome://tracing. off by default: a scope then costs one relaxed load. while
+// recording, each thread appends to its own ring with a plain store and a release on the index, the oldest
+// events are overwritten when a thread outruns its ring
+namespace reblox::memory::timeline {
+	using clock = std::chrono::steady_clock;
+
+	inline const clock::time_point epoch = clock::now();
+
+	inline auto now_ns( void ) -> std::int64_t {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - epoch).count();
+	}
+
+	// names and categories are string literals, only the pointer is kept
+	struct event {
+		const char* category;
+		const char* name;
+		const char* arg_name; // null for none
+		std::uint64_t arg;
+		std::int64_t begin_ns;
+		std::int64_t end_ns;
+	};
+
+	struct thread_events {
+		std::uint32_t tid;
+		const char* name; // null if the thread never named itself
+		std::vector<event> events; // by begin, enclosing scopes before what they enclose
+	};
+
+	struct capture {
+		std::vector<thread_events> threads;
+		std::uint64_t dropped = 0; // overwritten before they were collected
+	};
+
+	class recorder {
+	public:
+		static constexpr std::size_t ring_capacity = 1 << 15;
+
+		// collect() returns what was recorded from here on
+		auto start( void ) -> void {
+			std::lock_guard guard(lock);
+			for (auto& entry : rings)
+				entry->start = entry->head.load(std::memory_order_acquire);
+			on.store(true, std::memory_order_release);
+		}
+
+		auto stop( void ) -> void {
+			on.store(false, std::memory_order_release);
+		}
+
+		auto recording( void ) const -> bool {
+			return on.load(std::memory_order_relaxed);
+		}
+
+		auto emit( const event& entry ) -> void {
+			ring& mine = local();
+			std::uint64_t head = mine.head.load(std::memory_order_relaxed);
+			mine.events[head & (ring_capacity - 1)] = entry;
+			mine.head.store(head + 1, std::memory_order_release);
+		}
+
+		// shows up as the thread's track name. call before the thread's first event
+		auto name_thread( const char* name ) -> void {
+			thread_name() = name;
+		}
+
+		// everything since the last start(), safe while threads keep recording. a slot being overwritten while
+		// it's copied is detected from the head moving past it and counted as dropped
+		auto collect( void ) -> capture {
+			capture ret;
+			std::lock_guard guard(lock);
+			for (auto& entry : rings) {
+				std::uint64_t head = entry->head.load(std::memory_order_acquire);
+				std::uint64_t first = (std::max)(entry->start, head > ring_capacity ? head - ring_capacity : 0);
+				std::vector<event> copied;
+				copied.reserve(static_cast<std::size_t>(head - first));
+				for (std::uint64_t i = first; i < head; i++)
+					copied.push_back(entry->events[i & (ring_capacity - 1)]);
+
+				std::uint64_t moved = entry->head.load(std::memory_order_acquire);
+				std::uint64_t valid = (std::max)(first, moved > ring_capacity ? moved - ring_capacity : 0);
+				ret.dropped += valid - entry->start;
+				if (valid >= head)
+					continue;
+
+				thread_events thread{ entry->tid, entry->name, { copied.begin() + static_cast<std::ptrdiff_t>(valid - first), copied.end() } };
+				std::sort(thread.events.begin(), thread.events.end(), [](const event& a, const event& b) { return a.begin_ns != b.begin_ns ? a.begin_ns < b.begin_ns : a.end_ns > b.end_ns; });
+				ret.threads.push_back(std::move(thread));
+			}
+			return ret;
+		}
+
+	private:
+		struct ring {
+			std::uint32_t tid;
+			const char* name;
+			std::atomic<std::uint64_t> head{ 0 };
+			std::uint64_t start = 0; // head at the last start(), collect() skips what came before
+			std::unique_ptr<event[]> events = std::make_unique<event[]>(ring_capacity);
+		};
+
+		static auto thread_name( void ) -> const char*& {
+			thread_local const char* name = nullptr;
+			return name;
+		}
+
+		// rings outlive their threads, like the stats shards. a thread gets one on its first event
+		auto local( void ) -> ring& {
+			thread_local ring* mine = [this] {
+				auto created = std::make_unique<ring>();
+				created->tid = static_cast<std::uint32_t>(GetCurrentThreadId());
+				created->name = thread_name();
+				std::lock_guard guard(lock);
+				return rings.emplace_back(std::move(created)).get();
+			}();
+			return *mine;
+		}
+
+		std::atomic<bool> on{ false };
+		std::mutex lock;
+		std::vector<std::unique_ptr<ring>> rings;
+	};
+
+	inline recorder engine;
+
+	class scope {
+	public:
+		scope( const char* category, const char* name, const char* arg_name = nullptr, std::uint64_t arg = 0 )
+			: entry{ category, name, arg_name, arg, engine.recording() ? now_ns() : -1, 0 } {}
+
+		~scope( void ) {
+			if (entry.begin_ns < 0)
+				return;
+			entry.end_ns = now_ns();
+			engine.emit(entry);
+		}
+
+		// for what's only known once the work is done, a hit count
+		auto set_arg( const char* name, std::uint64_t value ) -> void {
+			entry.arg_name = name;
+			entry.arg = value;
+		}
+
+		scope( const scope& ) = delete;
+		scope& operator=( const scope& ) = delete;
+
+	private:
+		event entry;
+	};
+
+	// {"traceEvents":[...]} with one complete ("X") event per scope, microseconds
+	inline auto write_chrome( const capture& events, const std::filesystem::path& path ) -> bool {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		const unsigned long pid = GetCurrentProcessId();
+		char buf[512];
+		std::snprintf(buf, sizeof(buf), "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%lu,\"args\":{\"name\":\"REBlox\"}}", pid);
+		file << buf;
+
+		for (auto& thread : events.threads) {
+			if (thread.name) {
+				std::snprintf(buf, sizeof(buf), ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%lu,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", pid, thread.tid, thread.name);
+				file << buf;
+			}
+
+			for (auto& entry : thread.events) {
+				int length = std::snprintf(buf, sizeof(buf), ",\n{\"ph\":\"X\",\"cat\":\"%s\",\"name\":\"%s\",\"pid\":%lu,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", entry.category, entry.name, pid, thread.tid, entry.begin_ns / 1e3, (entry.end_ns - entry.begin_ns) / 1e3);
+				if (entry.arg_name)
+					std::snprintf(buf + length, sizeof(buf) - length, ",\"args\":{\"%s\":%llu}}", entry.arg_name, static_cast<unsigned long long>(entry.arg));
+				else
+					std::snprintf(buf + length, sizeof(buf) - length, "}");
+				file << buf;
+			}
+		}
+
+		file << "\n]}\n";
+		return static_cast<bool>(file.flush());
+	}
+
+	// just enough of the protobuf wire format for perfetto's Trace / TracePacket / TrackEvent messages
+	class proto {
+	public:
+		auto varint( std::uint64_t value ) -> proto& {
+			while (value >= 0x80) {
+				bytes.push_back(static_cast<char>(value | 0x80));
+				value >>= 7;
+			}
+			bytes.push_back(static_cast<char>(value));
+			return *this;
+		}
+
+		auto number( std::uint32_t field, std::uint64_t value ) -> proto& {
+			return varint(field << 3).varint(value);
+		}
+
+		auto text( std::uint32_t field, std::string_view value ) -> proto& {
+			varint(field << 3 | 2).varint(value.size());
+			bytes.append(value);
+			return *this;
+		}
+
+		auto message( std::uint32_t field, const proto& nested ) -> proto& {
+			return text(field, nested.bytes);
+		}
+
+		std::string bytes;
+	};
+
+	// a perfetto trace: a process track, a thread track per thread and a SLICE_BEGIN / SLICE_END pair per
+	// scope. the pairs have to nest on a track, so they're replayed through a stack of open scopes
+	inline auto write_perfetto( const capture& events, const std::filesystem::path& path ) -> bool {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		// Trace.packet = 1, TracePacket.trusted_packet_sequence_id = 10
+		constexpr std::uint32_t sequence = 1;
+		auto packet = [&](proto& body) {
+			body.number(10, sequence);
+			file << proto().message(1, body).bytes;
+		};
+
+		const std::uint64_t pid = GetCurrentProcessId();
+		const std::uint64_t process_uuid = 1;
+		{
+			proto descriptor; // TrackDescriptor.uuid = 1, .process = 3 { pid = 1, process_name = 6 }
+			descriptor.number(1, process_uuid).message(3, proto().number(1, pid).text(6, "REBlox"));
+			proto body; // TracePacket.track_descriptor = 60
+			body.message(60, descriptor);
+			packet(body);
+		}
+
+		for (auto& thread : events.threads) {
+			const std::uint64_t uuid = 0x100000000ull | thread.tid;
+			{
+				proto described; // ThreadDescriptor.pid = 1, .tid = 2, .thread_name = 5
+				described.number(1, pid).number(2, thread.tid);
+				if (thread.name)
+					described.text(5, thread.name);
+				proto descriptor; // TrackDescriptor.uuid = 1, .parent_uuid = 5, .thread = 4
+				descriptor.number(1, uuid).number(5, process_uuid).message(4, described);
+				proto body;
+				body.message(60, descriptor);
+				packet(body);
+			}
+
+			// TracePacket.timestamp = 8, .track_event = 11 { type = 9, track_uuid = 11, categories = 22, name = 23,
+			// debug_annotations = 4 { name = 10, uint_value = 3 } }
+			auto slice = [&](std::int64_t time, const event* begin) {
+				proto track_event;
+				track_event.number(9, begin ? 1 : 2).number(11, uuid);
+				if (begin) {
+					track_event.text(22, begin->category).text(23, begin->name);
+					if (begin->arg_name)
+						track_event.message(4, proto().text(10, begin->arg_name).number(3, begin->arg));
+				}
+				proto body;
+				body.number(8, static_cast<std::uint64_t>(time)).message(11, track_event);
+				packet(body);
+			};
+
+			std::vector<std::int64_t> open; // end times of the enclosing scopes
+			for (auto& entry : thread.events) {
+				while (!open.empty() && open.back() <= entry.begin_ns) {
+					slice(open.back(), nullptr);
+					open.pop_back();
+				}
+				slice(entry.begin_ns, &entry);
+				open.push_back(open.empty() ? entry.end_ns : (std::min)(entry.end_ns, open.back()));
+			}
+			while (!open.empty()) {
+				slice(open.back(), nullptr);
+				open.pop_back();
+			}
+		}
+
+		return static_cast<bool>(file.flush());
+	}
+
+	// .json is Chrome trace JSON, anything else a perfetto protobuf trace
+	inline auto write( const capture& events, const std::filesystem::path& path ) -> bool {
+		return path.extension() == ".json" ? write_chrome(events, path) : write_perfetto(events, path);
+	}
+}
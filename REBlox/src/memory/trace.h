@@ -0,0 +1,575 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <bit>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include "memory.h"
+#include "sources.h"
+#include "attach.h"
+
+namespace reblox::memory {
+	// session traces, .rbxt: the snapshot header and tables (no region bytes), then one record per read in the
+	// order they happened. a record is varints for the time since the previous one, the address as a signed
+	// delta from the previous one, the size and the latency, then a flags byte and the bytes themselves unless
+	// the read failed or returned exactly what the last read of the same address and size did. live views
+	// re-reading unchanged memory every frame cost a few bytes per read that way
+	namespace trace {
+		inline constexpr std::uint32_t magic = 0x54584252; // "RBXT"
+		inline constexpr std::uint32_t version = 1;
+		inline constexpr std::size_t flush_size = 0x100000;
+
+		enum record_flags : std::uint8_t {
+			ok = 1,
+			unchanged = 2,
+		};
+
+		inline auto put_varint( std::vector<std::uint8_t>& out, std::uint64_t value ) -> void {
+			while (value >= 0x80) {
+				out.push_back(static_cast<std::uint8_t>(value) | 0x80);
+				value >>= 7;
+			}
+			out.push_back(static_cast<std::uint8_t>(value));
+		}
+
+		inline auto get_varint( const std::uint8_t*& at, const std::uint8_t* end, std::uint64_t& value ) -> bool {
+			value = 0;
+			for (int shift = 0; at < end && shift < 64; shift += 7) {
+				std::uint8_t byte = *at++;
+				value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+				if (!(byte & 0x80))
+					return true;
+			}
+			return false;
+		}
+
+		// 8 bytes at a time, only ever compared against itself for the same address and size
+		inline auto hash_bytes( const std::uint8_t* data, std::size_t size ) -> std::uint64_t {
+			std::uint64_t h = 0xCBF29CE484222325 ^ size;
+			std::size_t i = 0;
+			for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+				std::uint64_t word;
+				std::memcpy(&word, data + i, sizeof(word));
+				h = (std::rotl(h, 29) ^ word) * 0x100000001B3;
+			}
+			for (; i < size; i++)
+				h = (h ^ data[i]) * 0x100000001B3;
+			return h ^ (h >> 32);
+		}
+
+		struct read_key {
+			std::uint64_t address;
+			std::uint64_t size;
+
+			auto operator==( const read_key& ) const -> bool = default;
+		};
+
+		struct read_key_hash {
+			auto operator()( const read_key& key ) const -> std::size_t {
+				return std::hash<std::uint64_t>()(key.address * 0x9E3779B97F4A7C15 ^ key.size);
+			}
+		};
+
+		// what a recording holds, worked out once when it's opened
+		struct summary {
+			std::uint64_t reads;
+			std::uint64_t failed;
+			std::uint64_t bytes; // returned by the successful reads
+			std::uint64_t unchanged; // reads that got the same bytes as the last read of the same address and size
+			std::uint64_t repeats; // reads of an address and size that had been read before, what a cache could absorb
+			std::uint64_t pages; // distinct pages touched
+			std::uint64_t duration_ns;
+			std::uint64_t p50_ns;
+			std::uint64_t p90_ns;
+			std::uint64_t p99_ns;
+			double fixed_ns; // latency ~ fixed_ns + per_byte_ns * size, least squares over the successful reads
+			double per_byte_ns;
+		};
+	}
+
+	// the live process as a source, so a recorder can sit in front of it. borrows the handle, state owns it
+	class process_source : public memory_source {
+	public:
+		process_source( std::shared_ptr<process_handle> proc, std::int32_t pid ) : proc(std::move(proc)), pid(pid) {}
+
+		auto read( std::uint64_t address, void* buffer, std::size_t size ) -> bool override {
+			SIZE_T bytes_read = 0;
+			return ReadProcessMemory(proc->get(), reinterpret_cast<LPCVOID>(address), buffer, size, &bytes_read) && bytes_read == size;
+		}
+
+		auto query( std::uint64_t address, MEMORY_BASIC_INFORMATION& out ) -> bool override {
+			return VirtualQueryEx(proc->get(), reinterpret_cast<LPCVOID>(address), &out, sizeof(out)) == sizeof(out);
+		}
+
+		auto modules( void ) -> std::vector<ME32> override {
+			return get_modules(pid);
+		}
+
+	private:
+		std::shared_ptr<process_handle> proc; // shared with state.proc, writes go through that
+		std::int32_t pid;
+	};
+
+	// passes everything through to another source and logs every read. the module list and region layout are
+	// written up front so a replay can attach off the trace alone; queries aren't logged, a replay answers them
+	// from that table. reads can come from any thread, appends are serialized and flushed a megabyte at a time
+	class recording_source : public memory_source {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		// null if inner is null or the file can't be written
+		static auto create( std::unique_ptr<memory_source> inner, const std::filesystem::path& path, std::uint32_t pid = 0 ) -> std::unique_ptr<recording_source> {
+			if (!inner)
+				return nullptr;
+
+			std::unique_ptr<recording_source> ret(new recording_source(std::move(inner), path));
+			if (!ret->begin(pid))
+				return nullptr;
+			return ret;
+		}
+
+		~recording_source( void ) override {
+			std::lock_guard lock(mutex);
+			flush();
+		}
+
+		auto read( std::uint64_t address, void* buffer, std::size_t size ) -> bool override {
+			auto begin = clock::now();
+			bool ok = inner->read(address, buffer, size);
+			auto end = clock::now();
+
+			std::uint64_t hash = ok ? trace::hash_bytes(static_cast<const std::uint8_t*>(buffer), size) : 0;
+
+			std::lock_guard lock(mutex);
+			std::uint64_t time = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(begin - started).count());
+			time = (std::max)(time, last_time); // appends race a little with the clock reads
+
+			std::uint8_t flags = 0;
+			if (ok) {
+				flags |= trace::ok;
+				auto [it, inserted] = last_hashes.try_emplace({ address, size }, hash);
+				if (!inserted && it->second == hash)
+					flags |= trace::unchanged;
+				it->second = hash;
+			}
+
+			trace::put_varint(pending, time - last_time);
+			std::int64_t delta = static_cast<std::int64_t>(address - last_address);
+			trace::put_varint(pending, (static_cast<std::uint64_t>(delta) << 1) ^ static_cast<std::uint64_t>(delta >> 63)); // zigzag
+			trace::put_varint(pending, size);
+			trace::put_varint(pending, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+			pending.push_back(flags);
+			if (flags == trace::ok)
+				pending.insert(pending.end(), static_cast<const std::uint8_t*>(buffer), static_cast<const std::uint8_t*>(buffer) + size);
+
+			last_time = time;
+			last_address = address;
+			recorded++;
+			if (pending.size() >= trace::flush_size)
+				flush();
+			return ok;
+		}
+
+		auto query( std::uint64_t address, MEMORY_BASIC_INFORMATION& out ) -> bool override {
+			return inner->query(address, out);
+		}
+
+		auto modules( void ) -> std::vector<ME32> override {
+			return inner->modules();
+		}
+
+		auto get_recorded( void ) const -> std::uint64_t {
+			return recorded;
+		}
+
+		auto get_path( void ) const -> const std::filesystem::path& {
+			return path;
+		}
+
+	private:
+		recording_source( std::unique_ptr<memory_source> inner, const std::filesystem::path& path ) : inner(std::move(inner)), path(path) {}
+
+		auto begin( std::uint32_t pid ) -> bool {
+			file.open(path, std::ios::binary | std::ios::trunc);
+			if (!file)
+				return false;
+
+			auto entries = inner->modules();
+			std::vector<snapshot::region_record> region_list;
+			MEMORY_BASIC_INFORMATION mbi{};
+			std::uint64_t address = 0;
+			while (inner->query(address, mbi)) {
+				std::uint64_t base = reinterpret_cast<std::uint64_t>(mbi.BaseAddress);
+				if (mbi.State == MEM_COMMIT)
+					region_list.push_back({ base, mbi.RegionSize, static_cast<std::uint32_t>(mbi.Protect), static_cast<std::uint32_t>(mbi.Type), 0 });
+
+				if (base + mbi.RegionSize <= address)
+					break;
+				address = base + mbi.RegionSize;
+			}
+
+			std::uint64_t process_base = entries.empty() ? 0 : reinterpret_cast<std::uint64_t>(entries.front().modBaseAddr);
+			snapshot::file_header header{ trace::magic, trace::version, process_base, pid, static_cast<std::uint32_t>(entries.size()), static_cast<std::uint32_t>(region_list.size()), 0 };
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+			for (auto& entry : entries) {
+				std::wstring_view module_path(entry.szExePath);
+				std::vector<std::uint16_t> units(module_path.begin(), module_path.end());
+				snapshot::module_record record{ reinterpret_cast<std::uint64_t>(entry.modBaseAddr), static_cast<std::uint32_t>(entry.modBaseSize), static_cast<std::uint32_t>(units.size()) };
+				file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+				file.write(reinterpret_cast<const char*>(units.data()), units.size() * sizeof(std::uint16_t));
+			}
+			file.write(reinterpret_cast<const char*>(region_list.data()), region_list.size() * sizeof(snapshot::region_record));
+
+			started = clock::now();
+			return file.good();
+		}
+
+		auto flush( void ) -> void {
+			file.write(reinterpret_cast<const char*>(pending.data()), static_cast<std::streamsize>(pending.size()));
+			file.flush();
+			pending.clear();
+		}
+
+		std::unique_ptr<memory_source> inner;
+		std::filesystem::path path;
+		std::ofstream file;
+		std::mutex mutex;
+		std::vector<std::uint8_t> pending;
+		std::unordered_map<trace::read_key, std::uint64_t, trace::read_key_hash> last_hashes;
+		clock::time_point started;
+		std::uint64_t last_time = 0;
+		std::uint64_t last_address = 0;
+		std::atomic<std::uint64_t> recorded{ 0 };
+	};
+
+	// serves a recording back. every page keeps one version per distinct content it was seen with, tagged
+	// with the index of the read that saw it. replay keeps its own read counter, and a read gets each page as
+	// it was at that point of the recording (or the first version, if the recording only saw the page later),
+	// so a single threaded replay of the same workload is exact, and a changed engine that reads in a
+	// different shape still gets the bytes the target had. every version knows which of its bytes were
+	// actually read; a read that wants any byte the recording never saw fails, it doesn't get zeros
+	class replay_source : public memory_source {
+	public:
+		struct counters {
+			std::uint64_t reads;
+			std::uint64_t bytes;
+			std::uint64_t misses; // reads that wanted bytes the recording never saw
+		};
+
+		// latency replays each read's modeled cost from the recording (fixed + per byte) as a busy wait,
+		// so wall clock numbers stay comparable to the session. null if the file isn't a trace
+		static auto open( const std::filesystem::path& path, bool latency = false ) -> std::unique_ptr<replay_source> {
+			std::unique_ptr<replay_source> ret(new replay_source(path, latency));
+			if (!ret->load())
+				return nullptr;
+			return ret;
+		}
+
+		auto read( std::uint64_t address, void* buffer, std::size_t size ) -> bool override {
+			std::uint64_t at = cursor.fetch_add(1, std::memory_order_relaxed);
+			reads.fetch_add(1, std::memory_order_relaxed);
+
+			auto out = static_cast<std::uint8_t*>(buffer);
+			std::uint64_t page = address & ~static_cast<std::uint64_t>(page_size - 1);
+			for (std::size_t done = 0; done < size;) {
+				auto it = pages.find(page);
+				if (it == pages.end()) {
+					misses.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+
+				std::size_t offset = static_cast<std::size_t>(address + done - page);
+				std::size_t chunk = (std::min)(page_size - offset, size - done);
+
+				// the version current at this read, or failing that the first later one that has the bytes
+				auto& versions = it->second;
+				auto version = std::upper_bound(versions.begin(), versions.end(), at, [](std::uint64_t value, const page_version& entry) { return value < entry.index; });
+				if (version != versions.begin())
+					--version;
+				while (version != versions.end() && !covers(version->slot, offset, chunk))
+					++version;
+				if (version == versions.end()) {
+					misses.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+
+				std::memcpy(out + done, pool.data() + version->slot * page_size + offset, chunk);
+				done += chunk;
+				page += page_size;
+			}
+
+			bytes.fetch_add(size, std::memory_order_relaxed);
+			if (latency) {
+				auto until = std::chrono::steady_clock::now() + std::chrono::nanoseconds(static_cast<std::int64_t>(info.fixed_ns + info.per_byte_ns * size));
+				while (std::chrono::steady_clock::now() < until)
+					_mm_pause();
+			}
+			return true;
+		}
+
+		auto query( std::uint64_t address, MEMORY_BASIC_INFORMATION& out ) -> bool override {
+			auto it = std::upper_bound(regions.begin(), regions.end(), address, [](std::uint64_t value, const snapshot::region_record& region) { return value < region.base + region.size; });
+			if (it == regions.end())
+				return false;
+
+			out = {};
+			out.BaseAddress = reinterpret_cast<void*>(it->base);
+			out.AllocationBase = out.BaseAddress;
+			out.RegionSize = static_cast<SIZE_T>(it->size);
+			out.State = MEM_COMMIT;
+			out.Protect = it->protect;
+			out.Type = it->type;
+			return true;
+		}
+
+		auto modules( void ) -> std::vector<ME32> override {
+			return module_list;
+		}
+
+		auto get_summary( void ) const -> const trace::summary& {
+			return info;
+		}
+
+		auto get_counters( void ) const -> counters {
+			return { reads.load(), bytes.load(), misses.load() };
+		}
+
+		auto get_header( void ) const -> const snapshot::file_header& {
+			return header;
+		}
+
+	private:
+		struct page_version {
+			std::uint64_t index; // of the read that first saw this content
+			std::uint64_t slot; // into pool, in pages
+		};
+
+		replay_source( const std::filesystem::path& path, bool latency ) : file(path), latency(latency) {}
+
+		auto load( void ) -> bool {
+			const std::uint8_t* raw = file.at(0, sizeof(header));
+			if (!raw)
+				return false;
+
+			std::memcpy(&header, raw, sizeof(header));
+			if (header.magic != trace::magic || header.version != trace::version)
+				return false;
+
+			std::uint64_t offset = sizeof(header);
+			for (std::uint32_t i = 0; i < header.module_count; i++) {
+				snapshot::module_record record;
+				if (!(raw = file.at(offset, sizeof(record))))
+					return false;
+				std::memcpy(&record, raw, sizeof(record));
+				offset += sizeof(record);
+
+				if (!(raw = file.at(offset, record.path_length * sizeof(std::uint16_t))))
+					return false;
+				std::wstring module_path(record.path_length, L'\0');
+				for (std::uint32_t c = 0; c < record.path_length; c++) {
+					std::uint16_t unit;
+					std::memcpy(&unit, raw + c * sizeof(unit), sizeof(unit));
+					module_path[c] = static_cast<wchar_t>(unit);
+				}
+				offset += record.path_length * sizeof(std::uint16_t);
+
+				module_list.push_back(make_module_entry(module_path, record.base, record.size));
+			}
+
+			if (!(raw = file.at(offset, static_cast<std::uint64_t>(header.region_count) * sizeof(snapshot::region_record))))
+				return false;
+			regions.resize(header.region_count);
+			std::memcpy(regions.data(), raw, regions.size() * sizeof(snapshot::region_record));
+			std::sort(regions.begin(), regions.end(), [](const auto& a, const auto& b) { return a.base < b.base; });
+			offset += regions.size() * sizeof(snapshot::region_record);
+
+			replay_records(file.data() + offset, file.data() + file.size());
+			return true;
+		}
+
+		// a trace cut short (the recorder was killed mid flush) just ends at the last whole record
+		auto replay_records( const std::uint8_t* at, const std::uint8_t* end ) -> void {
+			std::unordered_map<trace::read_key, const std::uint8_t*, trace::read_key_hash> last_bytes;
+			std::unordered_set<trace::read_key, trace::read_key_hash> seen;
+			std::vector<std::uint64_t> latencies;
+			double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+			std::uint64_t time = 0, address = 0;
+
+			info = {};
+			for (std::uint64_t index = 0; at < end; index++) {
+				std::uint64_t time_delta, zigzag, size, latency_ns;
+				if (!trace::get_varint(at, end, time_delta) || !trace::get_varint(at, end, zigzag) || !trace::get_varint(at, end, size) || !trace::get_varint(at, end, latency_ns) || at >= end)
+					break;
+				std::uint8_t flags = *at++;
+
+				time += time_delta;
+				address += static_cast<std::uint64_t>(static_cast<std::int64_t>(zigzag >> 1) ^ -static_cast<std::int64_t>(zigzag & 1));
+				trace::read_key key{ address, size };
+
+				const std::uint8_t* data = nullptr;
+				if (flags == trace::ok) {
+					if (size > static_cast<std::uint64_t>(end - at))
+						break;
+					data = at;
+					at += size;
+					last_bytes[key] = data;
+				}
+				else if (flags & trace::ok) {
+					auto it = last_bytes.find(key);
+					if (it == last_bytes.end())
+						break; // unchanged from a read that isn't there, the trace is corrupt
+					data = it->second;
+					info.unchanged++;
+				}
+
+				info.reads++;
+				info.repeats += !seen.insert(key).second;
+				info.duration_ns = time + latency_ns;
+				if (!data) {
+					info.failed++;
+					continue;
+				}
+
+				info.bytes += size;
+				latencies.push_back(latency_ns);
+				sum_x += static_cast<double>(size);
+				sum_y += static_cast<double>(latency_ns);
+				sum_xx += static_cast<double>(size) * static_cast<double>(size);
+				sum_xy += static_cast<double>(size) * static_cast<double>(latency_ns);
+
+				apply(index, address, data, static_cast<std::size_t>(size));
+			}
+
+			info.pages = pages.size();
+			if (!latencies.empty()) {
+				auto rank = [&](double q) {
+					auto nth = latencies.begin() + static_cast<std::ptrdiff_t>(q * (latencies.size() - 1));
+					std::nth_element(latencies.begin(), nth, latencies.end());
+					return *nth;
+				};
+				info.p50_ns = rank(0.5);
+				info.p90_ns = rank(0.9);
+				info.p99_ns = rank(0.99);
+
+				double n = static_cast<double>(latencies.size());
+				double variance = n * sum_xx - sum_x * sum_x;
+				info.per_byte_ns = variance > 0 ? (std::max)((n * sum_xy - sum_x * sum_y) / variance, 0.0) : 0;
+				info.fixed_ns = (std::max)((sum_y - info.per_byte_ns * sum_x) / n, 0.0);
+			}
+		}
+
+		static constexpr std::size_t mask_words = page_size / 64;
+
+		// a new version only where the bytes differ from what the page's latest one has seen. bytes it hasn't
+		// seen yet are filled into it, they don't make the page any different
+		auto apply( std::uint64_t index, std::uint64_t address, const std::uint8_t* data, std::size_t size ) -> void {
+			std::uint64_t page = address & ~static_cast<std::uint64_t>(page_size - 1);
+			for (std::size_t done = 0; done < size; page += page_size) {
+				std::size_t offset = static_cast<std::size_t>(address + done - page);
+				std::size_t chunk = (std::min)(page_size - offset, size - done);
+
+				auto& versions = pages[page];
+				if (versions.empty() || differs(versions.back().slot, offset, data + done, chunk)) {
+					std::uint64_t slot = pool.size() / page_size;
+					pool.resize(pool.size() + page_size);
+					seen.resize(seen.size() + mask_words);
+					if (!versions.empty()) {
+						std::memcpy(pool.data() + slot * page_size, pool.data() + versions.back().slot * page_size, page_size);
+						std::memcpy(seen.data() + slot * mask_words, seen.data() + versions.back().slot * mask_words, mask_words * sizeof(std::uint64_t));
+					}
+					versions.push_back({ index, slot });
+				}
+
+				std::uint64_t slot = versions.back().slot;
+				std::memcpy(pool.data() + slot * page_size + offset, data + done, chunk);
+				for_each_mask(offset, chunk, [&](std::size_t word, std::uint64_t want) { seen[slot * mask_words + word] |= want; });
+				done += chunk;
+			}
+		}
+
+		// fn(word, bits) over the words of a slot's mask that cover [offset, offset + size)
+		template <typename fn_t>
+		static auto for_each_mask( std::size_t offset, std::size_t size, fn_t fn ) -> void {
+			for (std::size_t i = offset; i < offset + size;) {
+				std::size_t bit = i % 64;
+				std::size_t bits = (std::min)(64 - bit, offset + size - i);
+				fn(i / 64, (bits == 64 ? ~0ull : ((1ull << bits) - 1)) << bit);
+				i += bits;
+			}
+		}
+
+		// any byte of the range the slot has seen with another value
+		auto differs( std::uint64_t slot, std::size_t offset, const std::uint8_t* data, std::size_t size ) const -> bool {
+			const std::uint8_t* have = pool.data() + slot * page_size;
+			if (covers(slot, offset, size))
+				return std::memcmp(have + offset, data, size) != 0;
+			for (std::size_t i = offset; i < offset + size; i++) {
+				if ((seen[slot * mask_words + i / 64] >> (i % 64) & 1) && have[i] != data[i - offset])
+					return true;
+			}
+			return false;
+		}
+
+		// every byte of the range seen by the slot
+		auto covers( std::uint64_t slot, std::size_t offset, std::size_t size ) const -> bool {
+			const std::uint64_t* mask = seen.data() + slot * mask_words;
+			bool all = true;
+			for_each_mask(offset, size, [&](std::size_t word, std::uint64_t want) { all &= (mask[word] & want) == want; });
+			return all;
+		}
+
+		mapped_file file;
+		bool latency;
+		snapshot::file_header header{};
+		std::vector<snapshot::region_record> regions; // sorted by base
+		std::vector<ME32> module_list;
+		std::unordered_map<std::uint64_t, std::vector<page_version>> pages; // by page address, versions by index
+		std::vector<std::uint8_t> pool;
+		std::vector<std::uint64_t> seen; // a bit per byte of pool, set where the recording read it
+		trace::summary info{};
+		std::atomic<std::uint64_t> cursor{ 0 };
+		std::atomic<std::uint64_t> reads{ 0 };
+		std::atomic<std::uint64_t> bytes{ 0 };
+		std::atomic<std::uint64_t> misses{ 0 };
+	};
+
+	// attach_to_process with every read going through a recorder. writes and the process details still go
+	// to the handle; modules aren't refreshed while recording, the trace's module table is fixed at the start
+	inline auto attach_to_process_recorded( std::int32_t pid, const std::filesystem::path& path ) -> bool {
+		detach_from_process();
+
+		HANDLE opened = open_process(pid);
+		if (opened == nullptr)
+			return false;
+
+		// the recorder holds the handle too, it's closed once both it and state.proc have let go
+		auto proc = std::make_shared<process_handle>(opened);
+		if (!attach_to_source(recording_source::create(std::make_unique<process_source>(proc, pid), path, static_cast<std::uint32_t>(pid)))) {
+			detach_from_process();
+			return false;
+		}
+
+		state.proc.store(std::move(proc), std::memory_order_release);
+		state.pid = pid;
+		return state.process_base != 0;
+	}
+
+	// the attached target's recorder / replay if it is one, good until the next attach or detach
+	inline auto attached_recorder( void ) -> const recording_source* {
+		return dynamic_cast<const recording_source*>(attached_source().get());
+	}
+
+	inline auto attached_replay( void ) -> const replay_source* {
+		return dynamic_cast<const replay_source*>(attached_source().get());
+	}
+}
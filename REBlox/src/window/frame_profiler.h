@@ -0,0 +1,170 @@
+#pragma once
+#include <cstdint>
+#include <cfloat>
+#include <chrono>
+#include <array>
+#include <algorithm>
+#include "../../thirdparty/imgui/imgui.h"
+
+namespace reblox::window {
+	// the parts of a frame worth telling apart. a section can be entered any number of times per frame (hex
+	// formatting is once per row), its time for the frame is the sum
+	enum struct section : std::uint32_t {
+		home_tab,
+		memory_tab,
+		memory_view_tab,
+		scan_tab,
+		process_picker,
+		diagnostics,
+		hex_format,
+		render, // ImGui_ImplDX11_RenderDrawData
+		count
+	};
+
+	inline constexpr const char* section_names[] = {
+		"Home tab", "Memory tab", "Memory View tab", "Scan tab", "Process picker", "Diagnostics", "Hex formatting", "RenderDrawData",
+	};
+
+	inline constexpr std::size_t section_count = static_cast<std::size_t>(section::count);
+	static_assert(std::size(section_names) == section_count);
+
+	// per section time over the last frames, the overlay's percentiles are over the frames a section ran in.
+	// UI thread only, no locking
+	class frame_profiler {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		static constexpr std::size_t history = 240; // four seconds at 60 fps when nothing's idle
+
+		struct summary {
+			std::size_t frames; // of the history the section ran in
+			double last_ms; // -1 if it didn't run last frame
+			double p50_ms;
+			double p95_ms;
+			double p99_ms;
+			double max_ms;
+		};
+
+		auto add( section which, clock::duration spent ) -> void {
+			current[static_cast<std::size_t>(which)] += spent;
+			ran[static_cast<std::size_t>(which)] = true;
+		}
+
+		// after the frame's last section, frame_ms is the whole frame's cpu time
+		auto end_frame( double frame_ms ) -> void {
+			for (std::size_t i = 0; i < section_count; i++) {
+				times[i][next] = ran[i] ? static_cast<float>(std::chrono::duration<double, std::milli>(current[i]).count()) : -1.0f;
+				current[i] = {};
+				ran[i] = false;
+			}
+			totals[next] = static_cast<float>(frame_ms);
+			next = (next + 1) % history;
+			filled = (std::min)(filled + 1, history);
+		}
+
+		auto get( section which ) const -> summary {
+			return summarize(times[static_cast<std::size_t>(which)]);
+		}
+
+		auto frame( void ) const -> summary {
+			return summarize(totals);
+		}
+
+		// a small always on top table in the main viewport's top right corner
+		auto draw_overlay( bool* open ) -> void {
+			const ImGuiViewport* viewport = ImGui::GetMainViewport();
+			ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + viewport->WorkSize.x - 10.0f, viewport->WorkPos.y + 10.0f), ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+			ImGui::SetNextWindowBgAlpha(0.75f);
+			constexpr ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoMove;
+			if (!ImGui::Begin("Frame profiler", open, flags)) {
+				ImGui::End();
+				return;
+			}
+
+			ImGui::Text("last %zu frames, ms", filled);
+			if (ImGui::BeginTable("sections", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+				static constexpr const char* columns[] = { "Section", "Last", "p50", "p95", "p99", "Max" };
+				for (auto column : columns)
+					ImGui::TableSetupColumn(column);
+				ImGui::TableHeadersRow();
+
+				draw_row("Frame", frame());
+				for (std::size_t i = 0; i < section_count; i++) {
+					auto entry = get(static_cast<section>(i));
+					if (entry.frames)
+						draw_row(section_names[i], entry);
+				}
+				ImGui::EndTable();
+			}
+
+			// oldest to newest
+			std::array<float, history> ordered{};
+			for (std::size_t i = 0; i < filled; i++)
+				ordered[i] = totals[(next + history - filled + i) % history];
+			ImGui::PlotLines("##frames", ordered.data(), static_cast<int>(filled), 0, nullptr, 0.0f, FLT_MAX, ImVec2(300.0f, 40.0f));
+
+			ImGui::End();
+		}
+
+	private:
+		auto summarize( const std::array<float, history>& values ) const -> summary {
+			std::array<float, history> sorted;
+			std::size_t count = 0;
+			for (std::size_t i = 0; i < filled; i++) {
+				if (values[i] >= 0.0f)
+					sorted[count++] = values[i];
+			}
+
+			summary ret{ count, filled ? values[(next + history - 1) % history] : -1.0, 0.0, 0.0, 0.0, 0.0 };
+			if (!count)
+				return ret;
+
+			std::sort(sorted.begin(), sorted.begin() + count);
+			auto rank = [&](double q) { return static_cast<double>(sorted[(std::min)(count - 1, static_cast<std::size_t>(q * count))]); };
+			ret.p50_ms = rank(0.50);
+			ret.p95_ms = rank(0.95);
+			ret.p99_ms = rank(0.99);
+			ret.max_ms = sorted[count - 1];
+			return ret;
+		}
+
+		static auto draw_row( const char* name, const summary& entry ) -> void {
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(name);
+			ImGui::TableNextColumn();
+			if (entry.last_ms >= 0.0)
+				ImGui::Text("%.2f", entry.last_ms);
+			else
+				ImGui::TextDisabled("-");
+			for (double value : { entry.p50_ms, entry.p95_ms, entry.p99_ms, entry.max_ms }) {
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", value);
+			}
+		}
+
+		std::array<clock::duration, section_count> current{};
+		std::array<bool, section_count> ran{};
+		std::array<std::array<float, history>, section_count> times{};
+		std::array<float, history> totals{};
+		std::size_t next = 0;
+		std::size_t filled = 0;
+	};
+
+	inline frame_profiler profiler;
+
+	class profile_scope {
+	public:
+		explicit profile_scope( section which ) : which(which), started(frame_profiler::clock::now()) {}
+
+		~profile_scope( void ) {
+			profiler.add(which, frame_profiler::clock::now() - started);
+		}
+
+		profile_scope( const profile_scope& ) = delete;
+		profile_scope& operator=( const profile_scope& ) = delete;
+
+	private:
+		section which;
+		frame_profiler::clock::time_point started;
+	};
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include <windows.h>
+#include <cstdint>
+#include <chrono>
+#include <algorithm>
+#include "../../thirdparty/imgui/imgui.h"
+
+namespace reblox::window {
+	struct frame_stats {
+		double last_ms; // cpu side of the last frame, wake to present
+		double average_ms; // moving average of the same
+		double worst_ms; // over the last second
+		double budget_ms;
+		std::uint64_t frames; // drawn so far
+		std::uint64_t over_budget; // frames that took longer than the budget
+		double idle; // fraction of the last second spent asleep
+	};
+
+	// decides when the next frame gets drawn instead of spinning at vsync. wait() sleeps in
+	// MsgWaitForMultipleObjectsEx until window input, the wake event (set when a read or a process detail
+	// fetch completes) or the nearest deadline. deadlines come from views: wake_at() for their own timers, live()
+	// for anything showing target memory, which then gets redrawn at least every min_refresh
+	class frame_scheduler {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		static constexpr int settle_frames = 3; // imgui needs a couple of frames after input for hover and layout
+		static constexpr std::chrono::milliseconds caret_blink{ 530 };
+
+		frame_scheduler( void ) {
+			wake_event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+		}
+
+		~frame_scheduler( void ) {
+			if (wake_event)
+				CloseHandle(wake_event);
+		}
+
+		frame_scheduler( const frame_scheduler& ) = delete;
+		frame_scheduler& operator=( const frame_scheduler& ) = delete;
+
+		// auto-reset event, anything that wants a frame from another thread can set it
+		auto get_wake_event( void ) const -> HANDLE {
+			return wake_event;
+		}
+
+		// blocks until a frame is due. messages are left in the queue for the caller to pump
+		auto wait( void ) -> void {
+			auto now = clock::now();
+			if (!frames_due) {
+				auto next = next_deadline();
+				DWORD timeout = INFINITE;
+				if (next != clock::time_point::max()) {
+					auto left = std::chrono::ceil<std::chrono::milliseconds>(next - now).count();
+					timeout = static_cast<DWORD>(std::clamp<long long>(left, 0, INFINITE - 1));
+				}
+
+				DWORD woke = timeout ? MsgWaitForMultipleObjectsEx(1, &wake_event, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE) : WAIT_TIMEOUT;
+				frames_due = woke == WAIT_OBJECT_0 + 1 ? settle_frames : 1;
+
+				auto woken = clock::now();
+				slept += woken - now;
+				now = woken;
+			}
+
+			frames_due--;
+			frame_start = now;
+			deadline = clock::time_point::max();
+			live_views = false;
+		}
+
+		// call once the frame's cpu work is done, right before Present
+		auto end_frame( void ) -> void {
+			auto now = clock::now();
+			double ms = std::chrono::duration<double, std::milli>(now - frame_start).count();
+
+			stats.last_ms = ms;
+			stats.average_ms = stats.frames ? stats.average_ms + (ms - stats.average_ms) * 0.05 : ms;
+			stats.frames++;
+			stats.over_budget += ms > stats.budget_ms;
+			window_worst = (std::max)(window_worst, ms);
+
+			// the worst and idle numbers roll over once a second so they describe what's happening now
+			if (now - window_start >= std::chrono::seconds(1)) {
+				stats.worst_ms = window_worst;
+				stats.idle = std::chrono::duration<double>(slept).count() / std::chrono::duration<double>(now - window_start).count();
+				window_worst = 0.0;
+				slept = {};
+				window_start = now;
+			}
+
+			last_frame = now;
+			if (ImGui::GetIO().WantTextInput)
+				wake_in(caret_blink);
+		}
+
+		// another frame right after this one, e.g. something changed while drawing
+		auto request_frame( void ) -> void {
+			frames_due = (std::max)(frames_due, 1);
+		}
+
+		auto wake_at( clock::time_point when ) -> void {
+			deadline = (std::min)(deadline, when);
+		}
+
+		auto wake_in( clock::duration delay ) -> void {
+			wake_at(clock::now() + delay);
+		}
+
+		// this frame shows live target memory, keep redrawing it at min_refresh
+		auto live( void ) -> void {
+			live_views = true;
+		}
+
+		// 0 only redraws live views on input, completed reads and their own timers
+		auto set_min_refresh( std::chrono::milliseconds interval ) -> void {
+			min_refresh = interval;
+		}
+
+		auto get_min_refresh( void ) const -> std::chrono::milliseconds {
+			return min_refresh;
+		}
+
+		auto set_budget( double ms ) -> void {
+			stats.budget_ms = ms;
+		}
+
+		auto get_stats( void ) const -> const frame_stats& {
+			return stats;
+		}
+
+	private:
+		auto next_deadline( void ) const -> clock::time_point {
+			auto next = deadline;
+			if (live_views && min_refresh.count())
+				next = (std::min)(next, last_frame + min_refresh);
+			return next;
+		}
+
+		HANDLE wake_event = nullptr;
+		int frames_due = settle_frames;
+		bool live_views = false;
+		std::chrono::milliseconds min_refresh{ 1000 };
+		clock::time_point deadline = clock::time_point::max(); // set during the frame, for the wait after it
+		clock::time_point frame_start{};
+		clock::time_point last_frame{};
+		clock::time_point window_start = clock::now();
+		clock::duration slept{};
+		double window_worst = 0.0;
+		frame_stats stats{ 0.0, 0.0, 0.0, 1000.0 / 60.0, 0, 0, 0.0 };
+	};
+
+	inline frame_scheduler frames;
+}
@@ -0,0 +1,193 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <charconv>
+#include <algorithm>
+#include <utility>
+
+namespace reblox::gui {
+	enum struct column_type : std::uint8_t {
+		u8,
+		u16,
+		u32,
+		u64,
+		f32,
+		f64
+	};
+
+	struct row_format {
+		std::uint32_t bytes_per_row = 16;
+		std::uint32_t group = 8; // bytes between the extra gaps, 0 turns them off
+		column_type type = column_type::u8;
+	};
+
+	// "00" .. "FF" back to back, one lookup per byte instead of a format string
+	inline constexpr auto hex_pairs = [] {
+		constexpr char digits[] = "0123456789ABCDEF";
+		std::array<char, 512> table{};
+		for (int i = 0; i < 256; i++) {
+			table[i * 2] = digits[i >> 4];
+			table[i * 2 + 1] = digits[i & 15];
+		}
+		return table;
+	}();
+
+	inline constexpr auto ascii_glyphs = [] {
+		std::array<char, 256> table{};
+		for (int i = 0; i < 256; i++)
+			table[i] = i >= 32 && i <= 126 ? static_cast<char>(i) : '.';
+		return table;
+	}();
+
+	inline constexpr auto column_size( column_type type ) -> std::uint32_t {
+		switch (type) {
+		case column_type::u16: return 2;
+		case column_type::u32: case column_type::f32: return 4;
+		case column_type::u64: case column_type::f64: return 8;
+		default: return 1;
+		}
+	}
+
+	// characters a cell takes. floats get room for the longest shortest-round-trip form ("-1.17549435e-38")
+	inline constexpr auto column_width( column_type type ) -> std::uint32_t {
+		switch (type) {
+		case column_type::u16: return 4;
+		case column_type::u32: return 8;
+		case column_type::u64: return 16;
+		case column_type::f32: return 15;
+		case column_type::f64: return 24;
+		default: return 2;
+		}
+	}
+
+	// lays out a row once per format (where every cell and the ascii column start) and then renders rows by
+	// copying a blank template and dropping digits into place. a 16 byte row is one memcpy plus 16 table
+	// lookups, no format parsing and no strcat rescans
+	class row_formatter {
+	public:
+		static constexpr std::uint32_t max_bytes_per_row = 64;
+		static constexpr std::size_t max_width = 512;
+
+		row_formatter( void ) {
+			blank.fill(' ');
+			configure({});
+		}
+
+		auto configure( row_format next ) -> void {
+			std::uint32_t size = column_size(next.type);
+			next.bytes_per_row = std::clamp(next.bytes_per_row, size, max_bytes_per_row) / size * size;
+			next.group = next.group % size == 0 ? next.group : 0;
+			layout = next;
+
+			cell_width = column_width(next.type);
+			columns = next.bytes_per_row / size;
+
+			std::size_t at = 16 + 1; // address, gap
+			for (std::uint32_t i = 0; i < columns; i++) {
+				if (i && next.group && (i * size) % next.group == 0)
+					at++;
+				column_at[i] = static_cast<std::uint16_t>(at + 1);
+				at += 1 + cell_width;
+			}
+			ascii_at = at + 3;
+			row_width = ascii_at + next.bytes_per_row;
+		}
+
+		auto format( void ) const -> const row_format& {
+			return layout;
+		}
+
+		// character range [first, first + count) of the cell that shows byte, for drawing behind it
+		auto cell_span( std::uint32_t byte ) const -> std::pair<std::size_t, std::size_t> {
+			return { column_at[byte / column_size(layout.type)], cell_width };
+		}
+
+		auto ascii_column( void ) const -> std::size_t {
+			return ascii_at;
+		}
+
+		// characters in a row, out must have room for this many (never more than max_width)
+		auto width( void ) const -> std::size_t {
+			return row_width;
+		}
+
+		auto header( char* out ) const -> std::size_t {
+			std::memcpy(out, blank.data(), row_width);
+			std::memcpy(out, "Address", 7);
+
+			std::uint32_t size = column_size(layout.type);
+			for (std::uint32_t i = 0; i < columns; i++)
+				std::memcpy(out + column_at[i] + cell_width - 2, &hex_pairs[(i * size) * 2], 2);
+
+			std::memcpy(out + ascii_at, "ASCII", (std::min)(std::size_t(5), row_width - ascii_at));
+			return row_width;
+		}
+
+		auto row( char* out, std::uint64_t address, const std::uint8_t* bytes ) const -> std::size_t {
+			std::memcpy(out, blank.data(), row_width);
+			write_address(out, address);
+
+			std::uint32_t size = column_size(layout.type);
+			for (std::uint32_t i = 0; i < columns; i++)
+				write_cell(out + column_at[i], bytes + i * size);
+
+			char* glyphs = out + ascii_at;
+			for (std::uint32_t i = 0; i < layout.bytes_per_row; i++)
+				glyphs[i] = ascii_glyphs[bytes[i]];
+
+			return row_width;
+		}
+
+		// a row with no bytes behind it, cells filled with cell and the ascii column with glyph
+		auto placeholder( char* out, std::uint64_t address, char cell, char glyph ) const -> std::size_t {
+			std::memcpy(out, blank.data(), row_width);
+			write_address(out, address);
+
+			for (std::uint32_t i = 0; i < columns; i++)
+				std::memset(out + column_at[i] + cell_width - 2, cell, 2);
+
+			std::memset(out + ascii_at, glyph, layout.bytes_per_row);
+			return row_width;
+		}
+
+	private:
+		static auto write_address( char* out, std::uint64_t address ) -> void {
+			for (int i = 0; i < 8; i++)
+				std::memcpy(out + i * 2, &hex_pairs[((address >> (56 - i * 8)) & 0xFF) * 2], 2);
+		}
+
+		// little endian in memory, most significant byte printed first
+		static auto write_hex( char* out, const std::uint8_t* bytes, std::uint32_t size ) -> void {
+			for (std::uint32_t i = 0; i < size; i++)
+				std::memcpy(out + i * 2, &hex_pairs[bytes[size - 1 - i] * 2], 2);
+		}
+
+		template <typename t>
+		auto write_float( char* out, const std::uint8_t* bytes ) const -> void {
+			t value;
+			std::memcpy(&value, bytes, sizeof(t));
+
+			char text[32];
+			auto [end, ec] = std::to_chars(text, text + sizeof(text), value);
+			std::size_t length = (std::min)(static_cast<std::size_t>(end - text), static_cast<std::size_t>(cell_width));
+			std::memcpy(out + cell_width - length, text, length);
+		}
+
+		auto write_cell( char* out, const std::uint8_t* bytes ) const -> void {
+			switch (layout.type) {
+			case column_type::f32: write_float<float>(out, bytes); break;
+			case column_type::f64: write_float<double>(out, bytes); break;
+			default: write_hex(out, bytes, column_size(layout.type)); break;
+			}
+		}
+
+		row_format layout;
+		std::uint32_t columns = 0;
+		std::uint32_t cell_width = 0;
+		std::size_t ascii_at = 0;
+		std::size_t row_width = 0;
+		std::array<std::uint16_t, max_bytes_per_row> column_at{};
+		std::array<char, max_width> blank{};
+	};
+}
@@ -0,0 +1,385 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "../../../thirdparty/imgui/imgui.h"
+#include "../../memory/page_cache.h"
+#include "../../memory/pointers.h"
+#include "../frame_scheduler.h"
+#include "../frame_profiler.h"
+#include "hex_format.h"
+
+namespace reblox::gui {
+	// scrollable hex view over the whole user address space. the scrollbar only ever spans a window of
+	// window_rows rows (float scroll positions can't address 2^43 rows), which is re-based under the user
+	// when they get close to either end. rows are drawn from the page cache and never read memory directly;
+	// missing pages are requested for the screen, then a screen ahead and a screen behind the scroll direction.
+	// auto-refresh just invalidates the screen on a timer, so the refresh rate is independent of the frame rate;
+	// bytes that changed between refreshes are highlighted and fade out over the cache's fade setting. with
+	// pointers on, every aligned qword on screen is classified in one batch per clipper step and underlined
+	// (module, heap or vtable) with the module offset or RTTI type after the row
+	class hex_view {
+	public:
+		static constexpr std::uint64_t address_limit = 0x800000000000; // end of user space on x64
+		static constexpr std::uint64_t window_rows = 1 << 16;
+
+		auto go_to( std::uint64_t address ) -> void {
+			target = (std::min)(address, address_limit - 1);
+			jump = true;
+		}
+
+		// re-reads what's on screen, the old bytes stay up until the new ones land
+		auto refresh( void ) -> void {
+			memory::pages.invalidate(visible_begin, visible_end);
+		}
+
+		auto top_address( void ) const -> std::uint64_t {
+			return visible_begin;
+		}
+
+		// changes the row layout and keeps the same address at the top
+		auto set_format( const row_format& next ) -> void {
+			formatter.configure(next);
+			go_to(visible_begin);
+		}
+
+		auto draw_options( void ) -> void {
+			row_format next = formatter.format();
+			bool changed = false;
+
+			static constexpr std::uint32_t widths[] = { 8, 16, 32, 64 };
+			static constexpr std::uint32_t groups[] = { 0, 4, 8, 16 };
+			int width = static_cast<int>(std::find(std::begin(widths), std::end(widths), next.bytes_per_row) - std::begin(widths));
+			int group = static_cast<int>(std::find(std::begin(groups), std::end(groups), next.group) - std::begin(groups));
+			int type = static_cast<int>(next.type);
+
+			ImGui::SetNextItemWidth(60);
+			if (ImGui::Combo("Row", &width, "8\0" "16\0" "32\0" "64\0")) {
+				next.bytes_per_row = widths[width];
+				changed = true;
+			}
+			ImGui::SameLine();
+			ImGui::SetNextItemWidth(60);
+			if (ImGui::Combo("Group", &group, "none\0" "4\0" "8\0" "16\0")) {
+				next.group = groups[group];
+				changed = true;
+			}
+			ImGui::SameLine();
+			ImGui::SetNextItemWidth(80);
+			if (ImGui::Combo("Type", &type, "u8\0u16\0u32\0u64\0float\0double\0")) {
+				next.type = static_cast<column_type>(type);
+				changed = true;
+			}
+
+			if (changed)
+				set_format(next);
+
+			static constexpr int intervals[] = { 0, 100, 250, 500, 1000 };
+			int interval = static_cast<int>(std::find(std::begin(intervals), std::end(intervals), refresh_interval.count()) - std::begin(intervals));
+			int fade = memory::pages.get_fade();
+
+			ImGui::SameLine();
+			ImGui::SetNextItemWidth(80);
+			if (ImGui::Combo("Auto-refresh", &interval, "off\0" "100 ms\0" "250 ms\0" "500 ms\0" "1 s\0"))
+				refresh_interval = std::chrono::milliseconds(intervals[interval]);
+			ImGui::SameLine();
+			ImGui::SetNextItemWidth(80);
+			if (ImGui::SliderInt("Fade", &fade, 1, 32))
+				memory::pages.set_fade(static_cast<std::uint8_t>(fade));
+			ImGui::SameLine();
+			ImGui::Checkbox("Pointers", &show_pointers);
+		}
+
+		auto draw( void ) -> void {
+			auto now = std::chrono::steady_clock::now();
+			if (refresh_interval.count() && now - last_refresh >= refresh_interval) {
+				refresh();
+				last_refresh = now;
+			}
+
+			// the scheduler sleeps between frames, so ask for the next refresh tick and keep the view live
+			if (refresh_interval.count())
+				window::frames.wake_at(last_refresh + refresh_interval);
+			window::frames.live();
+
+			float row_height = ImGui::GetTextLineHeightWithSpacing();
+
+			std::uint64_t row_bytes = formatter.format().bytes_per_row;
+			std::uint64_t total_rows = address_limit / row_bytes;
+
+			if (jump) {
+				std::uint64_t row = target / row_bytes;
+				window_first = window_for(row, total_rows);
+				ImGui::SetNextWindowScroll(ImVec2(-1.0f, static_cast<float>(row - window_first) * row_height));
+				jump = false;
+			}
+			else if (row_height > 0.0f) {
+				// re-base once the previous frame ended up in the outer quarters of the window
+				std::uint64_t scroll_row = static_cast<std::uint64_t>(last_scroll / row_height);
+				bool near_top = scroll_row < window_rows / 4 && window_first > 0;
+				bool near_bottom = scroll_row > window_rows * 3 / 4 && window_first + window_rows < total_rows;
+				if (near_top || near_bottom) {
+					std::uint64_t rebased = window_for(window_first + scroll_row, total_rows);
+					double shift = static_cast<double>(static_cast<std::int64_t>(window_first - rebased)) * row_height;
+					ImGui::SetNextWindowScroll(ImVec2(-1.0f, static_cast<float>(last_scroll + shift)));
+					window_first = rebased;
+				}
+			}
+
+			char line[row_formatter::max_width];
+
+			ImGui::PushFont(ImGui::GetIO().Fonts->Fonts[0]);
+			ImGui::TextUnformatted(line, line + formatter.header(line));
+			ImGui::Separator();
+
+			ImGui::BeginChild("MemoryViewScroll", ImVec2(0, 0), true, ImGuiWindowFlags_HorizontalScrollbar);
+			char_width = ImGui::CalcTextSize("0").x;
+
+			int rows = static_cast<int>((std::min)(window_rows, total_rows - window_first));
+			int first_visible = rows;
+			int last_visible = 0;
+
+			ImGuiListClipper clipper;
+			clipper.Begin(rows, row_height);
+			while (clipper.Step()) {
+				first_visible = (std::min)(first_visible, clipper.DisplayStart);
+				last_visible = (std::max)(last_visible, clipper.DisplayEnd);
+
+				// load the whole step first so its qwords can be classified in one batch
+				screen.resize(clipper.DisplayEnd - clipper.DisplayStart);
+				qwords.clear();
+				for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+					row_data& data = screen[row - clipper.DisplayStart];
+					data.state = load_row((window_first + row) * row_bytes, data);
+					data.first_qword = static_cast<std::uint32_t>(qwords.size());
+					if (show_pointers && data.state == row_state::ready) {
+						for (std::size_t i = 0; i + 8 <= row_bytes; i += 8) {
+							std::uint64_t value;
+							std::memcpy(&value, data.bytes + i, sizeof(value));
+							qwords.push_back(value);
+						}
+					}
+				}
+				classes.resize(qwords.size());
+				memory::pointers.classify(qwords, classes);
+
+				// the export names of the step's module pointers, resolved in one sorted pass
+				targets.clear();
+				for (std::size_t i = 0; i < qwords.size(); i++) {
+					if (classes[i].kind == memory::pointer_kind::module)
+						targets.push_back(qwords[i]);
+				}
+				memory::symbols.prefetch(targets);
+
+				for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+					const row_data& data = screen[row - clipper.DisplayStart];
+					std::uint64_t address = (window_first + row) * row_bytes;
+					std::size_t length = 0;
+					{
+						window::profile_scope profiled(window::section::hex_format);
+						switch (data.state) {
+						case row_state::ready: length = formatter.row(line, address, data.bytes); break;
+						case row_state::pending: length = formatter.placeholder(line, address, '.', ' '); break;
+						case row_state::failed: length = formatter.placeholder(line, address, '?', '?'); break;
+						}
+					}
+
+					ImVec2 origin = ImGui::GetCursorScreenPos();
+					if (data.state == row_state::ready && data.hot)
+						draw_heat(origin, data);
+					ImGui::TextUnformatted(line, line + length);
+					if (show_pointers && data.state == row_state::ready)
+						draw_pointers(origin, data);
+				}
+			}
+
+			last_scroll = ImGui::GetScrollY();
+			ImGui::EndChild();
+			ImGui::PopFont();
+
+			if (first_visible < last_visible) {
+				visible_begin = (window_first + first_visible) * row_bytes;
+				visible_end = (window_first + last_visible) * row_bytes;
+			}
+
+			request_pages();
+		}
+
+	private:
+		// first row of a window that has row roughly in the middle
+		static auto window_for( std::uint64_t row, std::uint64_t total_rows ) -> std::uint64_t {
+			std::uint64_t first = row > window_rows / 2 ? row - window_rows / 2 : 0;
+			return (std::min)(first, total_rows - window_rows);
+		}
+
+		enum struct row_state {
+			ready,
+			pending, // a page is still being fetched
+			failed
+		};
+
+		struct row_data {
+			std::uint8_t bytes[row_formatter::max_bytes_per_row];
+			std::uint8_t heat[row_formatter::max_bytes_per_row];
+			bool hot; // anything in heat is non zero
+			row_state state;
+			std::uint32_t first_qword; // into qwords / classes
+		};
+
+		// copies the row at address out of the cache, stitched together if it runs into the next page (widths
+		// that don't divide the page size)
+		auto load_row( std::uint64_t address, row_data& row ) -> row_state {
+			std::size_t row_bytes = formatter.format().bytes_per_row;
+			row.hot = false;
+
+			for (std::size_t done = 0; done < row_bytes;) {
+				std::uint64_t at = address + done;
+				std::uint64_t page_address = memory::page_cache::page_of(at);
+				std::size_t offset = at - page_address;
+				std::size_t count = (std::min)(row_bytes - done, memory::page_size - offset);
+
+				auto page = memory::pages.find(page_address);
+				if (!page)
+					return row_state::pending;
+				if (!page->ok)
+					return row_state::failed;
+
+				std::memcpy(row.bytes + done, page->data.data() + offset, count);
+				if (page->heat) {
+					std::memcpy(row.heat + done, page->heat->data() + offset, count);
+					row.hot = true;
+				}
+				else {
+					std::memset(row.heat + done, 0, count);
+				}
+				done += count;
+			}
+
+			return row_state::ready;
+		}
+
+		// backgrounds behind changed cells and their ascii glyphs, alpha by how recently they changed
+		auto draw_heat( ImVec2 origin, const row_data& row ) -> void {
+			auto draw_list = ImGui::GetWindowDrawList();
+			float height = ImGui::GetTextLineHeight();
+			float fade = memory::pages.get_fade();
+
+			auto fill = [&](std::size_t first, std::size_t count, std::uint8_t heat) {
+				int alpha = static_cast<int>(160.0f * (std::min)(static_cast<float>(heat), fade) / fade);
+				ImVec2 min(origin.x + first * char_width, origin.y);
+				ImVec2 max(origin.x + (first + count) * char_width, origin.y + height);
+				draw_list->AddRectFilled(min, max, IM_COL32(255, 96, 32, alpha));
+			};
+
+			std::uint32_t size = column_size(formatter.format().type);
+			for (std::uint32_t i = 0; i < formatter.format().bytes_per_row; i += size) {
+				std::uint8_t heat = *std::max_element(row.heat + i, row.heat + i + size);
+				if (!heat)
+					continue;
+
+				auto [first, count] = formatter.cell_span(i);
+				fill(first, count, heat);
+				for (std::uint32_t j = i; j < i + size; j++) {
+					if (row.heat[j])
+						fill(formatter.ascii_column() + j, 1, row.heat[j]);
+				}
+			}
+		}
+
+		// underlines each classified qword and lists what they point at after the row
+		auto draw_pointers( ImVec2 origin, const row_data& row ) -> void {
+			auto draw_list = ImGui::GetWindowDrawList();
+			float y = origin.y + ImGui::GetTextLineHeight();
+			std::size_t row_bytes = formatter.format().bytes_per_row;
+
+			for (std::size_t i = 0; i + 8 <= row_bytes; i += 8) {
+				const memory::pointer_class& pointer = classes[row.first_qword + i / 8];
+				if (pointer.kind == memory::pointer_kind::data)
+					continue;
+
+				ImU32 color = pointer_color(pointer.kind);
+				auto [first, unused] = formatter.cell_span(static_cast<std::uint32_t>(i));
+				auto [last, last_width] = formatter.cell_span(static_cast<std::uint32_t>(i + 7));
+				draw_list->AddLine(ImVec2(origin.x + first * char_width, y), ImVec2(origin.x + (last + last_width) * char_width, y), color);
+
+				char note[256];
+				std::size_t length = 0;
+				if (pointer.kind == memory::pointer_kind::vtable) {
+					length = (std::min)(pointer.type->size(), sizeof(note));
+					std::memcpy(note, pointer.type->data(), length);
+				}
+				else if (pointer.kind == memory::pointer_kind::module) {
+					std::uint64_t value;
+					std::memcpy(&value, row.bytes + i, sizeof(value));
+					length = memory::symbols.name(value, note, sizeof(note));
+				}
+				if (!length)
+					continue;
+
+				ImGui::SameLine();
+				ImGui::PushStyleColor(ImGuiCol_Text, color);
+				ImGui::TextUnformatted(note, note + length);
+				ImGui::PopStyleColor();
+			}
+		}
+
+		static auto pointer_color( memory::pointer_kind kind ) -> ImU32 {
+			switch (kind) {
+			case memory::pointer_kind::module: return IM_COL32(90, 200, 120, 255);
+			case memory::pointer_kind::heap: return IM_COL32(90, 160, 255, 255);
+			case memory::pointer_kind::vtable: return IM_COL32(200, 120, 255, 255);
+			default: return IM_COL32(255, 255, 255, 255);
+			}
+		}
+
+		auto request_range( std::uint64_t begin, std::uint64_t end, memory::page_cache::priority priority ) -> void {
+			end = (std::min)(end, address_limit);
+			for (std::uint64_t page = memory::page_cache::page_of(begin); page < end; page += memory::page_size)
+				memory::pages.request(page, priority);
+		}
+
+		auto request_pages( void ) -> void {
+			if (visible_end <= visible_begin)
+				return;
+
+			if (visible_begin != previous_top)
+				direction = visible_begin > previous_top ? 1 : -1;
+			previous_top = visible_begin;
+
+			std::uint64_t screen = visible_end - visible_begin;
+			std::uint64_t below = visible_end;
+			std::uint64_t above = visible_begin > screen ? visible_begin - screen : 0;
+
+			request_range(visible_begin, visible_end, memory::page_cache::priority::visible);
+			if (direction >= 0) {
+				request_range(below, below + screen, memory::page_cache::priority::prefetch);
+				request_range(above, visible_begin, memory::page_cache::priority::prefetch);
+			}
+			else {
+				request_range(above, visible_begin, memory::page_cache::priority::prefetch);
+				request_range(below, below + screen, memory::page_cache::priority::prefetch);
+			}
+		}
+
+		row_formatter formatter;
+		std::vector<row_data> screen; // rows of the current clipper step
+		std::vector<std::uint64_t> qwords;
+		std::vector<memory::pointer_class> classes;
+		std::vector<std::uint64_t> targets; // of the clipper step's qwords, the ones pointing into a module
+		bool show_pointers = true;
+		float char_width = 0.0f;
+		std::chrono::milliseconds refresh_interval{ 0 };
+		std::chrono::steady_clock::time_point last_refresh{};
+		std::uint64_t window_first = 0; // first row the scrollbar covers
+		float last_scroll = 0.0f;
+		std::uint64_t target = 0;
+		bool jump = false;
+
+		std::uint64_t visible_begin = 0;
+		std::uint64_t visible_end = 0;
+		std::uint64_t previous_top = 0;
+		int direction = 1;
+	};
+}
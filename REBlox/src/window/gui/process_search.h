@@ -0,0 +1,164 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+#include "../../memory/processes.h"
+
+namespace reblox::gui {
+	// subsequence match of needle in haystack (both lowercase). -1 if it doesn't match, otherwise higher is
+	// better: consecutive runs, hits at the start of the name or after a separator, and few skipped characters
+	inline auto fuzzy_score( std::string_view haystack, std::string_view needle ) -> int {
+		if (needle.empty())
+			return 0;
+		if (needle.size() > haystack.size())
+			return -1;
+
+		int score = 0;
+		int run = 0;
+		std::size_t h = 0;
+		for (std::size_t n = 0; n < needle.size(); n++, h++) {
+			std::size_t start = h;
+			while (h < haystack.size() && haystack[h] != needle[n])
+				h++;
+			if (h == haystack.size())
+				return -1;
+
+			run = h == start && n ? run + 1 : 0;
+			score += 10 + run * 15;
+			score -= static_cast<int>((std::min)(h - start, std::size_t(10)));
+
+			if (h == 0)
+				score += 30;
+			else if (std::string_view(" ._-").find(haystack[h - 1]) != std::string_view::npos)
+				score += 20;
+		}
+
+		return score;
+	}
+
+	// ranked fuzzy filter over the published process list. names are interned (80 svchost.exe entries are
+	// scored once), the index is rebuilt only when the list generation changes, and typing another character
+	// only rescans the names that matched the previous query. steady-state frames don't allocate
+	class process_search {
+	public:
+		struct row {
+			const memory::process_info* process;
+			int score;
+		};
+
+		// returns true if results changed
+		auto update( const std::shared_ptr<const memory::process_snapshot>& next, const char* raw_query ) -> bool {
+			char lowered[sizeof(query)];
+			std::size_t length = 0;
+			for (; raw_query[length] && length + 1 < sizeof(lowered); length++)
+				lowered[length] = static_cast<char>(std::tolower(static_cast<unsigned char>(raw_query[length])));
+			lowered[length] = '\0';
+
+			bool rebuilt = false;
+			if (!snapshot || next->generation != snapshot->generation) {
+				snapshot = next;
+				build_index();
+				rebuilt = true;
+			}
+			else if (std::strcmp(lowered, query) == 0) {
+				return false;
+			}
+
+			std::string_view previous(query);
+			std::string_view current(lowered, length);
+			bool narrowing = !rebuilt && current.size() > previous.size() && current.starts_with(previous);
+
+			// full rescan unless we're narrowing, in which case only last round's hits can still match
+			candidates.clear();
+			if (narrowing) {
+				for (auto& match : matches)
+					candidates.push_back(match.name);
+			}
+			else {
+				for (std::uint32_t i = 0; i < names.size(); i++)
+					candidates.push_back(i);
+			}
+
+			matches.clear();
+			for (std::uint32_t name : candidates) {
+				int score = fuzzy_score(names[name].lower, current);
+				if (score >= 0)
+					matches.push_back({ name, score });
+			}
+
+			if (!current.empty()) {
+				std::sort(matches.begin(), matches.end(), [&](const name_match& a, const name_match& b) {
+					return a.score != b.score ? a.score > b.score : names[a.name].lower < names[b.name].lower;
+				});
+			}
+
+			rows.clear();
+			for (auto& match : matches) {
+				auto& name = names[match.name];
+				for (std::uint32_t i = name.first; i < name.first + name.count; i++)
+					rows.push_back({ grouped[i], match.score });
+			}
+
+			std::memcpy(query, lowered, length + 1);
+			return true;
+		}
+
+		auto results( void ) const -> const std::vector<row>& {
+			return rows;
+		}
+
+	private:
+		struct interned_name {
+			std::string_view lower; // points into a process_info owned by snapshot
+			std::uint32_t first; // range in grouped
+			std::uint32_t count;
+		};
+
+		struct name_match {
+			std::uint32_t name;
+			int score;
+		};
+
+		auto build_index( void ) -> void {
+			names.clear();
+			grouped.clear();
+
+			std::unordered_map<std::string_view, std::uint32_t> lookup;
+			std::vector<std::uint32_t> name_of(snapshot->processes.size());
+			for (std::size_t i = 0; i < snapshot->processes.size(); i++) {
+				std::string_view lower = snapshot->processes[i]->lower_name;
+				auto [it, inserted] = lookup.emplace(lower, static_cast<std::uint32_t>(names.size()));
+				if (inserted)
+					names.push_back({ lower, 0, 0 });
+				name_of[i] = it->second;
+				names[it->second].count++;
+			}
+
+			std::uint32_t offset = 0;
+			for (auto& name : names) {
+				name.first = offset;
+				offset += name.count;
+				name.count = 0;
+			}
+
+			grouped.resize(snapshot->processes.size());
+			for (std::size_t i = 0; i < snapshot->processes.size(); i++) {
+				auto& name = names[name_of[i]];
+				grouped[name.first + name.count++] = snapshot->processes[i].get();
+			}
+		}
+
+		std::shared_ptr<const memory::process_snapshot> snapshot;
+		std::vector<interned_name> names;
+		std::vector<const memory::process_info*> grouped; // processes ordered by interned name
+		std::vector<std::uint32_t> candidates;
+		std::vector<name_match> matches;
+		std::vector<row> rows;
+		char query[256]{};
+	};
+}
@@ -0,0 +1,179 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <climits>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include "../../../thirdparty/imgui/imgui.h"
+#include "../../memory/scan_session.h"
+#include "../../memory/symbols.h"
+#include "../frame_scheduler.h"
+
+namespace reblox::gui {
+	// value, string and signature scans on a scan_session. results show up as chunks finish and the table
+	// only ever asks the store for the rows on screen, so a multi-GB scan is browsable and cancellable while
+	// it runs
+	class scan_panel {
+	public:
+		static constexpr std::chrono::milliseconds poll_interval{ 100 };
+
+		// the result the user opened, for the memory view to go to
+		auto draw( void ) -> std::optional<std::uint64_t> {
+			draw_query();
+
+			auto progress = session.get_progress();
+			if (progress.running)
+				window::frames.wake_in(poll_interval);
+			draw_progress(progress);
+
+			ImGui::Separator();
+			return draw_results(progress);
+		}
+
+		// before detaching, nothing of the scan may read from the process after this
+		auto reset( void ) -> void {
+			session.clear();
+			error.clear();
+		}
+
+	private:
+		enum struct kind : int {
+			i8, u8, i16, u16, i32, u32, i64, u64, f32, f64, string, signature
+		};
+
+		auto draw_query( void ) -> void {
+			int selected = static_cast<int>(type);
+			ImGui::SetNextItemWidth(100);
+			if (ImGui::Combo("Type", &selected, "i8\0u8\0i16\0u16\0i32\0u32\0i64\0u64\0f32\0f64\0string\0signature\0"))
+				type = static_cast<kind>(selected);
+			ImGui::SameLine();
+			ImGui::SetNextItemWidth(-1);
+			bool entered = ImGui::InputTextWithHint("##ScanValue", type == kind::signature ? "48 8B 05 ?? ?? ?? ??" : "value", text, sizeof(text), ImGuiInputTextFlags_EnterReturnsTrue);
+
+			if (type == kind::signature)
+				ImGui::Checkbox("Code only", &code_only);
+			else
+				ImGui::Checkbox("Writable only", &writable_only);
+
+			auto progress = session.get_progress();
+			ImGui::SameLine();
+			if (ImGui::Button("Scan") || entered)
+				start();
+			ImGui::SameLine();
+			ImGui::BeginDisabled(!progress.running);
+			if (ImGui::Button("Cancel"))
+				session.cancel();
+			ImGui::EndDisabled();
+
+			if (!error.empty())
+				ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", error.c_str());
+		}
+
+		auto start( void ) -> void {
+			error.clear();
+			std::string value = text;
+
+			memory::scan_options options;
+			if (type == kind::signature) {
+				auto sig = memory::parse_signature(value);
+				if (!sig) {
+					error = "Not a signature";
+					return;
+				}
+				options.executable_only = code_only;
+				session.start_signature(*sig, options);
+				return;
+			}
+
+			options.writable_only = writable_only;
+			if (type == kind::string) {
+				if (value.empty()) {
+					error = "Nothing to look for";
+					return;
+				}
+				session.start_bytes({ reinterpret_cast<const std::uint8_t*>(value.data()), value.size() }, options);
+				return;
+			}
+
+			bool parsed = false;
+			switch (type) {
+			case kind::i8: parsed = start_value<std::int8_t>(value, options); break;
+			case kind::u8: parsed = start_value<std::uint8_t>(value, options); break;
+			case kind::i16: parsed = start_value<std::int16_t>(value, options); break;
+			case kind::u16: parsed = start_value<std::uint16_t>(value, options); break;
+			case kind::i32: parsed = start_value<std::int32_t>(value, options); break;
+			case kind::u32: parsed = start_value<std::uint32_t>(value, options); break;
+			case kind::i64: parsed = start_value<std::int64_t>(value, options); break;
+			case kind::u64: parsed = start_value<std::uint64_t>(value, options); break;
+			case kind::f32: parsed = start_value<float>(value, options); break;
+			case kind::f64: parsed = start_value<double>(value, options); break;
+			default: break;
+			}
+			if (!parsed)
+				error = "Couldn't parse the value for that type";
+		}
+
+		template <typename t>
+		auto start_value( const std::string& value, const memory::scan_options& options ) -> bool {
+			auto parsed = memory::parse_value<t>(value);
+			if (parsed)
+				session.start_value(*parsed, options);
+			return parsed.has_value();
+		}
+
+		static auto draw_progress( const memory::scan_session::progress& progress ) -> void {
+			constexpr double mib = 1024.0 * 1024.0;
+			char overlay[128];
+			std::snprintf(overlay, sizeof(overlay), "%.0f / %.0f MiB, %.0f MiB/s, %llu hits%s", progress.walked / mib, progress.total / mib, progress.bytes_per_second() / mib, static_cast<unsigned long long>(progress.hits), progress.cancelled ? " (cancelled)" : "");
+			ImGui::ProgressBar(progress.fraction(), ImVec2(-1.0f, 0.0f), overlay);
+		}
+
+		auto draw_results( const memory::scan_session::progress& progress ) -> std::optional<std::uint64_t> {
+			std::optional<std::uint64_t> opened;
+			if (!ImGui::BeginTable("##ScanResults", 2, ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_BordersInnerV))
+				return opened;
+
+			ImGui::TableSetupScrollFreeze(0, 1);
+			ImGui::TableSetupColumn("Address", ImGuiTableColumnFlags_WidthFixed, 140);
+			ImGui::TableSetupColumn("Location", ImGuiTableColumnFlags_WidthStretch);
+			ImGui::TableHeadersRow();
+
+			// the clipper wants an int, past that the table stops
+			int rows = static_cast<int>((std::min)(progress.hits, static_cast<std::uint64_t>(INT_MAX)));
+			ImGuiListClipper clipper;
+			clipper.Begin(rows);
+			while (clipper.Step()) {
+				session.results(static_cast<std::uint64_t>(clipper.DisplayStart), static_cast<std::size_t>(clipper.DisplayEnd - clipper.DisplayStart), visible);
+				memory::symbols.prefetch(visible);
+				for (std::size_t i = 0; i < visible.size(); i++) {
+					std::uint64_t address = visible[i];
+					char label[32];
+					std::snprintf(label, sizeof(label), "%016llX##%d", static_cast<unsigned long long>(address), clipper.DisplayStart + static_cast<int>(i));
+
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					if (ImGui::Selectable(label, false, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowDoubleClick) && ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left))
+						opened = address;
+					ImGui::TableNextColumn();
+					char location[256];
+					std::size_t length = memory::symbols.name(address, location, sizeof(location));
+					if (length)
+						ImGui::TextUnformatted(location, location + length);
+				}
+			}
+			ImGui::EndTable();
+			return opened;
+		}
+
+		memory::scan_session session;
+		kind type = kind::i32;
+		char text[256] = {};
+		bool writable_only = true;
+		bool code_only = true;
+		std::string error;
+		std::vector<std::uint64_t> visible; // the clipper step's rows
+	};
+}
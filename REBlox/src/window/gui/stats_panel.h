@@ -0,0 +1,178 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cfloat>
+#include <ctime>
+#include <bit>
+#include <chrono>
+#include <array>
+#include <string>
+#include <filesystem>
+#include <algorithm>
+#include "../../../thirdparty/imgui/imgui.h"
+#include "../../memory/stats.h"
+#include "../../memory/timeline.h"
+#include "../../memory/attach.h"
+#include "../frame_scheduler.h"
+
+namespace reblox::gui {
+	// the engine's counters and latency histograms. totals are taken twice a second, rates are the change
+	// between the last two takes; the distribution plot shows the selected timer's buckets from 1 us up
+	class stats_panel {
+	public:
+		static constexpr std::chrono::milliseconds interval{ 500 };
+
+		auto draw( bool* open ) -> void {
+			if (!ImGui::Begin("Diagnostics", open)) {
+				ImGui::End();
+				return;
+			}
+
+			auto now = std::chrono::steady_clock::now();
+			if (now - taken >= interval) {
+				previous = current;
+				current = memory::stats::engine.take();
+				taken = now;
+			}
+			window::frames.wake_at(taken + interval);
+
+			if (ImGui::Button("Reset")) {
+				memory::stats::engine.reset();
+				current = previous = {};
+				taken = {};
+			}
+			ImGui::SameLine();
+			ImGui::Text("%.1f s since reset", current.seconds);
+
+			draw_derived();
+			draw_counters();
+			draw_timers();
+			draw_distribution();
+			draw_timeline();
+
+			ImGui::End();
+		}
+
+	private:
+		using counter = memory::stats::counter;
+
+		auto draw_derived( void ) -> void {
+			std::uint64_t reads = current.get(counter::reads);
+			std::uint64_t batches = current.get(counter::scatter_batches);
+			ImGui::Text("page cache hits %.1f%%, vtable cache hits %.1f%%", current.ratio(counter::page_cache_hits, counter::page_cache_misses) * 100, current.ratio(counter::vtable_cache_hits, counter::vtable_cache_misses) * 100);
+			ImGui::Text("%.1f KiB per read, %.1f%% failed, %.1f blocks per scatter batch", reads ? current.get(counter::bytes_read) / 1024.0 / reads : 0.0, reads ? current.get(counter::failed_reads) * 100.0 / reads : 0.0, batches ? static_cast<double>(current.get(counter::scatter_entries)) / batches : 0.0);
+		}
+
+		auto draw_counters( void ) -> void {
+			double elapsed = current.seconds - previous.seconds;
+			if (!ImGui::BeginTable("counters", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV))
+				return;
+
+			ImGui::TableSetupColumn("Counter");
+			ImGui::TableSetupColumn("Total");
+			ImGui::TableSetupColumn("Per second");
+			ImGui::TableHeadersRow();
+			for (std::size_t i = 0; i < memory::stats::counter_count; i++) {
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(memory::stats::counter_names[i].data(), memory::stats::counter_names[i].data() + memory::stats::counter_names[i].size());
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", static_cast<unsigned long long>(current.counters[i]));
+				ImGui::TableNextColumn();
+				ImGui::Text("%.0f", elapsed > 0 && current.counters[i] >= previous.counters[i] ? (current.counters[i] - previous.counters[i]) / elapsed : 0.0);
+			}
+			ImGui::EndTable();
+		}
+
+		auto draw_timers( void ) -> void {
+			if (!ImGui::BeginTable("timers", 7, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV))
+				return;
+
+			static constexpr const char* columns[] = { "Timer", "Count", "Mean us", "p50 us", "p90 us", "p99 us", "Max us" };
+			for (auto column : columns)
+				ImGui::TableSetupColumn(column);
+			ImGui::TableHeadersRow();
+			for (std::size_t i = 0; i < memory::stats::timer_count; i++) {
+				auto& histogram = current.timers[i];
+				ImGui::TableNextColumn();
+				if (ImGui::Selectable(memory::stats::timer_names[i].data(), selected == i, ImGuiSelectableFlags_SpanAllColumns))
+					selected = i;
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", static_cast<unsigned long long>(histogram.count));
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", histogram.mean_ns() / 1000);
+				for (double q : { 0.5, 0.9, 0.99 }) {
+					ImGui::TableNextColumn();
+					ImGui::Text("%.2f", histogram.percentile(q) / 1000.0);
+				}
+				ImGui::TableNextColumn();
+				ImGui::Text("%.2f", histogram.max_ns / 1000.0);
+			}
+			ImGui::EndTable();
+		}
+
+		// one bar per power of two from 1 us (2^10 ns) to ~1 s (2^30 ns), the ends take everything past them
+		auto draw_distribution( void ) -> void {
+			constexpr unsigned first = 10, last = 30;
+			std::array<float, last - first + 1> bars{};
+
+			auto& histogram = current.timers[selected];
+			for (std::size_t bucket = 0; bucket < memory::stats::bucket_count; bucket++) {
+				unsigned power = static_cast<unsigned>(std::bit_width(memory::stats::bucket_floor(bucket)));
+				power = power > first ? power - 1 : first;
+				bars[(std::min)(power, last) - first] += static_cast<float>(histogram.buckets[bucket]);
+			}
+
+			char label[64];
+			std::snprintf(label, sizeof(label), "%s, <1 us .. >1 s", memory::stats::timer_names[selected].data());
+			ImGui::PlotHistogram("##distribution", bars.data(), static_cast<int>(bars.size()), 0, label, 0.0f, FLT_MAX, ImVec2(-1.0f, 80.0f));
+		}
+
+		// recording toggle and a save to %LOCALAPPDATA%\REBlox\timelines, json opens in chrome://tracing and the
+		// protobuf in ui.perfetto.dev
+		auto draw_timeline( void ) -> void {
+			ImGui::SeparatorText("Timeline");
+			bool recording = memory::timeline::engine.recording();
+			if (ImGui::Checkbox("Record", &recording)) {
+				if (recording)
+					memory::timeline::engine.start();
+				else
+					memory::timeline::engine.stop();
+			}
+
+			const char* extension = nullptr;
+			ImGui::SameLine();
+			if (ImGui::Button("Save JSON"))
+				extension = ".json";
+			ImGui::SameLine();
+			if (ImGui::Button("Save Perfetto"))
+				extension = ".pftrace";
+			if (extension)
+				save_timeline(extension);
+
+			if (!saved.empty())
+				ImGui::TextWrapped("%s", saved.c_str());
+		}
+
+		auto save_timeline( const char* extension ) -> void {
+			std::filesystem::path directory = memory::store::directory() / L"timelines";
+			std::error_code error;
+			std::filesystem::create_directories(directory, error);
+			std::filesystem::path path = directory / (std::to_string(static_cast<long long>(std::time(nullptr))) + extension);
+
+			auto events = memory::timeline::engine.collect();
+			std::size_t count = 0;
+			for (auto& thread : events.threads)
+				count += thread.events.size();
+
+			char buf[64];
+			std::snprintf(buf, sizeof(buf), "%zu events (%llu dropped) to ", count, static_cast<unsigned long long>(events.dropped));
+			saved = memory::timeline::write(events, path) ? "Saved " + std::string(buf) + path.string() : "Couldn't write " + path.string();
+		}
+
+		memory::stats::report current;
+		memory::stats::report previous;
+		std::chrono::steady_clock::time_point taken{};
+		std::size_t selected = static_cast<std::size_t>(memory::stats::timer::read);
+		std::string saved; // what the last save did
+	};
+}